@@ -134,6 +134,8 @@
 #define ID_DISKMENU_WRITEPROTECTION_ON  40005
 #define ID_DISKMENU_WRITEPROTECTION_OFF 40006
 #define ID_DISKMENU_SENDTO_CIDERPRESS   40007
+#define ID_DISKMENU_NEXT_DISK_IN_ZIP    40012
+#define ID_DISKMENU_PREV_DISK_IN_ZIP    40013
 
 // Next default values for new objects
 // 
@@ -141,7 +143,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
 #define _APS_NEXT_RESOURCE_VALUE        149
-#define _APS_NEXT_COMMAND_VALUE         40012
+#define _APS_NEXT_COMMAND_VALUE         40014
 #define _APS_NEXT_CONTROL_VALUE         1083
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
@@ -462,6 +462,43 @@ static __forceinline bool IRQ(ULONG& uExecutedCycles, BOOL& flagc, BOOL& flagn,
 
 //===========================================================================
 
+static CpuPCTrapHandler g_pcTrapHandler = NULL;
+static BYTE g_pcTrapBitmap[0x10000/8];	// 1 bit per PC: only set PCs call the handler
+
+void CpuSetPCTrapHandler(CpuPCTrapHandler handler)
+{
+	g_pcTrapHandler = handler;
+	memset(g_pcTrapBitmap, 0, sizeof(g_pcTrapBitmap));
+}
+
+void CpuSetPCTrap(WORD pc, bool enable)
+{
+	if (enable && g_pcTrapHandler)
+		g_pcTrapBitmap[pc >> 3] |= 1 << (pc & 7);
+	else
+		g_pcTrapBitmap[pc >> 3] &= ~(1 << (pc & 7));
+}
+
+// The handler is called before fetching the opcode at a trapped PC, and returns the # cycles it emulated (or 0 to execute the opcode as normal)
+// . It may change any of the registers, eg. to return from the subroutine it has emulated
+static __forceinline bool PCTrap(ULONG& uExecutedCycles, BOOL& flagc, BOOL& flagn, BOOL& flagv, BOOL& flagz)
+{
+	if (!(g_pcTrapBitmap[regs.pc >> 3] & (1 << (regs.pc & 7))))	// NB. no bits are set if there's no handler
+		return false;
+
+	EF_TO_AF
+	const UINT cycles = g_pcTrapHandler(regs.pc);
+	if (!cycles)
+		return false;
+
+	AF_TO_EF
+	UINT uExtraCycles = 0;	// Needed for CYC(a) macro
+	CYC(cycles);
+	return true;
+}
+
+//===========================================================================
+
 #define READ _READ_WITH_IO_F8xx
 #define WRITE(value) _WRITE_WITH_IO_F8xx(value)
 #define HEATMAP_X(address)
@@ -54,6 +54,10 @@ static DWORD Cpu65C02(DWORD uTotalCycles, const bool bVideoUpdate)
 		{
 			// Allow AppleWin debugger's single-stepping to just step the pending IRQ
 		}
+		else if (PCTrap(uExecutedCycles, flagc, flagn, flagv, flagz))
+		{
+			// Opt-in trap (eg. Disk II fast-load) has emulated a whole subroutine
+		}
 		else
 		{
 			HEATMAP_X( regs.pc );
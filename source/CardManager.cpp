@@ -303,3 +303,40 @@ void CardManager::SaveSnapshot(YamlSaveHelper& yamlSaveHelper)
 		}
 	}
 }
+
+// Disk II & HDD instrumentation counters, as a JSON array (one object per card)
+std::string CardManager::GetDiskStatsJson(void)
+{
+	std::string json = "[";
+
+	for (UINT i = SLOT0; i < NUM_SLOTS; ++i)
+	{
+		std::string card;
+		if (QuerySlot(i) == CT_Disk2)
+			card = dynamic_cast<Disk2InterfaceCard&>(GetRef(i)).GetStatsJson();
+		else if (QuerySlot(i) == CT_GenericHDD)
+			card = dynamic_cast<HarddiskInterfaceCard&>(GetRef(i)).GetStatsJson();
+		else if (QuerySlot(i) == CT_SmartPortOverSlip)
+			card = dynamic_cast<SmartPortOverSlip&>(GetRef(i)).GetStatsJson();
+		else
+			continue;
+
+		if (json.size() > 1)
+			json += ",";
+		json += "\n  " + card;
+	}
+
+	json += "\n]\n";
+	return json;
+}
+
+bool CardManager::WriteDiskStats(const std::string& pathname)
+{
+	FILE* hFile = fopen(pathname.c_str(), "wt");
+	if (!hFile)
+		return false;
+
+	const std::string json = GetDiskStatsJson();
+	const bool res = fwrite(json.c_str(), 1, json.size(), hFile) == json.size();
+	return (fclose(hFile) == 0) && res;
+}
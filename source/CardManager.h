@@ -67,6 +67,8 @@ public:
 	void Reset(const bool powerCycle);
 	void Update(const ULONG nExecutedCycles);
 	void SaveSnapshot(YamlSaveHelper& yamlSaveHelper);
+	std::string GetDiskStatsJson(void);
+	bool WriteDiskStats(const std::string& pathname);
 
 private:
 	void InsertInternal(UINT slot, SS_CARDTYPE type);
@@ -634,10 +634,87 @@ bool ProcessCmdLine(LPSTR lpCmdLine)
 			lpNextArg = GetNextArg(lpNextArg);
 			g_cmdLine.wavFileMockingboard = lpCmdLine;
 		}
+		else if (strcmp(lpCmdLine, "-fullspeed-frameskip") == 0)	// redraw once every N video frames during full-speed
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.fullSpeedRedraw = FrameBase::FSR_EVERY_N_FRAMES;
+			const int frameSkip = atoi(lpCmdLine);
+			if (frameSkip < 1 || frameSkip > 1000)
+			{
+				LogFileOutput("-fullspeed-frameskip: %s is out of range (1..1000), using 1\n", lpCmdLine);
+				g_cmdLine.fullSpeedFrameSkip = 1;
+			}
+			else
+			{
+				g_cmdLine.fullSpeedFrameSkip = frameSkip;
+			}
+		}
+		else if (strcmp(lpCmdLine, "-fullspeed-redraw-when-ready") == 0)	// redraw during full-speed only when the host can present
+		{
+			g_cmdLine.fullSpeedRedraw = FrameBase::FSR_WHEN_READY;
+		}
+		else if (strcmp(lpCmdLine, "-ntsc-table-cache") == 0)
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.ntscTableCacheFile = lpCmdLine;
+		}
+		else if (strcmp(lpCmdLine, "-video-capture") == 0)	// .y4m (default) or .rgba
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.videoCaptureFile = lpCmdLine;
+		}
+		else if (strcmp(lpCmdLine, "-video-capture-wav") == 0)	// speaker audio to accompany -video-capture
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.videoCaptureWavFile = lpCmdLine;
+		}
 		else if (strcmp(lpCmdLine, "-mb-audit") == 0)	// enable selection of additional sound cards, eg. for mb-audit
 		{
 			g_cmdLine.supportExtraMBCardTypes = true;
 		}
+		else if (strcmp(lpCmdLine, "-disk-fastload") == 0)	// trap DOS 3.3 RWTS & ProDOS Disk II driver calls
+		{
+			g_cmdLine.diskFastLoad = true;
+		}
+		else if (strcmp(lpCmdLine, "-disk-fastload-cycles") == 0)	// emulated cycles charged per 256-byte sector (implies -disk-fastload)
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.diskFastLoad = true;
+			// NB. a ProDOS block is 2 sectors, and is charged in one go, so must stay below a video frame (17030 cycles)
+			const int cyclesPerSector = atoi(lpCmdLine);
+			if (cyclesPerSector < 1 || cyclesPerSector > 8000)
+			{
+				LogFileOutput("-disk-fastload-cycles: %s is out of range (1..8000), using the default\n", lpCmdLine);
+				g_cmdLine.diskFastLoadCyclesPerSector = 0;
+			}
+			else
+			{
+				g_cmdLine.diskFastLoadCyclesPerSector = cyclesPerSector;
+			}
+		}
+		else if (strcmp(lpCmdLine, "-disk-stats") == 0)	// on exit, write the Disk II & HDD instrumentation counters as JSON
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.diskStatsFile = lpCmdLine;
+		}
+		else if (strcmp(lpCmdLine, "-sp-sim") == 0)	// serve a ProDOS block image from the built-in SmartPort device simulator (repeatable)
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.spSimImages.push_back(lpCmdLine);
+		}
+		else if (strcmp(lpCmdLine, "-sp-sim-exit") == 0)	// exit once the simulator has been idle for this many seconds, eg. after booting
+		{
+			lpCmdLine = GetCurrArg(lpNextArg);
+			lpNextArg = GetNextArg(lpNextArg);
+			g_cmdLine.spSimExitSeconds = atoi(lpCmdLine);
+		}
 		else if (strcmp(lpCmdLine, "-no-disk2-stepper-defer") == 0)	// a debug switch added at 1.30.11 / GH#1110 (likely to be removed in a future version)
 		{
 			g_cmdLine.noDisk2StepperDefer = true;
@@ -5,6 +5,7 @@
 #include "Disk.h"
 #include "Common.h"
 #include "Card.h"
+#include "FrameBase.h"
 
 
 struct CmdLine
@@ -34,6 +35,8 @@ struct CmdLine
 		enableDumpToRealPrinter = false;
 		supportExtraMBCardTypes = false;
 		noDisk2StepperDefer = false;
+		diskFastLoad = false;
+		diskFastLoadCyclesPerSector = 0;
 		useHdcFirmwareV1 = false;
 		szSnapshotName = NULL;
 		szScreenshotFilename = NULL;
@@ -52,6 +55,9 @@ struct CmdLine
 		bestFullScreenResolution = false;
 		userSpecifiedWidth = 0;
 		userSpecifiedHeight = 0;
+		fullSpeedRedraw = FrameBase::FSR_TIMED;
+		fullSpeedFrameSkip = 1;
+		spSimExitSeconds = 0;
 
 		for (UINT i = 0; i < NUM_SLOTS; i++)
 		{
@@ -79,6 +85,8 @@ struct CmdLine
 	bool enableDumpToRealPrinter;
 	bool supportExtraMBCardTypes;
 	bool noDisk2StepperDefer;	// debug
+	bool diskFastLoad;
+	UINT diskFastLoadCyclesPerSector;	// 0 = default
 	bool useHdcFirmwareV1;	// debug
 	SS_CARDTYPE slotInsert[NUM_SLOTS];
 	SlotInfo slotInfo[NUM_SLOTS];
@@ -105,6 +113,14 @@ struct CmdLine
 	UINT userSpecifiedHeight;
 	std::string wavFileSpeaker;
 	std::string wavFileMockingboard;
+	std::string videoCaptureFile;
+	std::string videoCaptureWavFile;
+	FrameBase::FullSpeedRedraw_e fullSpeedRedraw;
+	UINT fullSpeedFrameSkip;
+	std::string ntscTableCacheFile;
+	std::string diskStatsFile;
+	std::vector<std::string> spSimImages;
+	UINT spSimExitSeconds;
 };
 
 bool ProcessCmdLine(LPSTR lpCmdLine);
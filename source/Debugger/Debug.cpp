@@ -41,10 +41,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "../CardManager.h"
 #include "../CPU.h"
 #include "../Disk.h"
+#include "../Harddisk.h"
+#include "../SmartPortOverSlip.h"
 #include "../Keyboard.h"
 #include "../Memory.h"
 #include "../NTSC.h"
 #include "../SoundCore.h"	// SoundCore_SetFade()
+#include "../VideoCapture.h"
 
 //	#define DEBUG_COMMAND_HELP  1
 //	#define DEBUG_ASM_HASH 1
@@ -3636,6 +3639,7 @@ Update_t CmdFlag (int nArgs)
 // Usage:
 //     DISK SLOT [#]                                 // Show [or set] the current slot of the Disk II I/F card (for all other cmds to act on)
 //     DISK INFO                                     // Info for current drive
+//     DISK STATS [RESET]                            // Show [or reset] the Disk II, HDD & SPoverSLIP instrumentation counters (all slots)
 //     DISK # EJECT                                  // Unmount disk
 //     DISK # PROTECT #                              // Write-protect disk on/off
 //     DISK # "<filename>"                           // Mount filename as floppy disk
@@ -3656,6 +3660,101 @@ Update_t CmdDisk (int nArgs)
 	int iParam = 0;
 	FindParam(g_aArgs[1].sArg, MATCH_EXACT, iParam, _PARAM_DISK_BEGIN, _PARAM_DISK_END);
 
+	if (iParam == PARAM_DISK_STATS)
+	{
+		if (nArgs > 2)
+			return HelpLastCommand();
+
+		bool bReset = false;
+		if (nArgs == 2)
+		{
+			int iParamReset = 0;
+			FindParam(g_aArgs[2].sArg, MATCH_EXACT, iParamReset, _PARAM_GENERAL_BEGIN, _PARAM_GENERAL_END);
+			if (iParamReset != PARAM_RESET)
+				return HelpLastCommand();
+			bReset = true;
+		}
+
+		for (UINT slot = SLOT1; slot < NUM_SLOTS; slot++)
+		{
+			if (GetCardMgr().QuerySlot(slot) == CT_Disk2)
+			{
+				Disk2InterfaceCard& card = dynamic_cast<Disk2InterfaceCard&>(GetCardMgr().GetRef(slot));
+				if (bReset)
+				{
+					card.ResetStats();
+					continue;
+				}
+
+				const Disk2InterfaceCard::Stats_t& stats = card.GetStats();
+				ConsolePrintFormat(CHC_DEFAULT "S" CHC_NUM_DEC "%u" CHC_ARG_SEP ":" CHC_DEFAULT " Disk][ track changes " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " track reads " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " write-backs " CHC_NUM_DEC "%u",
+					slot, (UINT)stats.trackChanges, (UINT)stats.trackReads, (UINT)stats.writeBacks);
+				ConsolePrintFormat(CHC_DEFAULT "    nibbles read " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " written " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " host I/O " CHC_NUM_DEC "%u" CHC_DEFAULT "ms",
+					(UINT)stats.nibblesRead, (UINT)stats.nibblesWritten, (UINT)(stats.hostIOMicroseconds / 1000));
+				ConsolePrintFormat(CHC_DEFAULT "    motor on " CHC_NUM_DEC "%u" CHC_DEFAULT " cycles" CHC_ARG_SEP ","
+					CHC_DEFAULT " at full speed " CHC_NUM_DEC "%u" CHC_DEFAULT " cycles",
+					(UINT)stats.motorOnCycles, (UINT)stats.fullSpeedCycles);
+				ConsolePrintFormat(CHC_DEFAULT "    fast-load bytes read " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " written " CHC_NUM_DEC "%u",
+					(UINT)stats.fastLoadBytesRead, (UINT)stats.fastLoadBytesWritten);
+			}
+			else if (GetCardMgr().QuerySlot(slot) == CT_GenericHDD)
+			{
+				HarddiskInterfaceCard& card = dynamic_cast<HarddiskInterfaceCard&>(GetCardMgr().GetRef(slot));
+				if (bReset)
+				{
+					card.ResetStats();
+					continue;
+				}
+
+				const HarddiskInterfaceCard::Stats_t& stats = card.GetStats();
+				const HarddiskBlockCache::Stats_t cache = card.GetBlockCacheStats();
+				ConsolePrintFormat(CHC_DEFAULT "S" CHC_NUM_DEC "%u" CHC_ARG_SEP ":" CHC_DEFAULT " HDD blocks read " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " written " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " errors " CHC_NUM_DEC "%u",
+					slot, (UINT)stats.blocksRead, (UINT)stats.blocksWritten, (UINT)stats.errors);
+				ConsolePrintFormat(CHC_DEFAULT "    cache hits " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " misses " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " write-backs " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " host I/O " CHC_NUM_DEC "%u" CHC_DEFAULT "ms",
+					(UINT)cache.hits, (UINT)cache.misses, (UINT)cache.hostWrites,
+					(UINT)((cache.hostReadMicroseconds + cache.hostWriteMicroseconds) / 1000));
+			}
+			else if (GetCardMgr().QuerySlot(slot) == CT_SmartPortOverSlip)
+			{
+				SmartPortOverSlip& card = dynamic_cast<SmartPortOverSlip&>(GetCardMgr().GetRef(slot));
+				if (bReset)
+				{
+					card.ResetStats();
+					continue;
+				}
+
+				const SmartPortOverSlip::Stats& stats = card.GetStats();
+				ConsolePrintFormat(CHC_DEFAULT "S" CHC_NUM_DEC "%u" CHC_ARG_SEP ":" CHC_DEFAULT " SPoverSLIP blocks read " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " written " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " errors " CHC_NUM_DEC "%u",
+					slot, (UINT)stats.blocks_read, (UINT)stats.blocks_written, (UINT)stats.errors);
+				ConsolePrintFormat(CHC_DEFAULT "    read-ahead hits " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " misses " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " host I/O " CHC_NUM_DEC "%u" CHC_DEFAULT "ms",
+					(UINT)stats.read_ahead_hits, (UINT)stats.read_ahead_misses, (UINT)(stats.call_microseconds / 1000));
+				ConsolePrintFormat(CHC_DEFAULT "    block latency p50 " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " p99 " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+					CHC_DEFAULT " max " CHC_NUM_DEC "%u" CHC_DEFAULT "us",
+					card.GetBlockLatencyPercentile(0.50), card.GetBlockLatencyPercentile(0.99), card.GetBlockLatencyPercentile(1.0));
+			}
+		}
+
+		if (bReset)
+			ConsoleBufferPush(" Resetting disk stats.");
+
+		return ConsoleUpdate();
+	}
+
 	if (iParam == PARAM_DISK_SET_SLOT)
 	{
 		if (nArgs > 2)
@@ -6752,6 +6851,19 @@ Update_t CmdVideoScannerInfo (int nArgs)
 			g_videoScannerDisplayInfo.isHorzReal = true;
 		else if (strcmp(g_aArgs[1].sArg, "apple") == 0)
 			g_videoScannerDisplayInfo.isHorzReal = false;
+		else if (strcmp(g_aArgs[1].sArg, "capture") == 0)
+		{
+			// Counts are kept after the capture stops, until the next one starts
+			VideoCapture& capture = GetVideoCapture();
+			ConsolePrintFormat(CHC_DEFAULT "Video capture %s" CHC_ARG_SEP ":" CHC_DEFAULT " frames captured " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+				CHC_DEFAULT " written " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+				CHC_DEFAULT " dropped (repeated) " CHC_NUM_DEC "%u" CHC_ARG_SEP ","
+				CHC_DEFAULT " audio samples dropped " CHC_NUM_DEC "%u",
+				capture.IsActive() ? "active" : "stopped",
+				(UINT)capture.GetNumFramesCaptured(), (UINT)capture.GetNumFramesWritten(),
+				(UINT)capture.GetNumFramesDropped(), (UINT)capture.GetNumAudioSamplesDropped());
+			return ConsoleUpdate();
+		}
 		else
 			return Help_Arg_1(CMD_VIDEO_SCANNER_INFO);
 	}
@@ -455,6 +455,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 		{TEXT("EJECT")      , NULL, PARAM_DISK_EJECT     },
 		{TEXT("PROTECT")    , NULL, PARAM_DISK_PROTECT   },
 		{TEXT("READ")       , NULL, PARAM_DISK_READ      },
+		{TEXT("STATS")      , NULL, PARAM_DISK_STATS     },
 // Font (Config)
 		{TEXT("MODE")       , NULL, PARAM_FONT_MODE      }, // also INFO, CONSOLE, DISASM (from Window)
 // General
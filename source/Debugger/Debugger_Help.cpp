@@ -1299,10 +1299,11 @@ Update_t CmdHelpSpecific (int nArgs)
 			break;
 	// Video-Scanner
 		case CMD_VIDEO_SCANNER_INFO:
-			ConsoleColorizePrint(" Usage: <dec|hex|real|apple>");
+			ConsoleColorizePrint(" Usage: <dec|hex|real|apple|capture>");
 			ConsoleBufferPush("  Where:");
 			ConsoleBufferPush("    <dec|hex> changes output to dec/hex");
 			ConsoleBufferPush("    <real|apple> alters horz value to hbl-l,visible,hbl-r or hbl-r+l,visible");
+			ConsoleBufferPush("    <capture> shows the -video-capture frame & audio counts");
 			ConsolePrintFormat("    %sYellow%s=invisible (hbl or vbl active) / %sGreen%s=visible"
 				,CHC_INFO   , CHC_DEFAULT	// yellow
 				,CHC_COMMAND, CHC_DEFAULT	// green
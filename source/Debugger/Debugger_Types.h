@@ -1416,6 +1416,7 @@ const	DisasmData_t* pDisasmData; // If != NULL then bytes are marked up as data
 		, PARAM_DISK_EJECT                     // DISK 1 EJECT
 		, PARAM_DISK_PROTECT                   // DISK 1 PROTECT
 		, PARAM_DISK_READ                      // DISK 1 READ Track Sector NumSectors MemAddress
+		, PARAM_DISK_STATS                     // DISK STATS [RESET]
 	, _PARAM_DISK_END
 	,  PARAM_DISK_NUM = _PARAM_DISK_END - _PARAM_DISK_BEGIN
 
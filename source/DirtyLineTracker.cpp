@@ -0,0 +1,106 @@
+/*
+AppleWin : An Apple //e emulator for Windows
+
+Copyright (C) 1994-1996, Michael O'Brien
+Copyright (C) 1999-2001, Oliver Schmidt
+Copyright (C) 2002-2005, Tom Charlesworth
+Copyright (C) 2006-2024, Tom Charlesworth, Michael Pohoreski, Nick Westgate
+
+AppleWin is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+AppleWin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with AppleWin; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Description: Dirty line ranges between consecutive presented frames
+ *
+ * Author: Various
+ */
+
+#include "StdAfx.h"
+#include "DirtyLineTracker.h"
+
+void DirtyLineTracker::Reset(UINT height)
+{
+	// NB. the hashes are kept if the height is unchanged, as lines may have been rendered since the last Update()
+	if (m_lineHashes.size() != height)
+	{
+		m_lineHashes.assign(height, 0);
+		m_lineDirty.assign(height, 0);
+	}
+
+	m_allDirty = true;
+}
+
+void DirtyLineTracker::LineRendered(UINT line, const uint32_t* pPixels, UINT width)
+{
+	if (line >= m_lineHashes.size())
+		return;	// outside the frame
+
+	const uint64_t hash = HashLine(pPixels, width);
+	if (hash != m_lineHashes[line])
+	{
+		m_lineHashes[line] = hash;
+		m_lineDirty[line] = 1;
+	}
+}
+
+void DirtyLineTracker::Update(UINT height)
+{
+	m_ranges.clear();
+
+	if (m_lineHashes.size() != height)
+		Reset(height);
+
+	for (UINT y = 0; y < height; y++)
+	{
+		if (!m_allDirty && !m_lineDirty[y])
+			continue;
+
+		m_lineDirty[y] = 0;
+
+		if (!m_ranges.empty() && m_ranges.back().firstLine + m_ranges.back().numLines == y)
+		{
+			m_ranges.back().numLines++;
+		}
+		else
+		{
+			Range_t range;
+			range.firstLine = y;
+			range.numLines = 1;
+			m_ranges.push_back(range);
+		}
+	}
+
+	m_allDirty = false;
+}
+
+// 4 independent lanes, so the multiplies don't form one long dependency chain
+uint64_t DirtyLineTracker::HashLine(const uint32_t* pPixels, UINT width)
+{
+	const uint64_t kPrime = 0x9E3779B97F4A7C15ULL;
+	uint64_t h0 = 1, h1 = 2, h2 = 3, h3 = 4;
+
+	UINT i = 0;
+	for (; i + 4 <= width; i += 4)
+	{
+		h0 = (h0 ^ pPixels[i+0]) * kPrime;
+		h1 = (h1 ^ pPixels[i+1]) * kPrime;
+		h2 = (h2 ^ pPixels[i+2]) * kPrime;
+		h3 = (h3 ^ pPixels[i+3]) * kPrime;
+	}
+	for (; i < width; i++)
+		h0 = (h0 ^ pPixels[i]) * kPrime;
+
+	uint64_t hash = h0 ^ (h1 << 1 | h1 >> 63) ^ (h2 << 2 | h2 >> 62) ^ (h3 << 3 | h3 >> 61);
+	return hash ^ (hash >> 29);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Finds the lines of a frame that changed since the previous frame, as top-down ranges.
+// . The renderer (NTSC.cpp) calls LineRendered() as it finishes each line, while the line is still in the cache:
+//   only a small hash per line is kept, rather than a copy of the previous frame to compare against.
+// . NB. the NTSC renderer redraws every line of every frame, and doesn't write strictly within the current scanline
+//   (eg. TV styles blend into the in-between line above), so a line is only reported once it can't be written again this frame.
+
+class DirtyLineTracker
+{
+public:
+	DirtyLineTracker(void) : m_allDirty(true) {}
+
+	struct Range_t
+	{
+		UINT firstLine;
+		UINT numLines;
+	};
+
+	// The next Update() reports every line as dirty (eg. after the framebuffer was cleared)
+	void Reset(UINT height);
+
+	// line: top-down, relative to the borderless area. pPixels: the line's first pixel
+	void LineRendered(UINT line, const uint32_t* pPixels, UINT width);
+
+	// Gathers the lines that changed since the previous Update(). A new height is the same as Reset()
+	void Update(UINT height);
+
+	const std::vector<Range_t>& GetRanges(void) const { return m_ranges; }
+
+private:
+	static uint64_t HashLine(const uint32_t* pPixels, UINT width);
+
+	std::vector<uint64_t> m_lineHashes;	// each line as last rendered
+	std::vector<uint8_t> m_lineDirty;
+	bool m_allDirty;
+	std::vector<Range_t> m_ranges;
+};
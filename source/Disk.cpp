@@ -45,6 +45,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "../resource/resource.h"
 
+#include <chrono>
+
 // About m_enhanceDisk:
 // . In general m_enhanceDisk==false is used for authentic disk access speed, whereas m_enhanceDisk==true is for enhanced speed.
 // Details:
@@ -76,6 +78,7 @@ Disk2InterfaceCard::Disk2InterfaceCard(UINT slot) :
 	m_deferredStepperAddress = 0;
 	m_deferredStepperCumulativeCycles = 0;
 
+	ResetStats();
 	ResetLogicStateSequencer();
 
 	// Debug:
@@ -295,6 +298,110 @@ void Disk2InterfaceCard::AllocTrack(const int drive, const UINT minSize/*=NIBBLE
 
 //===========================================================================
 
+void NibbleTrackCache::clear(void)
+{
+	for (UINT i = 0; i < kNumEntries; i++)
+	{
+		m_entries[i].quarterTrack = -1;
+		m_entries[i].lastUsed = 0;
+	}
+
+	m_useCounter = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
+bool NibbleTrackCache::Lookup(const int quarterTrack, const bool enhanceDisk, LPBYTE pTrackImageBuffer, int& nibbles, UINT& bitCount)
+{
+	for (UINT i = 0; i < kNumEntries; i++)
+	{
+		Entry_t& entry = m_entries[i];
+		if (entry.quarterTrack != quarterTrack || entry.enhanceDisk != enhanceDisk)
+			continue;
+
+		memcpy(pTrackImageBuffer, &entry.data[0], entry.nibbles);
+		nibbles = entry.nibbles;
+		bitCount = entry.bitCount;
+		entry.lastUsed = ++m_useCounter;
+		m_hits++;
+		return true;
+	}
+
+	m_misses++;
+	return false;
+}
+
+void NibbleTrackCache::Insert(const int quarterTrack, const UINT track, const bool enhanceDisk, const BYTE* pTrackImageBuffer, const int nibbles, const UINT bitCount)
+{
+	if (nibbles <= 0)
+		return;
+
+	// Replace an unused entry, else the least recently used one
+	UINT victim = 0;
+	for (UINT i = 0; i < kNumEntries; i++)
+	{
+		if (m_entries[i].quarterTrack < 0)
+		{
+			victim = i;
+			break;
+		}
+
+		if (m_entries[i].lastUsed < m_entries[victim].lastUsed)
+			victim = i;
+	}
+
+	Entry_t& entry = m_entries[victim];
+	entry.quarterTrack = quarterTrack;
+	entry.track = track;
+	entry.enhanceDisk = enhanceDisk;
+	entry.nibbles = nibbles;
+	entry.bitCount = bitCount;
+	entry.lastUsed = ++m_useCounter;
+	entry.data.assign(pTrackImageBuffer, pTrackImageBuffer + nibbles);
+}
+
+// Several quarter-tracks can map to the same image track (see CImageBase::PhaseToTrack()), so drop them all
+void NibbleTrackCache::InvalidateTrack(const UINT track)
+{
+	for (UINT i = 0; i < kNumEntries; i++)
+	{
+		if (m_entries[i].quarterTrack >= 0 && m_entries[i].track == track)
+			m_entries[i].quarterTrack = -1;
+	}
+}
+
+void Disk2InterfaceCard::GetTrackCacheStats(const int drive, UINT64& hits, UINT64& misses)
+{
+	hits = m_floppyDrive[drive].m_disk.m_trackCache.GetHits();
+	misses = m_floppyDrive[drive].m_disk.m_trackCache.GetMisses();
+}
+
+// For -disk-stats (and the debugger): a single JSON object
+std::string Disk2InterfaceCard::GetStatsJson(void)
+{
+	UINT64 cacheHits = 0, cacheMisses = 0;
+	for (UINT i = DRIVE_1; i < NUM_DRIVES; i++)
+	{
+		UINT64 hits, misses;
+		GetTrackCacheStats(i, hits, misses);
+		cacheHits += hits;
+		cacheMisses += misses;
+	}
+
+	return StrFormat("{\"slot\": %u, \"type\": \"Disk][\", \"trackChanges\": %llu, \"trackReads\": %llu, \"trackCacheHits\": %llu, \"trackCacheMisses\": %llu, "
+		"\"nibblesRead\": %llu, \"nibblesWritten\": %llu, \"writeBacks\": %llu, \"hostIOMicroseconds\": %llu, \"motorOnCycles\": %llu, \"fullSpeedCycles\": %llu, "
+		"\"fastLoadBytesRead\": %llu, \"fastLoadBytesWritten\": %llu}",
+		m_slot,
+		(unsigned long long)m_stats.trackChanges, (unsigned long long)m_stats.trackReads,
+		(unsigned long long)cacheHits, (unsigned long long)cacheMisses,
+		(unsigned long long)m_stats.nibblesRead, (unsigned long long)m_stats.nibblesWritten,
+		(unsigned long long)m_stats.writeBacks, (unsigned long long)m_stats.hostIOMicroseconds,
+		(unsigned long long)m_stats.motorOnCycles, (unsigned long long)m_stats.fullSpeedCycles,
+		(unsigned long long)m_stats.fastLoadBytesRead, (unsigned long long)m_stats.fastLoadBytesWritten);
+}
+
+//===========================================================================
+
 void Disk2InterfaceCard::ReadTrack(const int drive, ULONG uExecutedCycles)
 {
 	if (!IsDriveValid( drive ))
@@ -338,13 +445,44 @@ void Disk2InterfaceCard::ReadTrack(const int drive, ULONG uExecutedCycles)
 		const UINT32 currentBitPosition = pFloppy->m_bitOffset;
 		const UINT32 currentBitTrackLength = pFloppy->m_bitCount;
 
-		ImageReadTrack(
-			pFloppy->m_imagehandle,
-			pDrive->m_phasePrecise,
-			pFloppy->m_trackimage,
-			&pFloppy->m_nibbles,
-			&pFloppy->m_bitCount,
-			m_enhanceDisk);
+		if (ImageIsWOZ(pFloppy->m_imagehandle))
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			ImageReadTrack(
+				pFloppy->m_imagehandle,
+				pDrive->m_phasePrecise,
+				pFloppy->m_trackimage,
+				&pFloppy->m_nibbles,
+				&pFloppy->m_bitCount,
+				m_enhanceDisk);
+
+			m_stats.trackReads++;
+			m_stats.hostIOMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+		else
+		{
+			const int quarterTrack = (int)(pDrive->m_phasePrecise * 2 + 0.5f);	// m_phasePrecise is in half-phase (ie. quarter-track) steps
+			if (!pFloppy->m_trackCache.Lookup(quarterTrack, m_enhanceDisk, pFloppy->m_trackimage, pFloppy->m_nibbles, pFloppy->m_bitCount))
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+				ImageReadTrack(
+					pFloppy->m_imagehandle,
+					pDrive->m_phasePrecise,
+					pFloppy->m_trackimage,
+					&pFloppy->m_nibbles,
+					&pFloppy->m_bitCount,
+					m_enhanceDisk);
+
+				m_stats.hostIOMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+				pFloppy->m_trackCache.Insert(quarterTrack,
+					ImagePhaseToTrack(pFloppy->m_imagehandle, pDrive->m_phasePrecise, false),
+					m_enhanceDisk, pFloppy->m_trackimage, pFloppy->m_nibbles, pFloppy->m_bitCount);
+				m_stats.trackReads++;
+			}
+		}
 
 		if (!ImageIsWOZ(pFloppy->m_imagehandle))
 		{
@@ -380,7 +518,26 @@ void Disk2InterfaceCard::ReadTrack(const int drive, ULONG uExecutedCycles)
 			pFloppy->m_extraCycles = 0.0;
 			pDrive->m_headWindow = 0;
 
-			FindTrackSeamWOZ(*pFloppy, pDrive->m_phasePrecise/2);
+			// The seam only depends on the track's bitstream, so only scan for it once per (quarter) track
+			const UINT quarterTrack = (UINT)(pDrive->m_phasePrecise * 2);	// same as CWOZ2Image::Read()
+			FloppyDisk::TrackSeam_t* pSeam = (quarterTrack < FloppyDisk::kNumQuarterTracks) ? &pFloppy->m_trackSeam[quarterTrack] : NULL;
+
+			if (pSeam && pSeam->generation == pFloppy->m_trackSeamGeneration)
+			{
+				pFloppy->m_longestSyncFFBitOffsetStart = pSeam->longestSyncFFBitOffsetStart;
+				pFloppy->m_longestSyncFFRunLength = pSeam->longestSyncFFRunLength;
+			}
+			else
+			{
+				FindTrackSeamWOZ(*pFloppy, pDrive->m_phasePrecise/2);
+
+				if (pSeam)
+				{
+					pSeam->generation = pFloppy->m_trackSeamGeneration;
+					pSeam->longestSyncFFBitOffsetStart = pFloppy->m_longestSyncFFBitOffsetStart;
+					pSeam->longestSyncFFRunLength = pFloppy->m_longestSyncFFRunLength;
+				}
+			}
 		}
 
 		pFloppy->m_trackimagedata = (pFloppy->m_nibbles != 0);
@@ -400,6 +557,12 @@ void Disk2InterfaceCard::EjectDiskInternal(const int drive)
 	{
 		FlushCurrentTrack(drive);
 
+		const UINT64 cacheHits = pFloppy->m_trackCache.GetHits();
+		const UINT64 cacheMisses = pFloppy->m_trackCache.GetMisses();
+		if (cacheHits + cacheMisses)
+			LogFileOutput("Disk: Track cache for %s: hits=%u, misses=%u\n", pFloppy->m_fullname.c_str(), (UINT)cacheHits, (UINT)cacheMisses);
+		pFloppy->m_trackCache.clear();
+
 		ImageClose(pFloppy->m_imagehandle);
 		pFloppy->m_imagehandle = NULL;
 	}
@@ -459,11 +622,18 @@ void Disk2InterfaceCard::WriteTrack(const int drive)
 #if LOG_DISK_TRACKS
 		LOG_DISK("track $%s write\r\n", GetCurrentTrackString().c_str());
 #endif
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
 		ImageWriteTrack(
 			pFloppy->m_imagehandle,
 			pDrive->m_phasePrecise,
 			pFloppy->m_trackimage,
 			pFloppy->m_nibbles);
+
+		m_stats.writeBacks++;
+		m_stats.hostIOMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		pFloppy->m_trackCache.InvalidateTrack(ImagePhaseToTrack(pFloppy->m_imagehandle, pDrive->m_phasePrecise, false));
 	}
 
 	pFloppy->m_trackimagedirty = false;
@@ -479,6 +649,249 @@ void Disk2InterfaceCard::FlushCurrentTrack(const int drive)
 
 //===========================================================================
 
+// Fast-load: opt-in traps on the DOS 3.3 RWTS & ProDOS Disk II driver entry points
+// . The whole sector read/write is done directly on the image, and then an RTS is emulated
+// . Anything unexpected (eg. unknown DOS, copy-protection, seek/format, WOZ or NIB images) returns 0, so the real code runs instead
+
+static const WORD kRWTSEntry = Disk2CardManager::kFastLoadRWTSEntry;
+static const WORD kRWTSInterleave = 0xBFB8;	// DOS 3.3: logical to physical sector
+
+static const BYTE kRWTSSignature[] = {	// $BD00: STY $48 / STA $49 / LDY #2 / STY $06F8 / LDY #4 / STY $04F8 / LDY #1 / LDA ($48),Y / TAX
+	0x84,0x48, 0x85,0x49, 0xA0,0x02, 0x8C,0xF8,0x06, 0xA0,0x04, 0x8C,0xF8,0x04, 0xA0,0x01, 0xB1,0x48, 0xAA
+};
+
+static const BYTE kProDOSPhysicalSector[16] = {0,2,4,6,8,10,12,14,1,3,5,7,9,11,13,15};	// ProDOS-order sector (in track) to physical
+
+// Apple II's MMU could be setup so that read & write memory is different, so can't just use 'mem'
+static bool FastLoadWriteMemory(WORD addr, BYTE value)
+{
+	LPBYTE page = memwrite[addr >> 8];
+	if (!page)	// I/O space or ROM
+		return false;
+
+	memdirty[addr >> 8] = 0xFF;
+	page[addr & 0xff] = value;
+	return true;
+}
+
+static bool FastLoadCopyToMemory(WORD addr, const BYTE* pSrc, UINT size)
+{
+	for (UINT i = 0; i < size; i++)
+	{
+		if (!FastLoadWriteMemory(addr + i, pSrc[i]))
+			return false;
+	}
+	return true;
+}
+
+static void FastLoadCopyFromMemory(WORD addr, BYTE* pDst, UINT size)
+{
+	for (UINT i = 0; i < size; i++)
+		pDst[i] = mem[(WORD)(addr + i)];
+}
+
+// Return from the trapped subroutine: A=0, C=0 (ie. no error)
+static void FastLoadReturnOK(void)
+{
+	regs.a = 0;
+	regs.ps = (regs.ps & ~(AF_CARRY | AF_SIGN)) | AF_ZERO;
+
+	regs.sp = (regs.sp >= 0x1FF) ? 0x100 : regs.sp + 1;
+	const BYTE lo = mem[regs.sp];
+	regs.sp = (regs.sp >= 0x1FF) ? 0x100 : regs.sp + 1;
+	const BYTE hi = mem[regs.sp];
+	regs.pc = ((hi << 8) | lo) + 1;
+}
+
+// Returns the # cycles to charge, or 0 if the trap doesn't apply
+UINT Disk2InterfaceCard::FastLoadTrap(WORD pc, UINT cyclesPerSector)
+{
+	if (m_is13SectorFirmware)
+		return 0;
+
+	if (pc == kRWTSEntry)
+		return FastLoadRWTS(cyclesPerSector);
+
+	if (pc >= 0xD000)
+		return FastLoadProDOS(pc, cyclesPerSector);
+
+	return 0;
+}
+
+bool Disk2InterfaceCard::IsFastLoadDrive(const int drive)
+{
+	if (!IsDriveValid(drive) || !m_floppyDrive[drive].m_isConnected)
+		return false;
+
+	ImageInfo* pImageInfo = m_floppyDrive[drive].m_disk.m_imagehandle;
+	return pImageInfo && !ImageIsWOZ(pImageInfo);
+}
+
+UINT Disk2InterfaceCard::FastLoadRWTS(UINT cyclesPerSector)
+{
+	if (memcmp(&mem[kRWTSEntry], kRWTSSignature, sizeof(kRWTSSignature)) != 0)
+		return 0;
+
+	// Sanity check the interleave table: must be a permutation of 0..15
+	UINT sectorsSeen = 0;
+	for (UINT i = 0; i < 16; i++)
+	{
+		const BYTE physical = mem[kRWTSInterleave + i];
+		if (physical >= 16)
+			return 0;
+		sectorsSeen |= 1 << physical;
+	}
+	if (sectorsSeen != 0xFFFF)
+		return 0;
+
+	const WORD iob = (regs.a << 8) | regs.y;
+	const BYTE* pIOB = &mem[iob];
+
+	if (pIOB[0x00] != 0x01 || pIOB[0x01] != m_slot * 16)
+		return 0;
+
+	const BYTE driveNum = pIOB[0x02];
+	if (driveNum != 1 && driveNum != 2)
+		return 0;
+
+	const int drive = driveNum - 1;
+	if (!IsFastLoadDrive(drive))
+		return 0;
+
+	ImageInfo* pImageInfo = m_floppyDrive[drive].m_disk.m_imagehandle;
+	const BYTE volume = ImageGetVolumeNumber(pImageInfo);
+	const BYTE command = pIOB[0x0C];
+	const UINT track = pIOB[0x04];
+	const UINT sector = pIOB[0x05];
+	const WORD buffer = pIOB[0x08] | (pIOB[0x09] << 8);
+
+	if (pIOB[0x03] != 0 && pIOB[0x03] != volume)	// let RWTS report the volume mismatch
+		return 0;
+	if (command != 1 && command != 2)				// seek & format: use RWTS
+		return 0;
+	if (sector >= 16 || track >= ImageGetNumTracks(pImageInfo))
+		return 0;
+	if (command == 2 && m_floppyDrive[drive].m_disk.m_bWriteProtected)	// let RWTS report write-protect
+		return 0;
+
+	FlushCurrentTrack(drive);
+
+	const UINT physical = mem[kRWTSInterleave + sector];
+	BYTE sectorBuffer[256];
+
+	if (command == 1)
+	{
+		if (!ImageReadPhysicalSector(pImageInfo, track, physical, sectorBuffer))
+			return 0;
+		if (!FastLoadCopyToMemory(buffer, sectorBuffer, sizeof(sectorBuffer)))
+			return 0;
+		m_stats.fastLoadBytesRead += sizeof(sectorBuffer);
+	}
+	else
+	{
+		FastLoadCopyFromMemory(buffer, sectorBuffer, sizeof(sectorBuffer));
+		if (!ImageWritePhysicalSector(pImageInfo, track, physical, sectorBuffer))
+			return 0;
+		FastLoadInvalidateTrack(drive, track);
+		m_stats.fastLoadBytesWritten += sizeof(sectorBuffer);
+	}
+
+	// Result: as RWTS would leave the IOB
+	FastLoadWriteMemory(iob + 0x0D, 0x00);			// no error
+	FastLoadWriteMemory(iob + 0x0E, volume);		// actual volume
+	FastLoadWriteMemory(iob + 0x0F, m_slot * 16);	// previous slot
+	FastLoadWriteMemory(iob + 0x10, driveNum);		// previous drive
+	FastLoadWriteMemory(0x2F, volume);
+
+	FastLoadReturnOK();
+	return cyclesPerSector;
+}
+
+UINT Disk2InterfaceCard::FastLoadProDOS(WORD pc, UINT cyclesPerSector)
+{
+	if (mem[Disk2CardManager::kFastLoadMLIEntry] != 0x4C)	// ProDOS MLI entry: JMP
+		return 0;
+
+	const BYTE unit = mem[0x43];
+	const UINT slot = (unit >> 4) & 7;
+	const int drive = unit >> 7;
+	if ((unit & 0x0F) || slot != m_slot)
+		return 0;
+
+	// Only trap the driver that ProDOS has registered for this slot & drive (DEVADR table)
+	const WORD devAdr = Disk2CardManager::kFastLoadDEVADR + drive * 0x10 + slot * 2;
+	if ((mem[devAdr] | (mem[devAdr + 1] << 8)) != pc)
+		return 0;
+
+	const BYTE command = mem[0x42];
+	if (command != 1 && command != 2)	// status & format: use the driver
+		return 0;
+
+	if (!IsFastLoadDrive(drive))
+		return 0;
+	if (command == 2 && m_floppyDrive[drive].m_disk.m_bWriteProtected)	// let the driver report write-protect
+		return 0;
+
+	ImageInfo* pImageInfo = m_floppyDrive[drive].m_disk.m_imagehandle;
+	const WORD buffer = mem[0x44] | (mem[0x45] << 8);
+	const UINT block = mem[0x46] | (mem[0x47] << 8);
+	const UINT track = block >> 3;
+	if (track >= ImageGetNumTracks(pImageInfo))
+		return 0;
+
+	FlushCurrentTrack(drive);
+
+	BYTE blockBuffer[512];
+
+	for (UINT i = 0; i < 2; i++)
+	{
+		const UINT physical = kProDOSPhysicalSector[(block & 7) * 2 + i];
+
+		if (command == 1)
+		{
+			if (!ImageReadPhysicalSector(pImageInfo, track, physical, &blockBuffer[i * 256]))
+				return 0;
+		}
+		else
+		{
+			FastLoadCopyFromMemory(buffer + i * 256, &blockBuffer[i * 256], 256);
+		}
+	}
+
+	if (command == 1)
+	{
+		if (!FastLoadCopyToMemory(buffer, blockBuffer, sizeof(blockBuffer)))
+			return 0;
+		m_stats.fastLoadBytesRead += sizeof(blockBuffer);
+	}
+	else
+	{
+		for (UINT i = 0; i < 2; i++)
+		{
+			const UINT physical = kProDOSPhysicalSector[(block & 7) * 2 + i];
+			if (!ImageWritePhysicalSector(pImageInfo, track, physical, &blockBuffer[i * 256]))
+				return 0;
+		}
+		FastLoadInvalidateTrack(drive, track);
+		m_stats.fastLoadBytesWritten += sizeof(blockBuffer);
+	}
+
+	FastLoadReturnOK();
+	return cyclesPerSector * 2;
+}
+
+// The image was written behind the nibblized track's back, so force it to be re-read
+void Disk2InterfaceCard::FastLoadInvalidateTrack(const int drive, const UINT track)
+{
+	FloppyDisk& floppy = m_floppyDrive[drive].m_disk;
+	floppy.m_trackCache.InvalidateTrack(track);
+
+	if (ImagePhaseToTrack(floppy.m_imagehandle, m_floppyDrive[drive].m_phasePrecise, false) == track)
+		floppy.m_trackimagedata = false;
+}
+
+//===========================================================================
+
 void Disk2InterfaceCard::Boot(void)
 {
 	// THIS FUNCTION RELOADS A PROGRAM IMAGE IF ONE IS LOADED IN DRIVE ONE.
@@ -646,6 +1059,7 @@ void Disk2InterfaceCard::ControlStepperDeferred(void)
 		FlushCurrentTrack(m_currDrive);
 		pDrive->m_phasePrecise = newPhasePrecise;
 		pFloppy->m_trackimagedata = false;
+		m_stats.trackChanges++;
 		m_formatTrack.DriveNotWritingTrack();
 		GetFrame().FrameDrawDiskStatus();	// Show track status (GH#201)
 	}
@@ -803,7 +1217,8 @@ void Disk2InterfaceCard::GetLightStatus(Disk_Status_e *pDisk1Status, Disk_Status
 //===========================================================================
 
 // Pre: pathname likely to include path (but can also just be filename)
-ImageError_e Disk2InterfaceCard::InsertDisk(const int drive, const std::string& pathname, const bool bForceWriteProtected, const bool bCreateIfNecessary)
+// Pre: filenameInZip selects the zip archive's entry to mount (or "" for the first disk image)
+ImageError_e Disk2InterfaceCard::InsertDisk(const int drive, const std::string& pathname, const bool bForceWriteProtected, const bool bCreateIfNecessary, const std::string& filenameInZip /*=""*/)
 {
 	FloppyDrive* pDrive = &m_floppyDrive[drive];
 	FloppyDisk* pFloppy = &pDrive->m_disk;
@@ -830,22 +1245,26 @@ ImageError_e Disk2InterfaceCard::InsertDisk(const int drive, const std::string&
 		if (uNameLen == 0 || uNameLen >= MAX_PATH)
 			strcpy_s(szCurrentPathname, MAX_PATH, pathname.c_str());
 
-		if (!strcmp(pszOtherPathname.c_str(), szCurrentPathname))
+		const bool isOtherZipEntry = !filenameInZip.empty() && filenameInZip != m_floppyDrive[!drive].m_disk.m_strFilenameInZip;
+
+		if (!strcmp(pszOtherPathname.c_str(), szCurrentPathname) && !isOtherZipEntry)
 		{
 			EjectDisk(!drive);
 			GetFrame().FrameRefreshStatus(DRAW_LEDS | DRAW_BUTTON_DRIVES | DRAW_DISK_STATUS);
 		}
 	}
 
+	pFloppy->m_strFilenameInZip = filenameInZip;
+
 	ImageError_e Error = ImageOpen(pathname,
 		&pFloppy->m_imagehandle,
 		&pFloppy->m_bWriteProtected,
 		bCreateIfNecessary,
 		pFloppy->m_strFilenameInZip);
 
-	if (Error == eIMAGE_ERROR_NONE && ImageIsMultiFileZip(pFloppy->m_imagehandle))
+	if (Error == eIMAGE_ERROR_NONE && filenameInZip.empty() && ImageIsMultiFileZip(pFloppy->m_imagehandle))
 	{
-		std::string strText = StrFormat("Only the first file in a multi-file zip is supported\n"
+		std::string strText = StrFormat("This multi-file zip has other disk images (swap to them from the drive's right-click menu)\n"
 										"Use disk image '%s' ?",
 										pFloppy->m_strFilenameInZip.c_str());
 		int nRes = GetFrame().FrameMessageBox(strText.c_str(), "Multi-Zip Warning", MB_ICONWARNING | MB_YESNO | MB_SETFOREGROUND);
@@ -865,6 +1284,8 @@ ImageError_e Disk2InterfaceCard::InsertDisk(const int drive, const std::string&
 
 		if (g_nAppMode == MODE_LOGO)
 			InitFirmware(GetCxRomPeripheral());
+
+		GetCardMgr().GetDisk2CardMgr().UpdateFastLoadTraps();
 	}
 	else
 	{
@@ -998,6 +1419,46 @@ bool Disk2InterfaceCard::IsWozImageInDrive(const int drive)
 
 //===========================================================================
 
+bool Disk2InterfaceCard::IsMultiFileZipInDrive(const int drive)
+{
+	if (!IsDriveValid(drive))
+		return false;
+
+	return ImageIsMultiFileZip(m_floppyDrive[drive].m_disk.m_imagehandle);
+}
+
+// Swap to the next (or previous) disk image in the drive's multi-file zip
+void Disk2InterfaceCard::InsertNextDiskInZip(const int drive, const bool next)
+{
+	if (!IsDriveValid(drive))
+		return;
+
+	FloppyDisk& floppy = m_floppyDrive[drive].m_disk;
+
+	std::vector<std::string> filenames;
+	ImageGetZipDiskImages(floppy.m_imagehandle, filenames);
+
+	const std::vector<std::string>::const_iterator it = std::find(filenames.begin(), filenames.end(), floppy.m_strFilenameInZip);
+	if (filenames.size() < 2 || it == filenames.end())
+		return;
+
+	const size_t numImages = filenames.size();
+	const size_t index = next ? ((it - filenames.begin()) + 1) % numImages
+							  : ((it - filenames.begin()) + numImages - 1) % numImages;
+
+	const std::string pathname = ImageGetPathname(floppy.m_imagehandle);	// copy, as InsertDisk() first ejects this disk
+	ImageError_e Error = InsertDisk(drive, pathname, IMAGE_USE_FILES_WRITE_PROTECT_STATUS, IMAGE_DONT_CREATE, filenames[index]);
+	if (Error != eIMAGE_ERROR_NONE)
+	{
+		NotifyInvalidImage(drive, pathname, Error);
+		EjectDisk(drive);
+	}
+
+	GetFrame().FrameRefreshStatus(DRAW_LEDS | DRAW_BUTTON_DRIVES | DRAW_DISK_STATUS);
+}
+
+//===========================================================================
+
 #if LOG_DISK_NIBBLES_WRITE
 bool Disk2InterfaceCard::LogWriteCheckSyncFF(ULONG& uCycleDelta)
 {
@@ -1107,6 +1568,7 @@ void __stdcall Disk2InterfaceCard::ReadWrite(WORD pc, WORD addr, BYTE bWrite, BY
 
 		m_floppyLatch = *(pFloppy->m_trackimage + pFloppy->m_byte);
 		m_diskLastReadLatchCycle = g_nCumulativeCycles;
+		m_stats.nibblesRead++;
 
 #if LOG_DISK_NIBBLES_READ
   #if LOG_DISK_NIBBLES_USE_RUNTIME_VAR
@@ -1126,6 +1588,7 @@ void __stdcall Disk2InterfaceCard::ReadWrite(WORD pc, WORD addr, BYTE bWrite, BY
 
 		*(pFloppy->m_trackimage + pFloppy->m_byte) = m_floppyLatch;
 		pFloppy->m_trackimagedirty = true;
+		m_stats.nibblesWritten++;
 
 		bool bIsSyncFF = false;
 #if LOG_DISK_NIBBLES_WRITE
@@ -1193,10 +1656,10 @@ UINT Disk2InterfaceCard::GetBitCellDelta(const ULONG uExecutedCycles)
 	else
 #endif
 	{
-		const double cycleDelta = (double)(g_nCumulativeCycles - m_diskLastCycle) + floppy.m_extraCycles;
-		const double bitTime = 0.125 * (double)optimalBitTiming;	// 125ns units
-		bitCellDelta = (UINT) floor( cycleDelta / bitTime );
-		floppy.m_extraCycles = (double)cycleDelta - ((double)bitCellDelta * bitTime);
+		// Integer maths in 1/8 cycle (125ns) units: optimalBitTiming is in 125ns units, so m_extraCycles is always a multiple of 1/8 cycle
+		const UINT64 cycleDelta8 = (UINT64)(g_nCumulativeCycles - m_diskLastCycle) * 8 + (UINT64)(floppy.m_extraCycles * 8.0);
+		bitCellDelta = (UINT)(cycleDelta8 / optimalBitTiming);
+		floppy.m_extraCycles = (double)(cycleDelta8 % optimalBitTiming) * 0.125;
 	}
 
 	// NB. actual m_diskLastCycle for the last bitCell is minus floppy.m_extraCycles
@@ -1386,6 +1849,166 @@ void __stdcall Disk2InterfaceCard::DataLatchReadWriteWOZ(WORD pc, WORD addr, BYT
 		GetFrame().FrameDrawDiskStatus();
 }
 
+// LSS read sequencing, 8 bit-cells at a time:
+// . ms_headBitsTable: (last 3 head window bits, next 8 track bits) -> 8 output bits, or invalid if a weak (random) bit would be read
+// . ms_lssByteTable: (latch delay, shift register, 8 output bits) -> new shift register, latch & latch delay
+// Weak bits, the track wrap and the track seam jitter are all handled by the bit-at-a-time loop.
+
+struct LSSHeadBits_t
+{
+	BYTE outputBits;
+	BYTE isValid;
+};
+
+struct LSSByteEntry_t
+{
+	BYTE shiftReg;
+	BYTE latch;
+	BYTE latchDelay;
+	BYTE latchUpdated;
+	BYTE nibbleLatched;		// latch was loaded with a nibble (b7=1) - at most once per 8 bit-cells
+	BYTE nibble;
+};
+
+static const int kLSSNumLatchDelays = 4;
+static const int kLSSLatchDelays[kLSSNumLatchDelays] = { 0, 3, 4, 7 };	// all reachable values: 7 -> 3 -> 0, and +4 if shiftReg==0
+
+static LSSHeadBits_t ms_headBitsTable[8][256];
+static LSSByteEntry_t ms_lssByteTable[kLSSNumLatchDelays][256][256];
+static bool ms_lssTablesValid = false;
+
+static int GetLSSLatchDelayIndex(const int latchDelay)
+{
+	for (int i = 0; i < kLSSNumLatchDelays; i++)
+	{
+		if (kLSSLatchDelays[i] == latchDelay)
+			return i;
+	}
+	return -1;
+}
+
+static void InitLSSByteTables(void)
+{
+	for (UINT prev = 0; prev < 8; prev++)
+	{
+		for (UINT bits = 0; bits < 256; bits++)
+		{
+			BYTE headWindow = prev;
+			BYTE outputBits = 0;
+			bool isValid = true;
+			for (int b = 7; b >= 0; b--)
+			{
+				headWindow = (headWindow << 1) | ((bits >> b) & 1);
+				if ((headWindow & 0xf) == 0)
+					isValid = false;
+				outputBits = (outputBits << 1) | ((headWindow >> 1) & 1);
+			}
+			ms_headBitsTable[prev][bits].outputBits = outputBits;
+			ms_headBitsTable[prev][bits].isValid = isValid;
+		}
+	}
+
+	// Same logic as the bit-at-a-time loop in DataLatchReadWOZ()
+	for (int d = 0; d < kLSSNumLatchDelays; d++)
+	{
+		for (UINT reg = 0; reg < 256; reg++)
+		{
+			for (UINT bits = 0; bits < 256; bits++)
+			{
+				LSSByteEntry_t& entry = ms_lssByteTable[d][reg][bits];
+				BYTE shiftReg = reg;
+				int latchDelay = kLSSLatchDelays[d];
+				memset(&entry, 0, sizeof(entry));
+
+				for (int b = 7; b >= 0; b--)
+				{
+					shiftReg = (shiftReg << 1) | ((bits >> b) & 1);
+
+					if (latchDelay)
+					{
+						latchDelay -= 4;
+						if (latchDelay < 0)
+							latchDelay = 0;
+						if (!shiftReg)
+							latchDelay += 4;
+					}
+
+					if (!latchDelay)
+					{
+						entry.latch = shiftReg;
+						entry.latchUpdated = 1;
+						if (shiftReg & 0x80)
+						{
+							entry.nibbleLatched = 1;
+							entry.nibble = shiftReg;
+							latchDelay = 7;
+							shiftReg = 0;
+						}
+					}
+				}
+
+				entry.shiftReg = shiftReg;
+				entry.latchDelay = latchDelay;
+				_ASSERT(GetLSSLatchDelayIndex(latchDelay) >= 0);
+			}
+		}
+	}
+
+	ms_lssTablesValid = true;
+}
+
+// Advance the LSS by 8 bit-cells, or return false if the bit-at-a-time loop must be used
+bool Disk2InterfaceCard::DataLatchReadByteWOZ(FloppyDrive& drive, FloppyDisk& floppy)
+{
+	// Track wrap within the next 8 bit-cells
+	if (floppy.m_bitOffset + 8 >= floppy.m_bitCount)
+		return false;
+
+	// Track seam within the next 8 bit-cells, and AddTrackSeamJitter() may slip a bit-cell
+	if (drive.m_phasePrecise >= (33.0 * 2) && floppy.m_longestSyncFFRunLength > 110
+		&& (UINT)(floppy.m_longestSyncFFBitOffsetStart - (int)floppy.m_bitOffset - 1) < 8)
+		return false;
+
+	const int latchDelayIdx = GetLSSLatchDelayIndex(m_latchDelay);
+	if (latchDelayIdx < 0)
+		return false;
+
+	const UINT shift = floppy.m_bitOffset & 7;
+	UINT bits = floppy.m_trackimage[floppy.m_byte] << 8;
+	if (shift)
+		bits |= floppy.m_trackimage[floppy.m_byte + 1];
+	const BYTE nextBits = (BYTE)(bits >> (8 - shift));
+
+	const LSSHeadBits_t& head = ms_headBitsTable[drive.m_headWindow & 7][nextBits];
+	if (!head.isValid)
+		return false;	// weak bit: needs rand()
+
+	const LSSByteEntry_t& entry = ms_lssByteTable[latchDelayIdx][m_shiftReg][head.outputBits];
+
+	drive.m_headWindow = nextBits;
+	m_shiftReg = entry.shiftReg;
+	m_latchDelay = entry.latchDelay;
+	if (entry.latchUpdated)
+		m_floppyLatch = entry.latch;
+	if (entry.nibbleLatched)
+		m_stats.nibblesRead++;
+	// NB. m_dbgLatchDelayedCnt isn't updated (it's only used for logging)
+
+#if LOG_DISK_NIBBLES_READ
+	if (entry.nibbleLatched)
+		m_formatTrack.DecodeLatchNibbleRead(entry.nibble);
+#endif
+
+	const UINT prevBitOffset = floppy.m_bitOffset;
+	floppy.m_bitOffset += 8;
+	UpdateBitStreamOffsets(floppy);
+
+	if ((UINT)(floppy.m_initialBitOffset - prevBitOffset - 1) < 8)	// same as IncBitStream()
+		floppy.m_revs++;
+
+	return true;
+}
+
 void Disk2InterfaceCard::DataLatchReadWOZ(WORD pc, WORD addr, UINT bitCellRemainder)
 {
 	// m_diskLastReadLatchCycle = g_nCumulativeCycles;	// Not used by WOZ (only by NIB)
@@ -1406,8 +2029,20 @@ void Disk2InterfaceCard::DataLatchReadWOZ(WORD pc, WORD addr, UINT bitCellRemain
 	}
 #endif
 
-	for (UINT i = 0; i < bitCellRemainder; i++)
+	if (!ms_lssTablesValid)
+		InitLSSByteTables();
+
+	UINT i = 0;
+	while (i < bitCellRemainder)
 	{
+		if (bitCellRemainder - i >= 8 && DataLatchReadByteWOZ(drive, floppy))
+		{
+			i += 8;
+			continue;
+		}
+
+		i++;
+
 		BYTE n = floppy.m_trackimage[floppy.m_byte];
 
 		drive.m_headWindow <<= 1;
@@ -1461,6 +2096,7 @@ void Disk2InterfaceCard::DataLatchReadWOZ(WORD pc, WORD addr, UINT bitCellRemain
 			{
 				m_latchDelay = 7;
 				m_shiftReg = 0;
+				m_stats.nibblesRead++;
 #if LOG_DISK_NIBBLES_READ
 				// May not actually be read by 6502 (eg. Prologue's CHKSUM 4&4 nibble pair), but still pass to the log's nibble reader
 				m_formatTrack.DecodeLatchNibbleRead(m_floppyLatch);
@@ -1468,7 +2104,7 @@ void Disk2InterfaceCard::DataLatchReadWOZ(WORD pc, WORD addr, UINT bitCellRemain
 #endif
 			}
 		}
-	} // for
+	} // while
 
 #if LOG_DISK_NIBBLES_READ
 	if (m_floppyLatch & 0x80)
@@ -1501,12 +2137,14 @@ void Disk2InterfaceCard::DataLoadWriteWOZ(WORD pc, WORD addr, UINT bitCellRemain
 		UpdateBitStreamPosition(floppy, bitCellRemainder);	// skip over bitCells before switching to write mode
 
 	m_writeStarted = true;
+	m_stats.nibblesWritten++;
 #if LOG_DISK_WOZ_LOADWRITE
 	LOG_DISK("load shiftReg with %02X (was: %02X)\n", m_floppyLatch, m_shiftReg);
 #endif
 	m_shiftReg = m_floppyLatch;
 
 	floppy.m_longestSyncFFBitOffsetStart = -1;	// invalidate the track seam location after a write
+	floppy.InvalidateTrackSeams();
 }
 
 void Disk2InterfaceCard::DataShiftWriteWOZ(WORD pc, WORD addr, ULONG uExecutedCycles)
@@ -1935,6 +2573,13 @@ void __stdcall Disk2InterfaceCard::SetWriteMode(WORD, WORD, BYTE, BYTE, ULONG uE
 
 void Disk2InterfaceCard::Update(const ULONG cycles)
 {
+	if (m_floppyMotorOn)
+	{
+		m_stats.motorOnCycles += cycles;
+		if (g_bFullSpeed)
+			m_stats.fullSpeedCycles += cycles;
+	}
+
 	int loop = NUM_DRIVES;
 	while (loop--)
 	{
@@ -2448,6 +3093,8 @@ void Disk2InterfaceCard::LoadSnapshotDriveUnit(YamlLoadHelper& yamlLoadHelper, U
 			bImageError = true;
 		else
 			memcpy(m_floppyDrive[unit].m_disk.m_trackimage, &track[0], track.size());
+
+		m_floppyDrive[unit].m_disk.InvalidateTrackSeams();	// track image may have unsaved writes
 	}
 
 	if (bImageError)
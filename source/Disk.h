@@ -42,6 +42,44 @@ const bool IMAGE_FORCE_WRITE_PROTECTED = true;
 const bool IMAGE_DONT_CREATE = false;
 const bool IMAGE_CREATE = true;
 
+// Small per-image LRU of nibblized tracks, keyed by quarter-track
+// . Avoids re-running NibblizeTrack() for .dsk/.po images each time the head steps back to a recently read track
+// . Entries are invalidated when their (whole) track is written back to the image
+class NibbleTrackCache
+{
+public:
+	NibbleTrackCache()
+	{
+		clear();
+	}
+
+	void clear(void);
+	bool Lookup(const int quarterTrack, const bool enhanceDisk, LPBYTE pTrackImageBuffer, int& nibbles, UINT& bitCount);
+	void Insert(const int quarterTrack, const UINT track, const bool enhanceDisk, const BYTE* pTrackImageBuffer, const int nibbles, const UINT bitCount);
+	void InvalidateTrack(const UINT track);
+
+	UINT64 GetHits(void) const { return m_hits; }
+	UINT64 GetMisses(void) const { return m_misses; }
+
+private:
+	struct Entry_t
+	{
+		int quarterTrack;		// -1 if unused
+		UINT track;
+		bool enhanceDisk;
+		int nibbles;
+		UINT bitCount;
+		UINT64 lastUsed;
+		std::vector<BYTE> data;
+	};
+
+	static const UINT kNumEntries = 8;
+	Entry_t m_entries[kNumEntries];
+	UINT64 m_useCounter;
+	UINT64 m_hits;
+	UINT64 m_misses;
+};
+
 class FloppyDisk
 {
 public:
@@ -73,8 +111,13 @@ public:
 		m_longestSyncFFBitOffsetStart = -1;
 		m_initialBitOffset = 0;
 		m_revs = 0;
+		m_trackCache.clear();
+		memset(m_trackSeam, 0, sizeof(m_trackSeam));
+		m_trackSeamGeneration = 1;
 	}
 
+	void InvalidateTrackSeams(void) { m_trackSeamGeneration++; }
+
 public:
 	std::string m_imagename;	// <FILENAME> (ie. no extension)
 	std::string m_fullname;	// <FILENAME.EXT> or <FILENAME.zip>  : This is persisted to the snapshot file
@@ -94,6 +137,19 @@ public:
 	int m_longestSyncFFBitOffsetStart;
 	UINT m_initialBitOffset;	// debug
 	UINT m_revs;				// debug
+	NibbleTrackCache m_trackCache;	// non-WOZ images only
+
+	// WOZ only: FindTrackSeamWOZ() result per quarter track, computed lazily on the first ReadTrack()
+	struct TrackSeam_t
+	{
+		UINT generation;		// only valid if == m_trackSeamGeneration
+		UINT longestSyncFFRunLength;
+		int longestSyncFFBitOffsetStart;
+	};
+
+	static const UINT kNumQuarterTracks = 160;	// WOZ: TMAP size
+	TrackSeam_t m_trackSeam[kNumQuarterTracks];
+	UINT m_trackSeamGeneration;	// bump to invalidate all of m_trackSeam[] (eg. after a write)
 };
 
 class FloppyDrive
@@ -154,7 +210,7 @@ public:
 	void GetFilenameAndPathForSaveState(std::string& filename, std::string& path);
 	void GetLightStatus (Disk_Status_e* pDisk1Status, Disk_Status_e* pDisk2Status);
 
-	ImageError_e InsertDisk(const int drive, const std::string& pathname, const bool bForceWriteProtected, const bool bCreateIfNecessary);
+	ImageError_e InsertDisk(const int drive, const std::string& pathname, const bool bForceWriteProtected, const bool bCreateIfNecessary, const std::string& filenameInZip = "");
 	void EjectDisk(const int drive);
 	void UnplugDrive(const int drive);
 
@@ -191,9 +247,31 @@ public:
 	void SetProtect(const int drive, const bool bWriteProtect);
 	bool IsDriveEmpty(const int drive);
 	bool IsWozImageInDrive(const int drive);
+	bool IsMultiFileZipInDrive(const int drive);
+	void InsertNextDiskInZip(const int drive, const bool next);
 
 	bool GetEnhanceDisk(void);
 	void SetEnhanceDisk(bool bEnhanceDisk);
+	void GetTrackCacheStats(const int drive, UINT64& hits, UINT64& misses);
+
+	struct Stats_t
+	{
+		UINT64 trackChanges;		// head moved to a different (quarter) track
+		UINT64 trackReads;			// via ImageReadTrack() (ie. not from the track cache)
+		UINT64 nibblesRead;			// latched by the data register
+		UINT64 nibblesWritten;
+		UINT64 writeBacks;			// dirty tracks written back to the image
+		UINT64 hostIOMicroseconds;	// in ImageReadTrack() & ImageWriteTrack() (ie. not track cache hits)
+		UINT64 motorOnCycles;
+		UINT64 fullSpeedCycles;		// motor on, and emulating at full speed
+		UINT64 fastLoadBytesRead;	// by the DOS 3.3 RWTS & ProDOS driver traps (so not via the nibble stream)
+		UINT64 fastLoadBytesWritten;
+	};
+
+	const Stats_t& GetStats(void) { return m_stats; }
+	void ResetStats(void) { memset(&m_stats, 0, sizeof(m_stats)); }
+	std::string GetStatsJson(void);
+	UINT FastLoadTrap(WORD pc, UINT cyclesPerSector);
 
 	static BYTE __stdcall IORead(WORD pc, WORD addr, BYTE bWrite, BYTE d, ULONG nExecutedCycles);
 	static BYTE __stdcall IOWrite(WORD pc, WORD addr, BYTE bWrite, BYTE d, ULONG nExecutedCycles);
@@ -212,6 +290,11 @@ private:
 	void UpdateBitStreamPosition(FloppyDisk& floppy, const ULONG bitCellDelta);
 	void UpdateBitStreamOffsets(FloppyDisk& floppy);
 	__forceinline void IncBitStream(FloppyDisk& floppy);
+	bool DataLatchReadByteWOZ(FloppyDrive& drive, FloppyDisk& floppy);
+	bool IsFastLoadDrive(const int drive);
+	UINT FastLoadRWTS(UINT cyclesPerSector);
+	UINT FastLoadProDOS(WORD pc, UINT cyclesPerSector);
+	void FastLoadInvalidateTrack(const int drive, const UINT track);
 	void DataLatchReadWOZ(WORD pc, WORD addr, UINT bitCellRemainder);
 	void DataLoadWriteWOZ(WORD pc, WORD addr, UINT bitCellRemainder);
 	void DataShiftWriteWOZ(WORD pc, WORD addr, ULONG uExecutedCycles);
@@ -301,6 +384,8 @@ private:
 	unsigned __int64 m_deferredStepperCumulativeCycles;
 	SyncEvent m_syncEvent;
 
+	Stats_t m_stats;
+
 	// Jitter (GH#930)
 	static const BYTE m_T00S00Pattern[];
 	UINT m_T00S00PatternIdx;
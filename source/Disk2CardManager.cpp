@@ -32,7 +32,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Disk2CardManager.h"
 #include "Core.h"
 #include "CardManager.h"
+#include "CPU.h"
 #include "Disk.h"
+#include "Memory.h"
 
 bool Disk2CardManager::IsConditionForFullSpeed(void)
 {
@@ -137,3 +139,77 @@ void Disk2CardManager::SetStepperDefer(bool defer)
 {
 	m_stepperDeferred = defer;
 }
+
+// Opt-in: emulate DOS 3.3 RWTS & ProDOS Disk II driver calls directly on the image (see Disk2InterfaceCard::FastLoadTrap())
+void Disk2CardManager::SetFastLoad(bool enable, UINT cyclesPerSector)
+{
+	m_fastLoad = enable;
+	m_fastLoadCyclesPerSector = cyclesPerSector;
+	CpuSetPCTrapHandler(enable ? FastLoadTrapHandler : NULL);
+	m_fastLoadTrapPCs.clear();
+	UpdateFastLoadTraps();
+}
+
+// Only the trapped PCs call FastLoadTrapHandler(), so every other opcode is rejected by a single bit test in the CPU:
+// . DOS 3.3's RWTS entry
+// . ProDOS's MLI entry, just to refresh these traps, as ProDOS (re)builds its DEVADR table after the disk has been inserted
+// . The ProDOS driver address in DEVADR for each Disk II slot & drive
+// Called when enabled, when a disk is inserted, and on each MLI call
+void Disk2CardManager::UpdateFastLoadTraps(void)
+{
+	std::vector<WORD> trapPCs;
+
+	if (m_fastLoad)
+	{
+		trapPCs.push_back(kFastLoadRWTSEntry);
+		trapPCs.push_back(kFastLoadMLIEntry);
+
+		for (UINT i = 0; i < NUM_SLOTS; i++)
+		{
+			if (GetCardMgr().QuerySlot(i) != CT_Disk2)
+				continue;
+
+			for (UINT drive = DRIVE_1; drive < NUM_DRIVES; drive++)
+			{
+				const WORD devAdr = kFastLoadDEVADR + drive * 0x10 + i * 2;
+				const WORD driver = mem[devAdr] | (mem[devAdr + 1] << 8);
+				if (driver >= 0xD000)	// ProDOS's Disk II driver lives in the LC (see Disk2InterfaceCard::FastLoadTrap())
+					trapPCs.push_back(driver);
+			}
+		}
+	}
+
+	if (trapPCs == m_fastLoadTrapPCs)
+		return;
+
+	for (UINT i = 0; i < m_fastLoadTrapPCs.size(); i++)
+		CpuSetPCTrap(m_fastLoadTrapPCs[i], false);
+	for (UINT i = 0; i < trapPCs.size(); i++)
+		CpuSetPCTrap(trapPCs[i], true);
+
+	m_fastLoadTrapPCs.swap(trapPCs);
+}
+
+UINT Disk2CardManager::FastLoadTrapHandler(WORD pc)
+{
+	Disk2CardManager& disk2CardMgr = GetCardMgr().GetDisk2CardMgr();
+
+	if (pc == kFastLoadMLIEntry)
+	{
+		if (mem[kFastLoadMLIEntry] == 0x4C)	// ProDOS MLI entry: JMP
+			disk2CardMgr.UpdateFastLoadTraps();
+		return 0;
+	}
+
+	for (UINT i = 0; i < NUM_SLOTS; i++)
+	{
+		if (GetCardMgr().QuerySlot(i) == CT_Disk2)
+		{
+			const UINT cycles = dynamic_cast<Disk2InterfaceCard&>(GetCardMgr().GetRef(i)).FastLoadTrap(pc, disk2CardMgr.m_fastLoadCyclesPerSector);
+			if (cycles)
+				return cycles;
+		}
+	}
+
+	return 0;
+}
@@ -3,7 +3,7 @@
 class Disk2CardManager
 {
 public:
-	Disk2CardManager(void) : m_stepperDeferred(true) {}
+	Disk2CardManager(void) : m_stepperDeferred(true), m_fastLoad(false), m_fastLoadCyclesPerSector(kFastLoadDefaultCyclesPerSector) {}
 	~Disk2CardManager(void) {}
 
 	bool IsConditionForFullSpeed(void);
@@ -16,7 +16,20 @@ public:
 	void GetFilenameAndPathForSaveState(std::string& filename, std::string& path);
 	void SetStepperDefer(bool defer);
 	bool IsStepperDeferred(void) { return m_stepperDeferred; }
+	void SetFastLoad(bool enable, UINT cyclesPerSector);
+	bool IsFastLoad(void) { return m_fastLoad; }
+	void UpdateFastLoadTraps(void);
+
+	static const UINT kFastLoadDefaultCyclesPerSector = 1000;
+	static const WORD kFastLoadRWTSEntry = 0xBD00;		// DOS 3.3
+	static const WORD kFastLoadMLIEntry = 0xBF00;		// ProDOS
+	static const WORD kFastLoadDEVADR = 0xBF10;			// ProDOS: device driver table, indexed by drive*0x10 + slot*2
 
 private:
+	static UINT FastLoadTrapHandler(WORD pc);
+
 	bool m_stepperDeferred;	// debug: can disable via cmd-line
+	bool m_fastLoad;
+	UINT m_fastLoadCyclesPerSector;
+	std::vector<WORD> m_fastLoadTrapPCs;
 };
@@ -39,6 +39,7 @@ static CHardDiskImageHelper sg_HardDiskImageHelper;
 //===========================================================================
 
 // Pre: *pWriteProtected_ already set to file's r/w status - see DiskInsert()
+// . strFilenameInZip: in = zip entry to use (or "" for the first disk image), out = zip entry used
 ImageError_e ImageOpen(	const std::string & pszImageFilename,
 						ImageInfo** ppImageInfo,
 						bool* pWriteProtected,
@@ -166,6 +167,30 @@ void ImageWriteTrack(	ImageInfo* const pImageInfo,
 
 //===========================================================================
 
+// Direct sector access for .dsk/.po images (ie. bypassing the nibblized track)
+bool ImageReadPhysicalSector(ImageInfo* const pImageInfo, UINT track, UINT sector, LPBYTE pSectorBuffer)
+{
+	if (!pImageInfo->pImageType->AllowRW())
+		return false;
+
+	return pImageInfo->pImageType->ReadPhysicalSector(pImageInfo, track, sector, pSectorBuffer);
+}
+
+bool ImageWritePhysicalSector(ImageInfo* const pImageInfo, UINT track, UINT sector, LPBYTE pSectorBuffer)
+{
+	if (!pImageInfo->pImageType->AllowRW() || pImageInfo->bWriteProtected)
+		return false;
+
+	return pImageInfo->pImageType->WritePhysicalSector(pImageInfo, track, sector, pSectorBuffer);
+}
+
+BYTE ImageGetVolumeNumber(ImageInfo* const pImageInfo)
+{
+	return pImageInfo->pImageType->GetVolumeNumber();
+}
+
+//===========================================================================
+
 bool ImageReadBlock(	ImageInfo* const pImageInfo,
 						UINT nBlock,
 						LPBYTE pBlockBuffer)
@@ -192,6 +217,34 @@ bool ImageWriteBlock(	ImageInfo* const pImageInfo,
 
 //===========================================================================
 
+bool ImageReadBlocks(	ImageInfo* const pImageInfo,
+						UINT nBlock,
+						UINT numBlocks,
+						LPBYTE pBlockBuffer)
+{
+	bool bRes = false;
+	if (pImageInfo->pImageType->AllowRW())
+		bRes = pImageInfo->pImageType->Read(pImageInfo, nBlock, numBlocks, pBlockBuffer);
+
+	return bRes;
+}
+
+//===========================================================================
+
+bool ImageWriteBlocks(	ImageInfo* const pImageInfo,
+						UINT nBlock,
+						UINT numBlocks,
+						LPBYTE pBlockBuffer)
+{
+	bool bRes = false;
+	if (pImageInfo->pImageType->AllowRW() && !pImageInfo->bWriteProtected)
+		bRes = pImageInfo->pImageType->Write(pImageInfo, nBlock, numBlocks, pBlockBuffer);
+
+	return bRes;
+}
+
+//===========================================================================
+
 UINT ImageGetNumTracks(ImageInfo* const pImageInfo)
 {
 	return pImageInfo ? pImageInfo->uNumTracks : 0;
@@ -202,6 +255,15 @@ bool ImageIsMultiFileZip(ImageInfo* const pImageInfo)
 	return pImageInfo ? (pImageInfo->uNumValidImagesInZip > 1) : false;
 }
 
+// Get the disk images in the zip archive (or none, if not a zip)
+void ImageGetZipDiskImages(ImageInfo* const pImageInfo, std::vector<std::string>& filenames)
+{
+	filenames.clear();
+
+	if (pImageInfo)
+		pImageInfo->pImageHelper->GetZipDiskImages(pImageInfo, filenames);
+}
+
 const std::string & ImageGetPathname(ImageInfo* const pImageInfo)
 {
 	static const std::string szEmpty;
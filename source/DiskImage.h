@@ -84,11 +84,17 @@ BOOL ImageBoot(ImageInfo* const pImageInfo);
 
 void ImageReadTrack(ImageInfo* const pImageInfo, float phase, LPBYTE pTrackImageBuffer, int* pNibbles, UINT* pBitCount, bool enhanceDisk);
 void ImageWriteTrack(ImageInfo* const pImageInfo, float phase, LPBYTE pTrackImageBuffer, int nNibbles);
+bool ImageReadPhysicalSector(ImageInfo* const pImageInfo, UINT track, UINT sector, LPBYTE pSectorBuffer);
+bool ImageWritePhysicalSector(ImageInfo* const pImageInfo, UINT track, UINT sector, LPBYTE pSectorBuffer);
+BYTE ImageGetVolumeNumber(ImageInfo* const pImageInfo);
 bool ImageReadBlock(ImageInfo* const pImageInfo, UINT nBlock, LPBYTE pBlockBuffer);
 bool ImageWriteBlock(ImageInfo* const pImageInfo, UINT nBlock, LPBYTE pBlockBuffer);
+bool ImageReadBlocks(ImageInfo* const pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer);
+bool ImageWriteBlocks(ImageInfo* const pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer);
 
 UINT ImageGetNumTracks(ImageInfo* const pImageInfo);
 bool ImageIsMultiFileZip(ImageInfo* const pImageInfo);
+void ImageGetZipDiskImages(ImageInfo* const pImageInfo, std::vector<std::string>& filenames);
 const std::string & ImageGetPathname(ImageInfo* const pImageInfo);
 UINT ImageGetImageSize(ImageInfo* const pImageInfo);
 bool ImageIsWOZ(ImageInfo* const pImageInfo);
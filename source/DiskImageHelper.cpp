@@ -36,8 +36,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "zlib.h"
 #include "unzip.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _MSC_VER
+#include <winioctl.h>
+#endif
+
 #include "CPU.h"
 #include "DiskImage.h"
+#include "DiskImageWriteBack.h"
+#include "DiskImageZipIndex.h"
 #include "Log.h"
 #include "Memory.h"
 #include "Interface.h"
@@ -58,6 +67,7 @@ ImageInfo::ImageInfo()
 	uNumValidImagesInZip = 0;
 	uNumTracks = 0;
 	pImageBuffer = NULL;
+	uImageBufferSize = 0;
 	pWOZTrackMap = NULL;
 	optimalBitTiming = 0;
 	bootSectorFormat = CWOZHelper::bootUnknown;
@@ -69,6 +79,7 @@ CImageBase::CImageBase()
 	, m_uVolumeNumber(DEFAULT_VOLUME_NUMBER)
 {
 	m_pWorkBuffer = new BYTE[TRACK_DENIBBLIZED_SIZE * 2];
+	memcpy(m_SectorNumber, ms_SectorNumber, sizeof(m_SectorNumber));
 }
 
 CImageBase::~CImageBase()
@@ -96,11 +107,11 @@ BYTE CImageBase::ms_DiskByte[0x40] =
 	0xF7,0xF9,0xFA,0xFB,0xFC,0xFD,0xFE,0xFF
 };
 
-BYTE CImageBase::ms_SectorNumber[NUM_SECTOR_ORDERS][0x10] =
+const BYTE CImageBase::ms_SectorNumber[NUM_SECTOR_ORDERS][0x10] =
 {
 	{0x00,0x08,0x01,0x09,0x02,0x0A,0x03,0x0B, 0x04,0x0C,0x05,0x0D,0x06,0x0E,0x07,0x0F},
 	{0x00,0x07,0x0E,0x06,0x0D,0x05,0x0C,0x04, 0x0B,0x03,0x0A,0x02,0x09,0x01,0x08,0x0F},
-	{0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}
+	{0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}	// SIMSYSTEM: set per image, in m_SectorNumber
 };
 
 //-----------------------------------------------------------------------------
@@ -132,6 +143,33 @@ bool CImageBase::WriteTrack(ImageInfo* pImageInfo, const int nTrack, LPBYTE pTra
 
 //-----------------------------------------------------------------------------
 
+// NB. Physical sector (as in the address field): the image's sector order maps this to the sector within the image's track
+bool CImageBase::ReadSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, SectorOrder_e SectorOrder, LPBYTE pSectorBuffer)
+{
+	if (track >= pImageInfo->uNumTracks || sector >= NUM_SECTORS)
+		return false;
+
+	const long offset = pImageInfo->uOffset + track * TRACK_DENIBBLIZED_SIZE + (m_SectorNumber[SectorOrder][sector] << 8);
+	memcpy(pSectorBuffer, &pImageInfo->pImageBuffer[offset], 256);
+
+	return true;
+}
+
+//-------------------------------------
+
+bool CImageBase::WriteSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, SectorOrder_e SectorOrder, LPBYTE pSectorBuffer)
+{
+	if (track >= pImageInfo->uNumTracks || sector >= NUM_SECTORS)
+		return false;
+
+	const long offset = pImageInfo->uOffset + track * TRACK_DENIBBLIZED_SIZE + (m_SectorNumber[SectorOrder][sector] << 8);
+	memcpy(&pImageInfo->pImageBuffer[offset], pSectorBuffer, 256);
+
+	return WriteImageData(pImageInfo, pSectorBuffer, 256, offset);
+}
+
+//-----------------------------------------------------------------------------
+
 bool CImageBase::ReadBlock(ImageInfo* pImageInfo, const int nBlock, LPBYTE pBlockBuffer)
 {
 	long Offset = pImageInfo->uOffset + nBlock * HD_BLOCK_SIZE;
@@ -172,15 +210,25 @@ bool CImageBase::WriteBlock(ImageInfo* pImageInfo, const int nBlock, LPBYTE pBlo
 	{
 		if (bGrowImageBuffer)
 		{
-			// Horribly inefficient! (Unzip to a normal file if you want better performance!)
+			// Grow the buffer in extents (at least doubling), rather than re-allocating for every appended block
+			// . the unused tail of the buffer is kept zeroed, so any skipped (ie. unwritten) blocks read as zero
 			const UINT uNewImageSize = offset+HD_BLOCK_SIZE;
-			BYTE* pNewImageBuffer = new BYTE [uNewImageSize];
+			const UINT uBufferSize = MAX(pImageInfo->uImageBufferSize, pImageInfo->uImageSize);
 
-			memcpy(pNewImageBuffer, pImageInfo->pImageBuffer, pImageInfo->uImageSize);
-			memset(&pNewImageBuffer[pImageInfo->uImageSize], 0, uNewImageSize-pImageInfo->uImageSize);	// Should always be HD_BLOCK_SIZE (so this is redundant)
+			if (uNewImageSize > uBufferSize)
+			{
+				UINT uNewBufferSize = MAX(uNewImageSize, uBufferSize * 2);
+				uNewBufferSize = (uNewBufferSize + HARDDISK_GROW_EXTENT - 1) / HARDDISK_GROW_EXTENT * HARDDISK_GROW_EXTENT;
+				BYTE* pNewImageBuffer = new BYTE [uNewBufferSize];
+
+				memcpy(pNewImageBuffer, pImageInfo->pImageBuffer, pImageInfo->uImageSize);
+				memset(&pNewImageBuffer[pImageInfo->uImageSize], 0, uNewBufferSize-pImageInfo->uImageSize);
+
+				delete [] pImageInfo->pImageBuffer;
+				pImageInfo->pImageBuffer = pNewImageBuffer;
+				pImageInfo->uImageBufferSize = uNewBufferSize;
+			}
 
-			delete [] pImageInfo->pImageBuffer;
-			pImageInfo->pImageBuffer = pNewImageBuffer;
 			pImageInfo->uImageSize = uNewImageSize;
 		}
 
@@ -193,97 +241,94 @@ bool CImageBase::WriteBlock(ImageInfo* pImageInfo, const int nBlock, LPBYTE pBlo
 		return false;
 	}
 
+	// NB. For a normal file, a write past the end extends it in one step: the skipped blocks aren't written, and read as zero
 	if (pImageInfo->FileType == eFileNormal)
 	{
 		if (bGrowImageBuffer)
-			pImageInfo->uImageSize += HD_BLOCK_SIZE;
+			pImageInfo->uImageSize = offset+HD_BLOCK_SIZE;
 	}
 
 	return true;
 }
 
-//-----------------------------------------------------------------------------
+//-------------------------------------
 
-bool CImageBase::WriteImageData(ImageInfo* pImageInfo, LPBYTE pSrcBuffer, const UINT uSrcSize, const long offset)
+// Multi-block read: a single host seek+read for a normal file
+bool CImageBase::ReadBlocks(ImageInfo* pImageInfo, const int nBlock, const UINT numBlocks, LPBYTE pBlockBuffer)
 {
+	const UINT size = numBlocks * HD_BLOCK_SIZE;
+	long Offset = pImageInfo->uOffset + nBlock * HD_BLOCK_SIZE;
+
 	if (pImageInfo->FileType == eFileNormal)
 	{
 		if (pImageInfo->hFile == INVALID_HANDLE_VALUE)
 			return false;
 
-		if (SetFilePointer(pImageInfo->hFile, offset, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-		{
-			DWORD err = GetLastError();
-			return false;
-		}
+		SetFilePointer(pImageInfo->hFile, Offset, NULL, FILE_BEGIN);
 
-		DWORD dwBytesWritten;
-		BOOL bRes = WriteFile(pImageInfo->hFile, pSrcBuffer, uSrcSize, &dwBytesWritten, NULL);
-		_ASSERT(dwBytesWritten == uSrcSize);
-		if (!bRes || dwBytesWritten != uSrcSize)
+		DWORD dwBytesRead;
+		BOOL bRes = ReadFile(pImageInfo->hFile, pBlockBuffer, size, &dwBytesRead, NULL);
+		if (!bRes || dwBytesRead != size)
 			return false;
+
+		return true;
 	}
-	else if (pImageInfo->FileType == eFileGZip)
+
+	for (UINT i = 0; i < numBlocks; i++)
 	{
-		// Write entire compressed image each time (dirty track change or dirty disk removal or a HDD block is written)
-		gzFile hGZFile = gzopen(pImageInfo->szFilename.c_str(), "wb");
-		if (hGZFile == NULL)
+		if (!ReadBlock(pImageInfo, nBlock + i, &pBlockBuffer[i * HD_BLOCK_SIZE]))
 			return false;
+	}
 
-		int nLen = gzwrite(hGZFile, pImageInfo->pImageBuffer, pImageInfo->uImageSize);
-		int nRes = gzclose(hGZFile);	// close before returning (due to error) to avoid resource leak
-		hGZFile = NULL;
+	return true;
+}
 
-		if (nLen != pImageInfo->uImageSize)
-			return false;
+//-------------------------------------
 
-		if (nRes != Z_OK)
-			return false;
-	}
-	else if (pImageInfo->FileType == eFileZip)
-	{
-		// Write entire compressed image each time (dirty track change or dirty disk removal or a HDD block is written)
-		// NB. Only support Zip archives with a single file
-		// - there is no delete in a zipfile, so would need to copy files from old to new zip file!
-		_ASSERT(pImageInfo->uNumEntriesInZip == 1);	// Should never occur, since image will be write-protected in CheckZipFile()
-		if (pImageInfo->uNumEntriesInZip > 1)
-			return false;
+// Multi-block write: a single host seek+write for a normal file, unless the image needs to grow
+bool CImageBase::WriteBlocks(ImageInfo* pImageInfo, const int nBlock, const UINT numBlocks, LPBYTE pBlockBuffer)
+{
+	const UINT size = numBlocks * HD_BLOCK_SIZE;
+	long offset = pImageInfo->uOffset + nBlock * HD_BLOCK_SIZE;
+
+	if (pImageInfo->FileType == eFileNormal && (UINT)offset + size <= pImageInfo->uImageSize)
+		return WriteImageData(pImageInfo, pBlockBuffer, size, offset);
 
-		zipFile hZipFile = zipOpen(pImageInfo->szFilename.c_str(), APPEND_STATUS_CREATE);
-		if (hZipFile == NULL)
+	for (UINT i = 0; i < numBlocks; i++)
+	{
+		if (!WriteBlock(pImageInfo, nBlock + i, &pBlockBuffer[i * HD_BLOCK_SIZE]))
 			return false;
+	}
 
-		int nOpenedFileInZip = ZIP_BADZIPFILE;
+	return true;
+}
 
-		try
-		{
-			nOpenedFileInZip = zipOpenNewFileInZip(hZipFile, pImageInfo->szFilenameInZip.c_str(), &pImageInfo->zipFileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_SPEED);
-			if (nOpenedFileInZip != ZIP_OK)
-				throw false;
-
-			int nRes = zipWriteInFileInZip(hZipFile, pImageInfo->pImageBuffer, pImageInfo->uImageSize);
-			if (nRes != ZIP_OK)
-				throw false;
-
-			nOpenedFileInZip = ZIP_BADZIPFILE;
-			nRes = zipCloseFileInZip(hZipFile);
-			if (nRes != ZIP_OK)
-				throw false;
-		}
-		catch (bool)
-		{
-			if (nOpenedFileInZip == ZIP_OK)
-				zipCloseFileInZip(hZipFile);
+//-----------------------------------------------------------------------------
 
-			zipClose(hZipFile, NULL);
+bool CImageBase::WriteImageData(ImageInfo* pImageInfo, LPBYTE pSrcBuffer, const UINT uSrcSize, const long offset)
+{
+	if (pImageInfo->FileType == eFileNormal)
+	{
+		if (pImageInfo->hFile == INVALID_HANDLE_VALUE)
+			return false;
 
+		if (SetFilePointer(pImageInfo->hFile, offset, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+		{
+			DWORD err = GetLastError();
 			return false;
 		}
 
-		int nRes = zipClose(hZipFile, NULL);
-		if (nRes != ZIP_OK)
+		DWORD dwBytesWritten;
+		BOOL bRes = WriteFile(pImageInfo->hFile, pSrcBuffer, uSrcSize, &dwBytesWritten, NULL);
+		_ASSERT(dwBytesWritten == uSrcSize);
+		if (!bRes || dwBytesWritten != uSrcSize)
 			return false;
 	}
+	else if (pImageInfo->FileType == eFileGZip || pImageInfo->FileType == eFileZip)
+	{
+		// pImageBuffer has already been updated: just queue the range - the compressed file is re-written in the background (once writes stop)
+		GetDiskImageWriteBack().Update(pImageInfo, offset, uSrcSize);
+	}
 	else
 	{
 		_ASSERT(0);
@@ -358,20 +403,23 @@ LPBYTE CImageBase::Code62(int sector)
 
 void CImageBase::Decode62(LPBYTE imageptr)
 {
-	// IF WE HAVEN'T ALREADY DONE SO, GENERATE A TABLE FOR CONVERTING
-	// DISK BYTES BACK INTO 6-BIT BYTES
-	static BOOL tablegenerated = 0;
-	static BYTE sixbitbyte[0x80];
-	if (!tablegenerated)
+	// GENERATE (ONCE) A TABLE FOR CONVERTING DISK BYTES BACK INTO 6-BIT BYTES
+	// . a function-local static is initialised thread-safely (eg. for DiskImageTool's workers)
+	struct SixBitByteTable_t
 	{
-		memset(sixbitbyte, 0, 0x80);
-		int loop = 0;
-		while (loop < 0x40) {
-			sixbitbyte[ms_DiskByte[loop]-0x80] = loop << 2;
-			loop++;
+		SixBitByteTable_t(void)
+		{
+			memset(table, 0, 0x80);
+			int loop = 0;
+			while (loop < 0x40) {
+				table[ms_DiskByte[loop]-0x80] = loop << 2;
+				loop++;
+			}
 		}
-		tablegenerated = 1;
-	}
+		BYTE table[0x80];
+	};
+	static const SixBitByteTable_t sixBitByteTable;
+	const BYTE* sixbitbyte = sixBitByteTable.table;
 
 	// USING OUR TABLE, CONVERT THE DISK BYTES BACK INTO 6-BIT BYTES
 	{
@@ -495,7 +543,7 @@ void CImageBase::DenibblizeTrack(LPBYTE trackimage, SectorOrder_e SectorOrder, i
 					uWriteDataFieldPrologueCount++;
 					_ASSERT(uWriteDataFieldPrologueCount <= NUM_SECTORS);
 #endif
-					Decode62(m_pWorkBuffer+(ms_SectorNumber[SectorOrder][sector] << 8));
+					Decode62(m_pWorkBuffer+(m_SectorNumber[SectorOrder][sector] << 8));
 				}
 				sector = 0;
 			}
@@ -555,7 +603,7 @@ DWORD CImageBase::NibblizeTrack(LPBYTE trackimagebuffer, SectorOrder_e SectorOrd
 		*(imageptr++) = 0xD5;
 		*(imageptr++) = 0xAA;
 		*(imageptr++) = 0xAD;
-		memcpy(imageptr, Code62(ms_SectorNumber[SectorOrder][sector]), 343);
+		memcpy(imageptr, Code62(m_SectorNumber[SectorOrder][sector]), 343);
 		imageptr += 343;
 		*(imageptr++) = 0xDE;
 		*(imageptr++) = 0xAA;
@@ -673,6 +721,16 @@ public:
 		WriteTrack(pImageInfo, track, m_pWorkBuffer, TRACK_DENIBBLIZED_SIZE);
 	}
 
+	virtual bool ReadPhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer)
+	{
+		return ReadSector(pImageInfo, track, sector, eDOSOrder, pSectorBuffer);
+	}
+
+	virtual bool WritePhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer)
+	{
+		return WriteSector(pImageInfo, track, sector, eDOSOrder, pSectorBuffer);
+	}
+
 	virtual bool AllowCreate(void) { return true; }
 	virtual UINT GetImageSizeForCreate(void) { m_uNumTracksInImage = TRACKS_STANDARD; return TRACK_DENIBBLIZED_SIZE * TRACKS_STANDARD; }
 
@@ -741,6 +799,16 @@ public:
 		WriteTrack(pImageInfo, track, m_pWorkBuffer, TRACK_DENIBBLIZED_SIZE);
 	}
 
+	virtual bool ReadPhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer)
+	{
+		return ReadSector(pImageInfo, track, sector, eProDOSOrder, pSectorBuffer);
+	}
+
+	virtual bool WritePhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer)
+	{
+		return WriteSector(pImageInfo, track, sector, eProDOSOrder, pSectorBuffer);
+	}
+
 	virtual eImageType GetType(void) { return eImagePO; }
 	virtual const char* GetCreateExtensions(void) { return ".po"; }
 	virtual const char* GetRejectExtensions(void) { return ".do;.iie;.nib;.prg;.woz"; }
@@ -888,6 +956,23 @@ public:
 		return WriteBlock(pImageInfo, nBlock, pBlockBuffer);
 	}
 
+	virtual bool Read(ImageInfo* pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer)
+	{
+		return ReadBlocks(pImageInfo, nBlock, numBlocks, pBlockBuffer);
+	}
+
+	virtual bool Write(ImageInfo* pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer)
+	{
+		if (pImageInfo->bWriteProtected)
+			return false;
+
+		return WriteBlocks(pImageInfo, nBlock, numBlocks, pBlockBuffer);
+	}
+
+	// A zero-length .hdv is created as a sparse 32MB volume (only the last block is written, and unwritten blocks read as zero)
+	virtual bool AllowCreate(void) { return true; }
+	virtual UINT GetImageSizeForCreate(void) { m_uNumTracksInImage = (HARDDISK_32M_SIZE - HD_BLOCK_SIZE) / TRACK_DENIBBLIZED_SIZE; return HARDDISK_32M_SIZE - HD_BLOCK_SIZE; }
+
 	virtual eImageType GetType(void) { return eImageHDV; }
 	virtual const char* GetCreateExtensions(void) { return ".hdv"; }
 	virtual const char* GetRejectExtensions(void) { return ".do;.iie;.prg"; }
@@ -975,7 +1060,7 @@ private:
 			if (found == 0xFF)
 				found = 0;
 
-			ms_SectorNumber[2][loop] = found;
+			m_SectorNumber[eSIMSYSTEMOrder][loop] = found;
 		}
 	}
 
@@ -1235,7 +1320,7 @@ public:
 			return;
 		}
 
-		// TODO: zip/gzip: combine the track & hdr writes so that the file is only compressed & written once
+		// NB. zip/gzip: both writes just update the image buffer, and DiskImageWriteBack then compresses & writes the file once
 		if (!UpdateWOZHeaderCRC(pImageInfo, this, hdrExtendedSize))
 		{
 			_ASSERT(0);
@@ -1367,7 +1452,7 @@ public:
 			return;
 		}
 
-		// TODO: zip/gzip: combine the track & hdr writes so that the file is only compressed & written once
+		// NB. zip/gzip: both writes just update the image buffer, and DiskImageWriteBack then compresses & writes the file once
 		if (!UpdateWOZHeaderCRC(pImageInfo, this, hdrExtendedSize))
 		{
 			_ASSERT(0);
@@ -1619,7 +1704,7 @@ ImageError_e CImageHelperBase::CheckGZipFile(LPCTSTR pszImageFilename, ImageInfo
 
 	DWORD dwSize = nLen;
 	DWORD dwOffset = 0;
-	CImageBase* pImageType = Detect(pImageInfo->pImageBuffer, dwSize, szExt, dwOffset, pImageInfo);
+	CImageBase* pImageType = DetectFile(pszImageFilename, pImageInfo->pImageBuffer, dwSize, szExt, dwOffset, pImageInfo);
 
 	if (!pImageType)
 		return eIMAGE_ERROR_UNSUPPORTED;
@@ -1634,151 +1719,146 @@ ImageError_e CImageHelperBase::CheckGZipFile(LPCTSTR pszImageFilename, ImageInfo
 
 //-------------------------------------
 
+// Only the entry being mounted is inflated (see DiskImageZipIndex)
+// . If strFilenameInZip is non-empty then mount that entry, else the first valid disk image
 ImageError_e CImageHelperBase::CheckZipFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, std::string& strFilenameInZip)
 {
-	unzFile hZipFile = unzOpen(pszImageFilename);
-	if (hZipFile == NULL)
-		return eIMAGE_ERROR_UNABLE_TO_OPEN_ZIP;
+	DiskImageZipIndex& zipIndex = GetDiskImageZipIndex();
+	std::lock_guard<std::mutex> lock(zipIndex.GetMutex());	// hold whilst using pIndex
 
-	unz_global_info global_info;
-	unz_file_info file_info;
-	char szFilename[MAX_PATH];
-	memset(szFilename, 0, sizeof(szFilename));
-	BYTE* pImageBuffer = NULL;
-	ImageInfo* pImageInfo2 = NULL;
+	const DiskImageZipIndex::Index_t* pIndex = NULL;
+	ImageError_e err = zipIndex.GetIndex(pszImageFilename, pIndex);
+	if (err != eIMAGE_ERROR_NONE)
+		return err;
+
+	for (UINT n=0; n<pIndex->entries.size(); n++)
+	{
+		if (pIndex->entries[n].uncompressedSize > GetMaxImageSize())
+			return eIMAGE_ERROR_BAD_SIZE;
+	}
+
+	const std::string requestedFilename = strFilenameInZip;
 	CImageBase* pImageType = NULL;
-	UINT numValidImages = 0;
 
-	try
+	// Only inflate up to the 1st valid disk image (or just the requested entry)
+	for (UINT n=0; n<pIndex->entries.size() && !pImageType; n++)
 	{
-		int nRes = unzGetGlobalInfo(hZipFile, &global_info);
-		if (nRes != UNZ_OK)
-			throw eIMAGE_ERROR_ZIP;
+		const DiskImageZipIndex::Entry_t& entry = pIndex->entries[n];
 
-		nRes = unzGoToFirstFile(hZipFile);
-		if (nRes != UNZ_OK)
-			throw eIMAGE_ERROR_ZIP;
+		if (!requestedFilename.empty() && entry.filename != requestedFilename)
+			continue;
 
-		for (UINT n=0; n<global_info.number_entry; n++)
-		{
-			if (n)
-			{
-				nRes = unzGoToNextFile(hZipFile);
-				if (nRes == UNZ_END_OF_LIST_OF_FILE)
-					break;
-				if (nRes != UNZ_OK)
-					throw eIMAGE_ERROR_ZIP;
-			}
+		BYTE* pImageBuffer = NULL;
+		UINT uSize = 0;
+		err = zipIndex.Inflate(pIndex, n, pImageBuffer, uSize);
+		if (err != eIMAGE_ERROR_NONE)
+			return err;
 
-			nRes = unzGetCurrentFileInfo(hZipFile, &file_info, szFilename, MAX_PATH, NULL, 0, NULL, 0);
-			if (nRes != UNZ_OK)
-				throw eIMAGE_ERROR_ZIP;
+		// Determine the file's extension and convert it to lowercase
+		TCHAR szExt[_MAX_EXT] = "";
+		GetCharLowerExt(szExt, entry.filename.c_str(), _MAX_EXT);
 
-			const UINT uFileSize = file_info.uncompressed_size;
-			if (uFileSize > GetMaxImageSize())
-				throw eIMAGE_ERROR_BAD_SIZE;
+		DWORD dwSize = uSize;
+		DWORD dwOffset = 0;
 
-			if (uFileSize == 0)	// skip directories or empty files
-				continue;
+		pImageInfo->pImageBuffer = pImageBuffer;
+		pImageType = Detect(pImageBuffer, dwSize, szExt, dwOffset, pImageInfo, eImageUNKNOWN);
 
-			//
+		if (!pImageType)
+		{
+			if (pImageInfo->pImageBuffer == pImageBuffer)	// avoid double-free when parent calls ImageClose()
+				pImageInfo->pImageBuffer = NULL;
+			delete [] pImageBuffer;
 
-			nRes = unzOpenCurrentFile(hZipFile);
-			if (nRes != UNZ_OK)
-				throw eIMAGE_ERROR_ZIP;
+			if (!requestedFilename.empty())
+				break;
+			continue;
+		}
 
-			BYTE* pImageBuffer = new BYTE[uFileSize];
-			int nLen = unzReadCurrentFile(hZipFile, pImageBuffer, uFileSize);
-			if (nLen < 0)
-			{
-				unzCloseCurrentFile(hZipFile);	// Must CloseCurrentFile before Close
-				throw eIMAGE_ERROR_UNSUPPORTED;
-			}
+		pImageInfo->szFilenameInZip = entry.filename;
+		memcpy(&pImageInfo->zipFileInfo.tmz_date, &entry.tmu_date, sizeof(entry.tmu_date));
+		pImageInfo->zipFileInfo.dosDate     = entry.dosDate;
+		pImageInfo->zipFileInfo.internal_fa = entry.internal_fa;
+		pImageInfo->zipFileInfo.external_fa = entry.external_fa;
+		pImageInfo->uNumEntriesInZip = pIndex->numEntries;
+		pImageInfo->pImageBuffer = pImageBuffer;
 
-			nRes = unzCloseCurrentFile(hZipFile);
-			if (nRes != UNZ_OK)
-				throw eIMAGE_ERROR_ZIP;
+		strFilenameInZip = entry.filename;
 
-			// Determine the file's extension and convert it to lowercase
-			TCHAR szExt[_MAX_EXT] = "";
-			GetCharLowerExt(szExt, szFilename, _MAX_EXT);
+		SetImageInfo(pImageInfo, eFileZip, dwOffset, pImageType, dwSize);
+	}
 
-			DWORD dwSize = nLen;
-			DWORD dwOffset = 0;
+	//
 
-			ImageInfo*& pImageInfoForDetect = !pImageInfo2 ? pImageInfo : pImageInfo2;
-			pImageInfoForDetect->pImageBuffer = pImageBuffer;
-			CImageBase* pNewImageType = Detect(pImageBuffer, dwSize, szExt, dwOffset, pImageInfoForDetect);
+	if (!pImageType)
+		return eIMAGE_ERROR_UNSUPPORTED;
 
-			if (pNewImageType)
-			{
-				numValidImages++;
+	const eImageType Type = pImageType->GetType();
+	if (Type == eImageAPL || Type == eImageIIE || Type == eImagePRG)
+		return eIMAGE_ERROR_UNSUPPORTED;
 
-				if (numValidImages == 1)
-				{
-					pImageType = pNewImageType;
+	if (pIndex->numEntries > 1)
+		pImageInfo->bWriteProtected = 1;	// Zip archives with multiple files are read-only (for now) - see WriteImageData() for zipfile
 
-					pImageInfo->szFilenameInZip = szFilename;
-					memcpy(&pImageInfo->zipFileInfo.tmz_date, &file_info.tmu_date, sizeof(file_info.tmu_date));
-					pImageInfo->zipFileInfo.dosDate     = file_info.dosDate;
-					pImageInfo->zipFileInfo.internal_fa = file_info.internal_fa;
-					pImageInfo->zipFileInfo.external_fa = file_info.external_fa;
-					pImageInfo->uNumEntriesInZip = global_info.number_entry;
-					pImageInfo->pImageBuffer = pImageBuffer;
+	// Count the other disk images from the central directory, rather than inflating them
+	std::vector<std::string> filenames;
+	GetZipDiskImages(pIndex, pImageInfo->szFilenameInZip, filenames);
+	pImageInfo->uNumValidImagesInZip = filenames.size();
 
-					pImageBuffer = NULL;
-					strFilenameInZip = szFilename;
+	return eIMAGE_ERROR_NONE;
+}
 
-					SetImageInfo(pImageInfo, eFileZip, dwOffset, pImageType, dwSize);
+//-------------------------------------
 
-					pImageInfo2 = new ImageInfo();	// use this dummy one for remaining entries in zip archive, as some members get overwritten during Detect()
-				}
-			}
+// Get the zip archive's disk images, in central directory order: the mounted entry, plus the others with a disk image extension
+void CImageHelperBase::GetZipDiskImages(const DiskImageZipIndex::Index_t* pIndex, const std::string& strFilenameInZip, std::vector<std::string>& filenames)
+{
+	filenames.clear();
 
-			if (pImageInfo->pImageBuffer == pImageBuffer)	// on error: avoid double-free when parent calls ImageClose()
-				pImageInfo->pImageBuffer = NULL;
-			delete [] pImageBuffer;
-			pImageBuffer = NULL;
-		}
-	}
-	catch (ImageError_e error)
+	std::string extensions = ";.2mg;.2img;";
+	for (UINT i=0; i<GetNumImages(); i++)
 	{
-		if (hZipFile)
-			unzClose(hZipFile);
+		const eImageType Type = GetImage(i)->GetType();
+		if (Type == eImageAPL || Type == eImageIIE || Type == eImagePRG)
+			continue;	// not supported in zips
 
-		delete [] pImageBuffer;
-		delete pImageInfo2;
-
-		return error;
+		extensions += GetImage(i)->GetCreateExtensions();
+		extensions += ";";
 	}
 
-	delete pImageInfo2;
+	for (UINT n=0; n<pIndex->entries.size(); n++)
+	{
+		const std::string& filename = pIndex->entries[n].filename;
 
-	int nRes = unzClose(hZipFile);
-	hZipFile = NULL;
-	if (nRes != UNZ_OK)
-		return eIMAGE_ERROR_ZIP;
+		TCHAR szExt[_MAX_EXT] = "";
+		GetCharLowerExt(szExt, filename.c_str(), _MAX_EXT);
 
-	//
+		if (filename == strFilenameInZip || (szExt[0] == '.' && extensions.find(std::string(";") + szExt + ";") != std::string::npos))
+			filenames.push_back(filename);
+	}
+}
 
-	if (!pImageType)
-		return eIMAGE_ERROR_UNSUPPORTED;
+bool CImageHelperBase::GetZipDiskImages(const ImageInfo* pImageInfo, std::vector<std::string>& filenames)
+{
+	filenames.clear();
 
-	const eImageType Type = pImageType->GetType();
-	if (Type == eImageAPL || Type == eImageIIE || Type == eImagePRG)
-		return eIMAGE_ERROR_UNSUPPORTED;
+	if (pImageInfo->FileType != eFileZip)
+		return false;
 
-	if (global_info.number_entry > 1)
-		pImageInfo->bWriteProtected = 1;	// Zip archives with multiple files are read-only (for now) - see WriteImageData() for zipfile
+	DiskImageZipIndex& zipIndex = GetDiskImageZipIndex();
+	std::lock_guard<std::mutex> lock(zipIndex.GetMutex());
 
-	pImageInfo->uNumValidImagesInZip = numValidImages;
+	const DiskImageZipIndex::Index_t* pIndex = NULL;
+	if (zipIndex.GetIndex(pImageInfo->szFilename.c_str(), pIndex) != eIMAGE_ERROR_NONE)
+		return false;
 
-	return eIMAGE_ERROR_NONE;
+	GetZipDiskImages(pIndex, pImageInfo->szFilenameInZip, filenames);
+	return true;
 }
 
 //-------------------------------------
 
-ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, const bool bCreateIfNecessary)
+ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, const bool bCreateIfNecessary, std::string& strFilenameInZip)
 {
 	// TRY TO OPEN THE IMAGE FILE
 
@@ -1841,18 +1921,38 @@ ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageIn
 		bool bTempDetectBuffer;
 		const UINT uDetectSize = GetMinDetectSize(dwSize, &bTempDetectBuffer);
 
-		pImageInfo->pImageBuffer = new BYTE [dwSize];
+		// If the image isn't kept in memory (ie. HDD) then just read the header: Detect() only needs this & the file size
+		const UINT uReadSize = bTempDetectBuffer ? MIN(uDetectSize, dwSize) : dwSize;
+		pImageInfo->pImageBuffer = new BYTE [bTempDetectBuffer ? uDetectSize : dwSize];
+		if (bTempDetectBuffer)
+			memset(pImageInfo->pImageBuffer, 0, uDetectSize);
 
 		DWORD dwBytesRead;
-		BOOL bRes = ReadFile(hFile, pImageInfo->pImageBuffer, dwSize, &dwBytesRead, NULL);
-		if (!bRes || dwSize != dwBytesRead)
+		BOOL bRes = ReadFile(hFile, pImageInfo->pImageBuffer, uReadSize, &dwBytesRead, NULL);
+		if (!bRes || uReadSize != dwBytesRead)
 		{
 			delete [] pImageInfo->pImageBuffer;
 			pImageInfo->pImageBuffer = NULL;
 			return eIMAGE_ERROR_BAD_SIZE;
 		}
 
-		pImageType = Detect(pImageInfo->pImageBuffer, dwSize, szExt, dwOffset, pImageInfo);
+		// A renamed .gz or .zip is still opened as one (so sniff its signature from the data just read)
+		const FileType_e fileType = DetectFileType(pImageInfo->pImageBuffer, uReadSize);
+		if (fileType != eFileNormal)
+		{
+			delete [] pImageInfo->pImageBuffer;
+			pImageInfo->pImageBuffer = NULL;
+			CloseHandle(hFile);
+			hFile = INVALID_HANDLE_VALUE;
+
+			return (fileType == eFileGZip) ? CheckGZipFile(pszImageFilename, pImageInfo)
+										   : CheckZipFile(pszImageFilename, pImageInfo, strFilenameInZip);
+		}
+
+		if (bTempDetectBuffer)
+			SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+
+		pImageType = DetectFile(pszImageFilename, pImageInfo->pImageBuffer, dwSize, szExt, dwOffset, pImageInfo);
 		if (bTempDetectBuffer)
 		{
 			delete [] pImageInfo->pImageBuffer;
@@ -1874,6 +1974,26 @@ ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageIn
 				bool res = WOZUpdateInfo(pImageInfo, dwOffset);
 				_ASSERT(res);
 			}
+			else if (pImageType->GetType() == eImageHDV)
+			{
+				// Sparse: extend the file with a single write of the last block, so the rest is a hole that reads as zero
+				// . on Windows the file must first be marked as sparse, else NTFS zero-fills the rest (which is still correct, just not sparse)
+#ifdef _MSC_VER
+				DWORD dwBytesReturned = 0;
+				if (!DeviceIoControl(hFile, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &dwBytesReturned, NULL))
+					LogFileOutput("Image: Failed to set %s as sparse: the file will be zero-filled\n", pszImageFilename);
+#endif
+
+				BYTE lastBlock[HD_BLOCK_SIZE];
+				memset(lastBlock, 0, HD_BLOCK_SIZE);
+
+				DWORD dwBytesWritten = 0;
+				BOOL res = SetFilePointer(hFile, dwSize - HD_BLOCK_SIZE, NULL, FILE_BEGIN) != INVALID_SET_FILE_POINTER;
+				if (res)
+					res = WriteFile(hFile, lastBlock, HD_BLOCK_SIZE, &dwBytesWritten, NULL);
+				if (!res || dwBytesWritten != HD_BLOCK_SIZE)
+					return eIMAGE_ERROR_FAILED_TO_INIT_ZEROLENGTH;
+			}
 			else
 			{
 				pImageInfo->pImageBuffer = new BYTE[dwSize];
@@ -1895,10 +2015,13 @@ ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageIn
 
 			// As a convenience, resize the file to the complete size (GH#506)
 			// - this also means that a save-state done mid-way through a format won't reference an image file with a partial size (GH#494)
-			DWORD dwBytesWritten = 0;
-			BOOL res = WriteFile(hFile, pImageInfo->pImageBuffer, dwSize, &dwBytesWritten, NULL); 
-			if (!res || dwBytesWritten != dwSize)
-				return eIMAGE_ERROR_FAILED_TO_INIT_ZEROLENGTH;
+			if (pImageType->GetType() != eImageHDV)	// already resized
+			{
+				DWORD dwBytesWritten = 0;
+				BOOL res = WriteFile(hFile, pImageInfo->pImageBuffer, dwSize, &dwBytesWritten, NULL); 
+				if (!res || dwBytesWritten != dwSize)
+					return eIMAGE_ERROR_FAILED_TO_INIT_ZEROLENGTH;
+			}
 		}
 	}
 
@@ -1916,11 +2039,92 @@ ImageError_e CImageHelperBase::CheckNormalFile(LPCTSTR pszImageFilename, ImageIn
 	}
 
 	SetImageInfo(pImageInfo, eFileNormal, dwOffset, pImageType, dwSize);
+
 	return eIMAGE_ERROR_NONE;
 }
 
 //-------------------------------------
 
+bool CImageHelperBase::ms_promptOnWOZCRCMismatch = true;
+
+//-------------------------------------
+
+// Sniff the archive signature at the start of the file
+FileType_e CImageHelperBase::DetectFileType(const BYTE* pData, const UINT size)
+{
+	if (size >= 2 && pData[0] == 0x1F && pData[1] == 0x8B)
+		return eFileGZip;
+	if (size >= 4 && pData[0] == 'P' && pData[1] == 'K' && pData[2] == 0x03 && pData[3] == 0x04)
+		return eFileZip;
+
+	return eFileNormal;
+}
+
+// Get the file's full pathname, modification time & size: used to key caches of per-file info
+bool CImageHelperBase::GetFileStamp(LPCTSTR pszFilename, std::string& pathname, UINT64& mtime, UINT64& fileSize)
+{
+#ifdef _MSC_VER
+	struct _stat64 stFileInfo;
+	if (_stat64(pszFilename, &stFileInfo) != 0)
+		return false;
+#else
+	struct stat stFileInfo;
+	if (stat(pszFilename, &stFileInfo) != 0)
+		return false;
+#endif
+
+	TCHAR szFilename[MAX_PATH] = { 0 };
+	DWORD uNameLen = GetFullPathName(pszFilename, MAX_PATH, szFilename, NULL);
+	if (uNameLen == 0 || uNameLen >= MAX_PATH)
+		return false;
+
+	pathname = szFilename;
+	mtime = (UINT64) stFileInfo.st_mtime;
+	fileSize = (UINT64) stFileInfo.st_size;
+	return true;
+}
+
+// Detect(), but first trying the image type previously detected for this file (if it hasn't been modified since)
+// . NB. for a .gz, the file is the archive (and the image in it can only change if the archive does)
+CImageBase* CImageHelperBase::DetectFile(LPCTSTR pszImageFilename, LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo)
+{
+	std::string pathname;
+	UINT64 mtime = 0, fileSize = 0;
+	if (!GetFileStamp(pszImageFilename, pathname, mtime, fileSize))
+		return Detect(pImage, dwSize, pszExt, dwOffset, pImageInfo, eImageUNKNOWN);
+
+	eImageType hintType = eImageUNKNOWN;
+	{
+		std::lock_guard<std::mutex> lock(m_detectCacheMutex);
+		std::map<std::string, DetectCacheEntry_t>::const_iterator it = m_detectCache.find(pathname);
+		if (it != m_detectCache.end() && it->second.mtime == mtime && it->second.fileSize == fileSize)
+			hintType = it->second.type;
+	}
+
+	CImageBase* pImageType = Detect(pImage, dwSize, pszExt, dwOffset, pImageInfo, hintType);
+
+	std::lock_guard<std::mutex> lock(m_detectCacheMutex);
+
+	if (!pImageType)
+	{
+		m_detectCache.erase(pathname);
+	}
+	else
+	{
+		if (m_detectCache.size() >= kMaxDetectCacheEntries && m_detectCache.find(pathname) == m_detectCache.end())
+			m_detectCache.clear();
+
+		DetectCacheEntry_t& entry = m_detectCache[pathname];
+		entry.mtime = mtime;
+		entry.fileSize = fileSize;
+		entry.type = pImageType->GetType();
+	}
+
+	return pImageType;
+}
+
+//-------------------------------------
+
 void CImageHelperBase::SetImageInfo(ImageInfo* pImageInfo, FileType_e fileType, DWORD dwOffset, CImageBase* pImageType, DWORD dwSize)
 {
 	pImageInfo->FileType = fileType;
@@ -1952,7 +2156,7 @@ ImageError_e CImageHelperBase::Open(	LPCTSTR pszImageFilename,
 	}
 	else
 	{
-		Err = CheckNormalFile(pszImageFilename, pImageInfo, bCreateIfNecessary);
+		Err = CheckNormalFile(pszImageFilename, pImageInfo, bCreateIfNecessary, strFilenameInZip);
 	}
 
 	if (pImageInfo->pImageType == NULL && Err == eIMAGE_ERROR_NONE)
@@ -1974,6 +2178,16 @@ ImageError_e CImageHelperBase::Open(	LPCTSTR pszImageFilename,
 
 void CImageHelperBase::Close(ImageInfo* pImageInfo)
 {
+	if (pImageInfo->FileType == eFileGZip || pImageInfo->FileType == eFileZip)
+		GetDiskImageWriteBack().Remove(pImageInfo);	// flush any pending write-back
+
+	if (pImageInfo->FileType == eFileZip && !pImageInfo->bWriteProtected)
+	{
+		DiskImageZipIndex& zipIndex = GetDiskImageZipIndex();
+		std::lock_guard<std::mutex> lock(zipIndex.GetMutex());
+		zipIndex.Invalidate(pImageInfo->szFilename);	// may have been modified
+	}
+
 	if (pImageInfo->hFile != INVALID_HANDLE_VALUE)
 	{
 		CloseHandle(pImageInfo->hFile);
@@ -1984,6 +2198,7 @@ void CImageHelperBase::Close(ImageInfo* pImageInfo)
 
 	delete [] pImageInfo->pImageBuffer;
 	pImageInfo->pImageBuffer = NULL;
+	pImageInfo->uImageBufferSize = 0;
 }
 
 //-------------------------------------
@@ -2024,7 +2239,7 @@ CDiskImageHelper::CDiskImageHelper(void) :
 	m_vecImageTypes.push_back( new CPrgImage );
 }
 
-CImageBase* CDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo)
+CImageBase* CDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo, const eImageType hintType)
 {
 	dwOffset = 0;
 	m_MacBinaryHelper.DetectHdr(pImage, dwSize, dwOffset);
@@ -2050,6 +2265,20 @@ CImageBase* CDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* p
 		}
 	}
 
+	if (imageType == eImageUNKNOWN)
+	{
+		// Fast path: use the type previously detected for this file (see DetectFile()), else dispatch on the signature (magic bytes or file size)
+		// . only raw sector images (ie. DOS vs ProDOS order) need all the image types' heuristics below
+		const eImageType fastType = (hintType != eImageUNKNOWN) ? hintType : DetectSignature(pImage, dwSize);
+
+		CImageBase* pFastImageType = GetImage(fastType);
+		if (pFastImageType && !(*pszExt && _tcsstr(pFastImageType->GetRejectExtensions(), pszExt)))
+		{
+			if (pFastImageType->Detect(pImage, dwSize, pszExt) != eMismatch)	// NB. also sets the image type's # tracks
+				imageType = fastType;
+		}
+	}
+
 	if (imageType == eImageUNKNOWN)
 	{
 		for (UINT uLoop=0; uLoop < GetNumImages() && imageType == eImageUNKNOWN; uLoop++)
@@ -2078,6 +2307,12 @@ CImageBase* CDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* p
 		if (pWozHdr->crc32 && // WOZ spec: CRC of 0 should be ignored
 			pWozHdr->crc32 != crc32(0, pImage+sizeof(CWOZHelper::WOZHeader), dwSize-sizeof(CWOZHelper::WOZHeader)))
 		{
+			if (!ms_promptOnWOZCRCMismatch)
+			{
+				LogFileOutput("WOZ Header: CRC mismatch\n");
+				return NULL;
+			}
+
 			int res = GetFrame().FrameMessageBox("CRC mismatch\nContinue using image?", "AppleWin: WOZ Header", MB_ICONSTOP | MB_SETFOREGROUND | MB_YESNO);
 			if (res == IDNO)
 				return NULL;
@@ -2113,12 +2348,39 @@ CImageBase* CDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* p
 	return pImageType;
 }
 
+// Image types that can be identified without any heuristics
+eImageType CDiskImageHelper::DetectSignature(const LPBYTE pImage, const DWORD dwSize)
+{
+	if (dwSize >= sizeof(CWOZHelper::WOZHeader))
+	{
+		CWOZHelper::WOZHeader* pWozHdr = (CWOZHelper::WOZHeader*) pImage;
+		if (pWozHdr->id1 == CWOZHelper::ID1_WOZ1 && pWozHdr->id2 == CWOZHelper::ID2)
+			return eImageWOZ1;
+		if (pWozHdr->id1 == CWOZHelper::ID1_WOZ2 && pWozHdr->id2 == CWOZHelper::ID2)
+			return eImageWOZ2;
+	}
+
+	if (dwSize > 13 && strncmp((const char *)pImage, "SIMSYSTEM_IIE", 13) == 0)
+		return eImageIIE;
+
+	if (dwSize >= 4 && *(LPDWORD)pImage == 0x214C470A)	// "!LG\x0A"
+		return eImagePRG;
+
+	if (dwSize == CNib2Image::NIB2_TRACK_SIZE*TRACKS_STANDARD)
+		return eImageNIB2;
+
+	if (dwSize >= CNib1Image::NIB1_TRACK_SIZE*TRACKS_STANDARD && dwSize % CNib1Image::NIB1_TRACK_SIZE == 0 && dwSize <= CNib1Image::NIB1_TRACK_SIZE*TRACKS_MAX)
+		return eImageNIB1;
+
+	return eImageUNKNOWN;	// eg. 140K: DOS or ProDOS order
+}
+
 CImageBase* CDiskImageHelper::GetImageForCreation(const TCHAR* pszExt, DWORD* pCreateImageSize)
 {
 	// WE CREATE ONLY DOS ORDER (DO), 6656-NIBBLE (NIB) OR WOZ2 (WOZ) FORMAT FILES
 	for (UINT uLoop = 0; uLoop < GetNumImages(); uLoop++)
 	{
-		if (!GetImage(uLoop)->AllowCreate())
+		if (!GetImage(uLoop)->AllowCreate() || GetImage(uLoop)->GetType() == eImageHDV)	// NB. HDV can only be created by CHardDiskImageHelper
 			continue;
 
 		if (*pszExt && _tcsstr(GetImage(uLoop)->GetCreateExtensions(), pszExt))
@@ -2159,13 +2421,21 @@ CHardDiskImageHelper::CHardDiskImageHelper(void) :
 	m_vecImageTypes.push_back( new CHDVImage );
 }
 
-CImageBase* CHardDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo)
+CImageBase* CHardDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo, const eImageType hintType)
 {
 	dwOffset = 0;
 	m_Result2IMG = m_2IMGHelper.DetectHdr(pImage, dwSize, dwOffset);
 
 	eImageType ImageType = eImageUNKNOWN;
 
+	// Fast path: the type previously detected for this file (see DetectFile())
+	CImageBase* pHintImageType = GetImage(hintType);
+	if (pHintImageType && !(*pszExt && _tcsstr(pHintImageType->GetRejectExtensions(), pszExt)))
+	{
+		if (pHintImageType->Detect(pImage, dwSize, pszExt) == eMatch)
+			ImageType = hintType;
+	}
+
 	for (UINT uLoop=0; uLoop < GetNumImages() && ImageType == eImageUNKNOWN; uLoop++)
 	{
 		if (*pszExt && _tcsstr(GetImage(uLoop)->GetRejectExtensions(), pszExt))
@@ -2198,8 +2468,8 @@ CImageBase* CHardDiskImageHelper::Detect(LPBYTE pImage, DWORD dwSize, const TCHA
 
 CImageBase* CHardDiskImageHelper::GetImageForCreation(const TCHAR* pszExt, DWORD* pCreateImageSize)
 {
-	// NB. Not supported for HardDisks
-	// - Would need to create a default 16-block file like CiderPress
+	// NB. Only a pre-existing zero-length .hdv (since Harddisk doesn't open with bCreateIfNecessary)
+	// - Created as a sparse volume, rather than a default 16-block file like CiderPress
 
 	for (UINT uLoop = 0; uLoop < GetNumImages(); uLoop++)
 	{
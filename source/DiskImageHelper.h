@@ -2,8 +2,12 @@
 
 #include "DiskDefs.h"
 #include "DiskImage.h"
+#include "DiskImageZipIndex.h"
 #include "zip.h"
 
+#include <map>
+#include <mutex>
+
 #define GZ_SUFFIX ".gz"
 #define GZ_SUFFIX_LEN (sizeof(GZ_SUFFIX)-1)
 
@@ -36,6 +40,7 @@ struct ImageInfo
 	// Floppy only
 	UINT			uNumTracks;
 	BYTE*			pImageBuffer;
+	UINT			uImageBufferSize;	// gzip/zip HDD only: allocated size of pImageBuffer when it has been grown (in extents) beyond uImageSize, else 0
 	BYTE*			pWOZTrackMap;		// WOZ only (points into pImageBuffer)
 	BYTE			optimalBitTiming;	// WOZ only
 	BYTE			bootSectorFormat;	// WOZ only
@@ -50,6 +55,7 @@ struct ImageInfo
 
 #define UNIDISK35_800K_SIZE (800*1024)	// UniDisk 3.5"
 #define HARDDISK_32M_SIZE (HD_BLOCK_SIZE * 65536)
+#define HARDDISK_GROW_EXTENT (256*1024)		// gzip/zip HDD image buffers grow in units of this
 
 #define DEFAULT_VOLUME_NUMBER 254
 
@@ -65,6 +71,10 @@ public:
 	virtual bool Read(ImageInfo* pImageInfo, UINT nBlock, LPBYTE pBlockBuffer) { return false; }
 	virtual void Write(ImageInfo* pImageInfo, const float phase, LPBYTE pTrackImageBuffer, int nNibbles) { }
 	virtual bool Write(ImageInfo* pImageInfo, UINT nBlock, LPBYTE pBlockBuffer) { return false; }
+	virtual bool Read(ImageInfo* pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer) { return false; }	// Only: HDV
+	virtual bool Write(ImageInfo* pImageInfo, UINT nBlock, UINT numBlocks, LPBYTE pBlockBuffer) { return false; }	// Only: HDV
+	virtual bool ReadPhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer) { return false; }	// Only: DO and PO
+	virtual bool WritePhysicalSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, LPBYTE pSectorBuffer) { return false; }	// Only: DO and PO
 
 	virtual bool AllowBoot(void) { return false; }		// Only:    APL and PRG
 	virtual bool AllowRW(void) { return true; }			// All but: APL and PRG
@@ -77,6 +87,7 @@ public:
 
 	bool WriteImageHeader(ImageInfo* pImageInfo, LPBYTE pHdr, const UINT hdrSize);
 	void SetVolumeNumber(const BYTE uVolumeNumber) { m_uVolumeNumber = uVolumeNumber; }
+	BYTE GetVolumeNumber(void) { return m_uVolumeNumber; }
 	bool IsValidImageSize(const DWORD uImageSize);
 
 	// To accurately convert a half phase (quarter track) back to a track (round half tracks down), use: ceil(phase)/2, eg:
@@ -86,12 +97,18 @@ public:
 
 	enum SectorOrder_e {eProDOSOrder, eDOSOrder, eSIMSYSTEMOrder, NUM_SECTOR_ORDERS};
 
+	static const BYTE* GetDiskByteTable(void) { return ms_DiskByte; }	// 6&2 translate table (0x40 nibbles)
+
 protected:
 	bool ReadTrack(ImageInfo* pImageInfo, const int nTrack, LPBYTE pTrackBuffer, const UINT uTrackSize);
 	bool WriteTrack(ImageInfo* pImageInfo, const int nTrack, LPBYTE pTrackBuffer, const UINT uTrackSize);
 	bool ReadBlock(ImageInfo* pImageInfo, const int nBlock, LPBYTE pBlockBuffer);
 	bool WriteBlock(ImageInfo* pImageInfo, const int nBlock, LPBYTE pBlockBuffer);
+	bool ReadBlocks(ImageInfo* pImageInfo, const int nBlock, const UINT numBlocks, LPBYTE pBlockBuffer);
+	bool WriteBlocks(ImageInfo* pImageInfo, const int nBlock, const UINT numBlocks, LPBYTE pBlockBuffer);
 	bool WriteImageData(ImageInfo* pImageInfo, LPBYTE pSrcBuffer, const UINT uSrcSize, const long offset);
+	bool ReadSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, SectorOrder_e SectorOrder, LPBYTE pSectorBuffer);
+	bool WriteSector(ImageInfo* pImageInfo, const UINT track, const UINT sector, SectorOrder_e SectorOrder, LPBYTE pSectorBuffer);
 
 	LPBYTE Code62(int sector);
 	void Decode62(LPBYTE imageptr);
@@ -104,7 +121,8 @@ public:
 
 protected:
 	static BYTE ms_DiskByte[0x40];
-	static BYTE ms_SectorNumber[NUM_SECTOR_ORDERS][NUM_SECTORS];
+	static const BYTE ms_SectorNumber[NUM_SECTOR_ORDERS][NUM_SECTORS];
+	BYTE m_SectorNumber[NUM_SECTOR_ORDERS][NUM_SECTORS];	// per instance, as the SIMSYSTEM order comes from the image's header
 	BYTE m_uVolumeNumber;
 	LPBYTE m_pWorkBuffer;
 };
@@ -379,8 +397,11 @@ public:
 	ImageError_e Open(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, const bool bCreateIfNecessary, std::string& strFilenameInZip);
 	void Close(ImageInfo* pImageInfo);
 	bool WOZUpdateInfo(ImageInfo* pImageInfo, DWORD& dwOffset);
+	static void SetPromptOnWOZCRCMismatch(const bool enable) { ms_promptOnWOZCRCMismatch = enable; }	// false: reject the image (eg. for a headless tool)
+	static bool GetFileStamp(LPCTSTR pszFilename, std::string& pathname, UINT64& mtime, UINT64& fileSize);
+	bool GetZipDiskImages(const ImageInfo* pImageInfo, std::vector<std::string>& filenames);
 
-	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo) = 0;
+	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo, const eImageType hintType) = 0;
 	virtual CImageBase* GetImageForCreation(const TCHAR* pszExt, DWORD* pCreateImageSize) = 0;
 	virtual UINT GetMaxImageSize(void) = 0;
 	virtual UINT GetMinDetectSize(const UINT uImageSize, bool* pTempDetectBuffer) = 0;
@@ -388,10 +409,13 @@ public:
 protected:
 	ImageError_e CheckGZipFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo);
 	ImageError_e CheckZipFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, std::string& strFilenameInZip);
-	ImageError_e CheckNormalFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, const bool bCreateIfNecessary);
+	ImageError_e CheckNormalFile(LPCTSTR pszImageFilename, ImageInfo* pImageInfo, const bool bCreateIfNecessary, std::string& strFilenameInZip);
 	void GetCharLowerExt(TCHAR* pszExt, LPCTSTR pszImageFilename, const UINT uExtSize);
 	void GetCharLowerExt2(TCHAR* pszExt, LPCTSTR pszImageFilename, const UINT uExtSize);
 	void SetImageInfo(ImageInfo* pImageInfo, FileType_e fileType, DWORD dwOffset, CImageBase* pImageType, DWORD dwSize);
+	static FileType_e DetectFileType(const BYTE* pData, const UINT size);
+	CImageBase* DetectFile(LPCTSTR pszImageFilename, LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo);
+	void GetZipDiskImages(const DiskImageZipIndex::Index_t* pIndex, const std::string& strFilenameInZip, std::vector<std::string>& filenames);
 
 	UINT GetNumImages(void) { return m_vecImageTypes.size(); };
 	CImageBase* GetImage(UINT uIndex) { _ASSERT(uIndex<GetNumImages()); return m_vecImageTypes[uIndex]; }
@@ -415,6 +439,23 @@ protected:
 	C2IMGHelper m_2IMGHelper;
 	eDetectResult m_Result2IMG;
 	CWOZHelper m_WOZHelper;
+
+	// Detect() results, keyed by full pathname (only valid whilst the file's mtime & size are unchanged)
+	// . So re-opening a file (eg. a directory re-scan, or a DiskImageTool batch) doesn't repeat all the image types' heuristics
+	// . The helpers are shared by all callers (eg. DiskImageTool's threads), so guarded by m_detectCacheMutex
+	struct DetectCacheEntry_t
+	{
+		UINT64 mtime;
+		UINT64 fileSize;
+		eImageType type;
+	};
+
+	static const UINT kMaxDetectCacheEntries = 4096;
+
+	std::map<std::string, DetectCacheEntry_t> m_detectCache;
+	std::mutex m_detectCacheMutex;
+
+	static bool ms_promptOnWOZCRCMismatch;
 };
 
 //-------------------------------------
@@ -425,7 +466,7 @@ public:
 	CDiskImageHelper(void);
 	virtual ~CDiskImageHelper(void) {}
 
-	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo);
+	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo, const eImageType hintType);
 	virtual CImageBase* GetImageForCreation(const TCHAR* pszExt, DWORD* pCreateImageSize);
 	virtual UINT GetMaxImageSize(void);
 	virtual UINT GetMinDetectSize(const UINT uImageSize, bool* pTempDetectBuffer);
@@ -435,6 +476,7 @@ public:
 
 private:
 	void SkipMacBinaryHdr(LPBYTE& pImage, DWORD& dwSize, DWORD& dwOffset);
+	eImageType DetectSignature(const LPBYTE pImage, const DWORD dwSize);
 
 private:
 	CMacBinaryHelper m_MacBinaryHelper;
@@ -448,7 +490,7 @@ public:
 	CHardDiskImageHelper(void);
 	virtual ~CHardDiskImageHelper(void) {}
 
-	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo);
+	virtual CImageBase* Detect(LPBYTE pImage, DWORD dwSize, const TCHAR* pszExt, DWORD& dwOffset, ImageInfo* pImageInfo, const eImageType hintType);
 	virtual CImageBase* GetImageForCreation(const TCHAR* pszExt, DWORD* pCreateImageSize);
 	virtual UINT GetMaxImageSize(void);
 	virtual UINT GetMinDetectSize(const UINT uImageSize, bool* pTempDetectBuffer);
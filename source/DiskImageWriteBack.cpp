@@ -0,0 +1,321 @@
+/*
+AppleWin : An Apple //e emulator for Windows
+
+Copyright (C) 1994-1996, Michael O'Brien
+Copyright (C) 1999-2001, Oliver Schmidt
+Copyright (C) 2002-2005, Tom Charlesworth
+Copyright (C) 2006-2024, Tom Charlesworth, Michael Pohoreski, Nick Westgate
+
+AppleWin is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+AppleWin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with AppleWin; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Description: Deferred write-back of gzip & zip disk images
+ *
+ * Previously every dirty track or HDD block re-compressed and re-wrote the entire .gz/.zip file,
+ * so eg. copying a file to a zipped ProDOS volume would stall the emulator on dozens of full
+ * recompressions. Now the emulation thread just copies the written range into a shadow image,
+ * and the writer thread does a single recompression once writes have stopped.
+ *
+ * Author: Various
+ */
+
+#include "StdAfx.h"
+
+#include "DiskImageWriteBack.h"
+#include "Common.h"
+#include "DiskImageHelper.h"
+#include "Log.h"
+
+#include "zlib.h"
+#include "zip.h"
+
+DiskImageWriteBack& GetDiskImageWriteBack(void)
+{
+	static DiskImageWriteBack g_diskImageWriteBack;	// singleton
+	return g_diskImageWriteBack;
+}
+
+DiskImageWriteBack::DiskImageWriteBack(void)
+{
+	m_quit = false;
+	m_numFlushes = 0;
+}
+
+DiskImageWriteBack::~DiskImageWriteBack(void)
+{
+	if (m_writerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_cv.notify_one();
+		m_writerThread.join();
+	}
+
+	// NB. Can't flush here: any ImageInfo still registered may already have been freed
+	_ASSERT(m_jobs.empty());	// Images are flushed & removed when they are closed
+}
+
+//===========================================================================
+
+// Called from the emulation thread, after [offset, offset+size) of pImageInfo->pImageBuffer has been updated
+void DiskImageWriteBack::Update(ImageInfo* pImageInfo, const UINT offset, const UINT size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		Job_t& job = m_jobs[pImageInfo];
+		const UINT imageSize = pImageInfo->uImageSize;
+
+		if (job.shadow.size() != imageSize)
+		{
+			// New job, or the image has grown (HDD block written past the end)
+			const UINT oldSize = job.shadow.empty() ? 0 : job.shadow.size();
+			job.shadow.resize(imageSize);
+			if (imageSize > oldSize)
+				memcpy(&job.shadow[oldSize], &pImageInfo->pImageBuffer[oldSize], imageSize - oldSize);
+			if (oldSize == 0)
+				job.dirtyStart = job.dirtyEnd = job.staleStart = job.staleEnd = 0;
+		}
+
+		if (job.staleStart != job.staleEnd)
+		{
+			// The last flush swapped in the previous snapshot, so bring it up to date (just the range that changed since then)
+			const UINT staleEnd = MIN(job.staleEnd, imageSize);
+			if (job.staleStart < staleEnd)
+				memcpy(&job.shadow[job.staleStart], &pImageInfo->pImageBuffer[job.staleStart], staleEnd - job.staleStart);
+			job.staleStart = job.staleEnd = 0;
+		}
+
+		const UINT end = MIN(offset + size, imageSize);
+		if (offset < end)
+			memcpy(&job.shadow[offset], &pImageInfo->pImageBuffer[offset], end - offset);
+
+		if (job.dirtyStart == job.dirtyEnd)
+		{
+			job.dirtyStart = offset;
+			job.dirtyEnd = end;
+		}
+		else
+		{
+			job.dirtyStart = MIN(job.dirtyStart, offset);
+			job.dirtyEnd = MAX(job.dirtyEnd, end);
+		}
+
+		job.lastWrite = std::chrono::steady_clock::now();
+	}
+
+	if (!m_writerThread.joinable())
+		m_writerThread = std::thread(&DiskImageWriteBack::WriterThread, this);
+
+	m_cv.notify_one();
+}
+
+bool DiskImageWriteBack::Flush(ImageInfo* pImageInfo)
+{
+	std::lock_guard<std::mutex> flushLock(m_flushMutex);
+	return FlushJob(pImageInfo);
+}
+
+// Called when the image is closed: flush now, then forget about it
+void DiskImageWriteBack::Remove(ImageInfo* pImageInfo)
+{
+	std::lock_guard<std::mutex> flushLock(m_flushMutex);
+
+	FlushJob(pImageInfo);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.erase(pImageInfo);
+}
+
+//===========================================================================
+
+// Pre: m_flushMutex is held
+// . Only swaps buffers whilst holding m_mutex, so the emulation thread is never blocked for long:
+//   the snapshot to compress is swapped out of the job, and the previous snapshot is swapped in to receive new writes
+bool DiskImageWriteBack::FlushJob(ImageInfo* pImageInfo)
+{
+	std::vector<BYTE> image;
+	bool needShadow = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::map<ImageInfo*, Job_t>::iterator it = m_jobs.find(pImageInfo);
+		if (it == m_jobs.end())
+			return true;
+
+		Job_t& job = it->second;
+		if (job.dirtyStart == job.dirtyEnd)
+			return true;
+
+		image.swap(job.shadow);
+		job.shadow.swap(job.spare);
+		job.staleStart = job.dirtyStart;	// the previous snapshot is only missing what changed since it was flushed
+		job.staleEnd = job.dirtyEnd;
+		job.dirtyStart = job.dirtyEnd = 0;
+		needShadow = job.shadow.empty();	// 1st flush: no previous snapshot
+	}
+
+	if (needShadow)
+	{
+		std::vector<BYTE> shadow(image);	// copy outside of m_mutex
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::map<ImageInfo*, Job_t>::iterator it = m_jobs.find(pImageInfo);
+		if (it != m_jobs.end() && it->second.shadow.empty())	// else Update() has already re-populated it
+		{
+			it->second.shadow.swap(shadow);
+			it->second.staleStart = it->second.staleEnd = 0;
+		}
+	}
+
+	const bool res = WriteCompressedImage(pImageInfo, image);
+	if (!res)
+		LogFileOutput("DiskImageWriteBack: Failed to write: %s\n", pImageInfo->szFilename.c_str());
+	else
+		m_numFlushes++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::map<ImageInfo*, Job_t>::iterator it = m_jobs.find(pImageInfo);
+		if (it != m_jobs.end())
+			it->second.spare.swap(image);	// becomes the next flush's shadow
+	}
+
+	return res;
+}
+
+void DiskImageWriteBack::WriterThread(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_quit)
+	{
+		m_cv.wait_for(lock, std::chrono::milliseconds(kIdleFlushMs / 4));
+		if (m_quit)
+			break;
+
+		// Only flush images that haven't been written to for a while, so that a burst of writes is coalesced into a single flush
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::vector<ImageInfo*> idleImages;
+		for (std::map<ImageInfo*, Job_t>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it)
+		{
+			const Job_t& job = it->second;
+			if (job.dirtyStart != job.dirtyEnd && now - job.lastWrite >= std::chrono::milliseconds(kIdleFlushMs))
+				idleImages.push_back(it->first);
+		}
+
+		if (idleImages.empty())
+			continue;
+
+		lock.unlock();
+
+		for (UINT i = 0; i < idleImages.size(); i++)
+			Flush(idleImages[i]);	// NB. FlushJob() re-checks that the image is still open
+
+		lock.lock();
+	}
+}
+
+//===========================================================================
+
+// Write the entire compressed image to "<filename>.tmp", then rename it over the original
+bool DiskImageWriteBack::WriteCompressedImage(ImageInfo* pImageInfo, const std::vector<BYTE>& image)
+{
+	const std::string& filename = pImageInfo->szFilename;
+	const std::string tmpFilename = filename + ".tmp";
+	const UINT imageSize = image.size();
+
+	if (pImageInfo->FileType == eFileGZip)
+	{
+		gzFile hGZFile = gzopen(tmpFilename.c_str(), "wb");
+		if (hGZFile == NULL)
+			return false;
+
+		int nLen = gzwrite(hGZFile, &image[0], imageSize);
+		int nRes = gzclose(hGZFile);	// close before returning (due to error) to avoid resource leak
+		hGZFile = NULL;
+
+		if (nLen != imageSize || nRes != Z_OK)
+		{
+			remove(tmpFilename.c_str());
+			return false;
+		}
+	}
+	else if (pImageInfo->FileType == eFileZip)
+	{
+		// NB. Only support Zip archives with a single file
+		// - there is no delete in a zipfile, so would need to copy files from old to new zip file!
+		_ASSERT(pImageInfo->uNumEntriesInZip == 1);	// Should never occur, since image will be write-protected in CheckZipFile()
+		if (pImageInfo->uNumEntriesInZip > 1)
+			return false;
+
+		zipFile hZipFile = zipOpen(tmpFilename.c_str(), APPEND_STATUS_CREATE);
+		if (hZipFile == NULL)
+			return false;
+
+		int nOpenedFileInZip = ZIP_BADZIPFILE;
+
+		try
+		{
+			nOpenedFileInZip = zipOpenNewFileInZip(hZipFile, pImageInfo->szFilenameInZip.c_str(), &pImageInfo->zipFileInfo, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_SPEED);
+			if (nOpenedFileInZip != ZIP_OK)
+				throw false;
+
+			int nRes = zipWriteInFileInZip(hZipFile, &image[0], imageSize);
+			if (nRes != ZIP_OK)
+				throw false;
+
+			nOpenedFileInZip = ZIP_BADZIPFILE;
+			nRes = zipCloseFileInZip(hZipFile);
+			if (nRes != ZIP_OK)
+				throw false;
+		}
+		catch (bool)
+		{
+			if (nOpenedFileInZip == ZIP_OK)
+				zipCloseFileInZip(hZipFile);
+
+			zipClose(hZipFile, NULL);
+			remove(tmpFilename.c_str());
+
+			return false;
+		}
+
+		int nRes = zipClose(hZipFile, NULL);
+		if (nRes != ZIP_OK)
+		{
+			remove(tmpFilename.c_str());
+			return false;
+		}
+	}
+	else
+	{
+		_ASSERT(0);
+		return false;
+	}
+
+#ifdef _MSC_VER
+	const bool res = MoveFileEx(tmpFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+	const bool res = rename(tmpFilename.c_str(), filename.c_str()) == 0;	// POSIX: atomically replaces the destination
+#endif
+	if (!res)
+		remove(tmpFilename.c_str());
+
+	return res;
+}
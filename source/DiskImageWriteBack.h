@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+struct ImageInfo;
+
+// Deferred, coalesced write-back for gzip & zip images
+// . Each write only copies the changed range into a shadow copy of the (decompressed) image
+// . A background thread recompresses the whole image once it has been idle for kIdleFlushMs
+// . Remove() does the same synchronously, and must be called when the image is closed (see CImageHelperBase::Close())
+// . The new file is written to a temp file, then renamed over the original
+
+class DiskImageWriteBack
+{
+public:
+	DiskImageWriteBack(void);
+	~DiskImageWriteBack(void);
+
+	void Update(ImageInfo* pImageInfo, const UINT offset, const UINT size);
+	bool Flush(ImageInfo* pImageInfo);
+	void Remove(ImageInfo* pImageInfo);
+
+	UINT GetNumFlushes(void) { return m_numFlushes; }
+
+private:
+	struct Job_t
+	{
+		std::vector<BYTE> shadow;	// written by Update()
+		std::vector<BYTE> spare;	// image as at the last flush (swapped with shadow by the next flush)
+		UINT dirtyStart;			// changed since the last flush
+		UINT dirtyEnd;
+		UINT staleStart;			// shadow is missing these changes (it was swapped in from spare), until the next Update()
+		UINT staleEnd;
+		std::chrono::steady_clock::time_point lastWrite;
+	};
+
+	void WriterThread(void);
+	bool FlushJob(ImageInfo* pImageInfo);
+	static bool WriteCompressedImage(ImageInfo* pImageInfo, const std::vector<BYTE>& image);
+
+	static const UINT kIdleFlushMs = 1000;
+
+	std::mutex m_mutex;						// guards m_jobs & m_quit
+	std::mutex m_flushMutex;				// serialises flushes, so an older image can never be renamed over a newer one
+	std::condition_variable m_cv;
+	std::map<ImageInfo*, Job_t> m_jobs;
+	bool m_quit;
+	std::thread m_writerThread;
+
+	UINT m_numFlushes;
+};
+
+DiskImageWriteBack& GetDiskImageWriteBack(void);
@@ -0,0 +1,245 @@
+/*
+AppleWin : An Apple //e emulator for Windows
+
+Copyright (C) 1994-1996, Michael O'Brien
+Copyright (C) 1999-2001, Oliver Schmidt
+Copyright (C) 2002-2005, Tom Charlesworth
+Copyright (C) 2006-2024, Tom Charlesworth, Michael Pohoreski, Nick Westgate
+
+AppleWin is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+AppleWin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with AppleWin; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Description: Index & inflated-entry cache for zip disk images
+ *
+ * Previously opening a zip inflated every entry (just to count the valid disk images), and
+ * swapping to another disk in the same zip did it all again. Now the central directory is read
+ * once into an index, and only the entry being mounted is inflated (and then cached).
+ *
+ * Author: Various
+ */
+
+#include "StdAfx.h"
+
+#include "DiskImageZipIndex.h"
+#include "DiskImageHelper.h"
+
+DiskImageZipIndex& GetDiskImageZipIndex(void)
+{
+	static DiskImageZipIndex g_diskImageZipIndex;	// singleton
+	return g_diskImageZipIndex;
+}
+
+DiskImageZipIndex::DiskImageZipIndex(void)
+{
+	m_cachedBytes = 0;
+	m_numInflates = 0;
+	m_numCacheHits = 0;
+}
+
+//===========================================================================
+
+ImageError_e DiskImageZipIndex::GetIndex(LPCTSTR pszZipFilename, const Index_t*& pIndex)
+{
+	pIndex = NULL;
+
+	std::string pathname;
+	UINT64 mtime, fileSize;
+	if (!CImageHelperBase::GetFileStamp(pszZipFilename, pathname, mtime, fileSize))
+		return eIMAGE_ERROR_UNABLE_TO_OPEN_ZIP;
+
+	std::map<std::string, Index_t>::iterator it = m_index.find(pathname);
+	if (it != m_index.end())
+	{
+		if (it->second.mtime == mtime && it->second.fileSize == fileSize)
+		{
+			pIndex = &it->second;
+			return eIMAGE_ERROR_NONE;
+		}
+
+		Invalidate(pathname);	// zip has changed
+	}
+
+	unzFile hZipFile = unzOpen(pszZipFilename);
+	if (hZipFile == NULL)
+		return eIMAGE_ERROR_UNABLE_TO_OPEN_ZIP;
+
+	Index_t index;
+	index.pathname = pathname;
+	index.mtime = mtime;
+	index.fileSize = fileSize;
+
+	unz_global_info global_info;
+	int nRes = unzGetGlobalInfo(hZipFile, &global_info);
+	if (nRes == UNZ_OK)
+		nRes = unzGoToFirstFile(hZipFile);
+
+	index.numEntries = global_info.number_entry;
+
+	for (UINT n=0; n<global_info.number_entry && nRes == UNZ_OK; n++)
+	{
+		if (n)
+		{
+			nRes = unzGoToNextFile(hZipFile);
+			if (nRes == UNZ_END_OF_LIST_OF_FILE)
+			{
+				nRes = UNZ_OK;
+				break;
+			}
+			if (nRes != UNZ_OK)
+				break;
+		}
+
+		unz_file_info file_info;
+		char szFilename[MAX_PATH];
+		memset(szFilename, 0, sizeof(szFilename));
+		nRes = unzGetCurrentFileInfo(hZipFile, &file_info, szFilename, MAX_PATH, NULL, 0, NULL, 0);
+		if (nRes != UNZ_OK)
+			break;
+
+		if (file_info.uncompressed_size == 0)	// skip directories or empty files
+			continue;
+
+		Entry_t entry;
+		nRes = unzGetFilePos(hZipFile, &entry.pos);
+		if (nRes != UNZ_OK)
+			break;
+
+		entry.filename = szFilename;
+		entry.uncompressedSize = file_info.uncompressed_size;
+		entry.tmu_date = file_info.tmu_date;
+		entry.dosDate = file_info.dosDate;
+		entry.internal_fa = file_info.internal_fa;
+		entry.external_fa = file_info.external_fa;
+		index.entries.push_back(entry);
+	}
+
+	unzClose(hZipFile);
+
+	if (nRes != UNZ_OK)
+		return eIMAGE_ERROR_ZIP;
+
+	if (m_index.size() >= kMaxIndexedZips)
+		m_index.clear();	// NB. cached entries are still valid, as they're keyed by pathname & mtime
+
+	Index_t& newIndex = m_index[pathname];
+	newIndex = index;
+	pIndex = &newIndex;
+	return eIMAGE_ERROR_NONE;
+}
+
+// Returns a copy of the inflated entry in pBuffer (owned by the caller)
+ImageError_e DiskImageZipIndex::Inflate(const Index_t* pIndex, const UINT entryIndex, BYTE*& pBuffer, UINT& size)
+{
+	pBuffer = NULL;
+	size = 0;
+
+	if (entryIndex >= pIndex->entries.size())
+		return eIMAGE_ERROR_ZIP;
+
+	const Entry_t& entry = pIndex->entries[entryIndex];
+	const std::string key = GetEntryKey(pIndex->pathname, entry.filename);
+
+	for (std::list<CachedEntry_t>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+	{
+		if (it->key != key || it->mtime != pIndex->mtime)
+			continue;
+
+		m_cache.splice(m_cache.begin(), m_cache, it);	// move to front (MRU)
+
+		size = m_cache.front().data.size();
+		pBuffer = new BYTE[size];
+		memcpy(pBuffer, &m_cache.front().data[0], size);
+		m_numCacheHits++;
+		return eIMAGE_ERROR_NONE;
+	}
+
+	//
+
+	unzFile hZipFile = unzOpen(pIndex->pathname.c_str());
+	if (hZipFile == NULL)
+		return eIMAGE_ERROR_UNABLE_TO_OPEN_ZIP;
+
+	unz_file_pos pos = entry.pos;
+	int nRes = unzGoToFilePos(hZipFile, &pos);
+	if (nRes == UNZ_OK)
+		nRes = unzOpenCurrentFile(hZipFile);
+	if (nRes != UNZ_OK)
+	{
+		unzClose(hZipFile);
+		return eIMAGE_ERROR_ZIP;
+	}
+
+	BYTE* pImageBuffer = new BYTE[entry.uncompressedSize];
+	int nLen = unzReadCurrentFile(hZipFile, pImageBuffer, entry.uncompressedSize);
+	nRes = unzCloseCurrentFile(hZipFile);	// Must CloseCurrentFile before Close
+	unzClose(hZipFile);
+
+	if (nLen < 0)
+	{
+		delete [] pImageBuffer;
+		return eIMAGE_ERROR_UNSUPPORTED;
+	}
+
+	if (nRes != UNZ_OK)
+	{
+		delete [] pImageBuffer;
+		return eIMAGE_ERROR_ZIP;
+	}
+
+	m_numInflates++;
+	pBuffer = pImageBuffer;
+	size = nLen;
+
+	// Add to cache, evicting least recently used entries as necessary
+	if (size && size <= kMaxCachedBytes)
+	{
+		while (!m_cache.empty() && (m_cache.size() >= kMaxCachedEntries || m_cachedBytes + size > kMaxCachedBytes))
+		{
+			m_cachedBytes -= m_cache.back().data.size();
+			m_cache.pop_back();
+		}
+
+		m_cache.push_front(CachedEntry_t());
+		CachedEntry_t& cached = m_cache.front();
+		cached.key = key;
+		cached.mtime = pIndex->mtime;
+		cached.data.assign(pBuffer, pBuffer + size);
+		m_cachedBytes += size;
+	}
+
+	return eIMAGE_ERROR_NONE;
+}
+
+// Called when the zip may have been modified (eg. a single-entry zip has been written to)
+void DiskImageZipIndex::Invalidate(const std::string& pathname)
+{
+	m_index.erase(pathname);
+
+	const std::string keyPrefix = GetEntryKey(pathname, "");
+
+	std::list<CachedEntry_t>::iterator it = m_cache.begin();
+	while (it != m_cache.end())
+	{
+		if (it->key.compare(0, keyPrefix.size(), keyPrefix) == 0)
+		{
+			m_cachedBytes -= it->data.size();
+			it = m_cache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+
+#include "DiskImage.h"
+#include "unzip.h"
+
+// Index of the entries in zip archives, plus a bounded cache of inflated entries
+// . Each archive's central directory is only parsed once (until its mtime or size changes)
+// . An entry is only inflated when it's mounted, so swapping between the disks of a multi-disk zip doesn't re-inflate the archive
+// . It's shared by all image helpers, so callers must hold GetMutex() whilst using it (and any Index_t it returns)
+
+class DiskImageZipIndex
+{
+public:
+	DiskImageZipIndex(void);
+	~DiskImageZipIndex(void) {}
+
+	struct Entry_t
+	{
+		std::string filename;
+		unz_file_pos pos;
+		UINT uncompressedSize;
+		tm_unz tmu_date;
+		uLong dosDate;
+		uLong internal_fa;
+		uLong external_fa;
+	};
+
+	struct Index_t
+	{
+		std::string pathname;
+		UINT64 mtime;
+		UINT64 fileSize;
+		UINT numEntries;					// as per the zip's global info (includes directories)
+		std::vector<Entry_t> entries;		// excludes directories & empty files
+	};
+
+	ImageError_e GetIndex(LPCTSTR pszZipFilename, const Index_t*& pIndex);
+	ImageError_e Inflate(const Index_t* pIndex, const UINT entryIndex, BYTE*& pBuffer, UINT& size);
+	void Invalidate(const std::string& pathname);
+
+	std::mutex& GetMutex(void) { return m_mutex; }
+
+	UINT GetNumInflates(void) { return m_numInflates; }
+	UINT GetNumCacheHits(void) { return m_numCacheHits; }
+
+private:
+	struct CachedEntry_t
+	{
+		std::string key;
+		UINT64 mtime;
+		std::vector<BYTE> data;
+	};
+
+	static std::string GetEntryKey(const std::string& pathname, const std::string& filename) { return pathname + '\0' + filename; }
+
+	static const UINT kMaxCachedEntries = 8;				// eg. a multi-disk game
+	static const UINT kMaxCachedBytes = 32 * 1024 * 1024;
+	static const UINT kMaxIndexedZips = 256;
+
+	std::map<std::string, Index_t> m_index;			// keyed by full pathname
+	std::list<CachedEntry_t> m_cache;				// most recently used at the front
+	UINT m_cachedBytes;
+	std::mutex m_mutex;
+
+	UINT m_numInflates;
+	UINT m_numCacheHits;
+};
+
+DiskImageZipIndex& GetDiskImageZipIndex(void);
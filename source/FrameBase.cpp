@@ -2,6 +2,8 @@
 
 #include "FrameBase.h"
 #include "Interface.h"
+#include "Core.h"
+#include "Log.h"
 #include "NTSC.h"
 #include "StrFormat.h"
 
@@ -14,6 +16,11 @@ FrameBase::FrameBase()
 	g_hInstance = (HINSTANCE)0;
 	g_bDisplayPrintScreenFileName = false;
 	g_bShowPrintScreenWarningDialog = true;
+	dwFullSpeedStartTime = 0;
+	m_fullSpeedRedraw = FSR_TIMED;
+	m_fullSpeedFrameSkip = 1;
+	m_fullSpeedFrameCount = 0;
+	memset(&m_videoFrameStats, 0, sizeof(m_videoFrameStats));
 }
 
 FrameBase::~FrameBase()
@@ -37,30 +44,100 @@ void FrameBase::VideoRedrawScreen(void)
 }
 
 //===========================================================================
+
+// Called at the end of each emulated video frame
+void FrameBase::VideoUpdateAtEndOfFrame(DWORD dwCyclesThisFrame)
+{
+	m_videoFrameStats.numFramesEmulated++;
+
+	if (g_bFullSpeed)
+	{
+		VideoRedrawScreenDuringFullSpeed(dwCyclesThisFrame);
+	}
+	else
+	{
+		// NTSC renderer has been updating the video buffer cycle-by-cycle in CpuExecute()
+		m_videoFrameStats.numFramesRendered++;
+		VideoPresentScreen(); // Just copy the output of our Apple framebuffer to the system Back Buffer
+	}
+}
+
+// NB. During full-speed the NTSC renderer isn't updated per cycle (see CpuExecute()'s bVideoUpdate).
+// The video scanner position is still resync'd cheaply on demand for VBL & floating-bus reads, so skipping
+// the redraw here doesn't affect emulation accuracy.
 void FrameBase::VideoRedrawScreenDuringFullSpeed(DWORD dwCyclesThisFrame, bool bInit /*=false*/)
 {
 	if (bInit)
 	{
 		// Just entered full-speed mode
 		dwFullSpeedStartTime = GetTickCount();
+		m_fullSpeedFrameCount = 0;
 		return;
 	}
 
-	DWORD dwFullSpeedDuration = GetTickCount() - dwFullSpeedStartTime;
-	if (dwFullSpeedDuration <= 16)	// Only update after every realtime ~17ms of *continuous* full-speed
-		return;
-
-	dwFullSpeedStartTime += dwFullSpeedDuration;
+	switch (m_fullSpeedRedraw)
+	{
+	case FSR_EVERY_N_FRAMES:
+		if (++m_fullSpeedFrameCount < m_fullSpeedFrameSkip)
+		{
+			m_videoFrameStats.numFramesSkipped++;
+			return;
+		}
+		m_fullSpeedFrameCount = 0;
+		break;
+	case FSR_WHEN_READY:
+		if (!IsReadyToPresent())
+		{
+			m_videoFrameStats.numFramesSkipped++;
+			return;
+		}
+		dwFullSpeedStartTime = GetTickCount();
+		break;
+	default:	// FSR_TIMED
+		{
+			DWORD dwFullSpeedDuration = GetTickCount() - dwFullSpeedStartTime;
+			if (dwFullSpeedDuration <= 16)	// Only update after every realtime ~17ms of *continuous* full-speed
+			{
+				m_videoFrameStats.numFramesSkipped++;
+				return;
+			}
+
+			dwFullSpeedStartTime += dwFullSpeedDuration;
+		}
+		break;
+	}
 
 	VideoRedrawScreenAfterFullSpeed(dwCyclesThisFrame);
 }
 
 void FrameBase::VideoRedrawScreenAfterFullSpeed(DWORD dwCyclesThisFrame)
 {
+	m_videoFrameStats.numFramesRendered++;
+
 	NTSC_VideoClockResync(dwCyclesThisFrame);
 	VideoRedrawScreen();	// Better (no flicker) than using: NTSC_VideoReinitialize() or VideoReinitialize()
 }
 
+void FrameBase::SetFullSpeedRedraw(FullSpeedRedraw_e policy, UINT frameSkip /*= 1*/)
+{
+	m_fullSpeedRedraw = policy;
+	m_fullSpeedFrameSkip = frameSkip ? frameSkip : 1;
+	m_fullSpeedFrameCount = 0;
+}
+
+// Fallback for a frontend that can't query its display: the same ~17ms cadence as FSR_TIMED
+bool FrameBase::IsReadyToPresent(void)
+{
+	return (GetTickCount() - dwFullSpeedStartTime) > 16;
+}
+
+void FrameBase::LogVideoFrameStats(void)
+{
+	LogFileOutput("Video frames: emulated=%u, rendered=%u, presented=%u, skipped at full-speed=%u\n",
+		(UINT)m_videoFrameStats.numFramesEmulated, (UINT)m_videoFrameStats.numFramesRendered,
+		(UINT)m_videoFrameStats.numFramesPresented, (UINT)m_videoFrameStats.numFramesSkipped);
+}
+
 void FrameBase::Video_RedrawAndTakeScreenShot(const char* pScreenshotFilename)
 {
 	_ASSERT(pScreenshotFilename);
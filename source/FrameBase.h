@@ -35,6 +35,7 @@ public:
 
 	virtual void SetLoadedSaveStateFlag(const bool bFlag) = 0;
 
+	// NB. implementations should start with GetVideo().UpdateDirtyLineRanges() and finish with GetVideoCapture().CaptureFrame()
 	virtual void VideoPresentScreen(void) = 0;
 	virtual void ResizeWindow(void) = 0;
 
@@ -59,8 +60,34 @@ public:
 
 	void VideoRefreshScreen(uint32_t uRedrawWholeScreenVideoMode, bool bRedrawWholeScreen);
 	void VideoRedrawScreen(void);
+	void VideoUpdateAtEndOfFrame(DWORD dwCyclesThisFrame);
 	void VideoRedrawScreenDuringFullSpeed(DWORD dwCyclesThisFrame, bool bInit = false);
 	void VideoRedrawScreenAfterFullSpeed(DWORD dwCyclesThisFrame);
+
+	// How often to redraw the screen during full-speed
+	enum FullSpeedRedraw_e
+	{
+		FSR_TIMED,				// After every ~17ms of continuous full-speed (default)
+		FSR_EVERY_N_FRAMES,		// Once every N emulated video frames
+		FSR_WHEN_READY,			// Only when IsReadyToPresent()
+	};
+	void SetFullSpeedRedraw(FullSpeedRedraw_e policy, UINT frameSkip = 1);
+
+	// Used by FSR_WHEN_READY: true once the host display has started a new refresh since the last full-speed present.
+	// Frontends override this with a vsync/present-queue query; the default just waits for a 60Hz refresh period.
+	virtual bool IsReadyToPresent(void);
+
+	struct VideoFrameStats_t
+	{
+		UINT64 numFramesEmulated;	// Video frames (ie. VBLs) that the emulation ran through
+		UINT64 numFramesRendered;	// Frames that the Apple II video buffer was generated for
+		UINT64 numFramesPresented;	// Frames that were copied to the host's screen
+		UINT64 numFramesSkipped;	// Full-speed frames that weren't redrawn, as set by SetFullSpeedRedraw()
+	};
+	const VideoFrameStats_t& GetVideoFrameStats(void) { return m_videoFrameStats; }
+	void LogVideoFrameStats(void);
+	void CountFramePresented(void) { m_videoFrameStats.numFramesPresented++; }	// called by VideoPresentScreen() once it has drawn to the host's screen
+
 	void Video_RedrawAndTakeScreenShot(const char* pScreenshotFilename);
 
 	virtual std::string Video_GetScreenShotFolder() const = 0;
@@ -79,6 +106,10 @@ private:
 	bool g_bShowPrintScreenWarningDialog;
 
 	DWORD dwFullSpeedStartTime;
+	FullSpeedRedraw_e m_fullSpeedRedraw;
+	UINT m_fullSpeedFrameSkip;
+	UINT m_fullSpeedFrameCount;
+	VideoFrameStats_t m_videoFrameStats;
 	bool g_bDisplayPrintScreenFileName;
 
 	int g_nLastScreenShot;
@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Interface.h"
 #include "CPU.h"
 #include "DiskImage.h"	// ImageError_e, Disk_Status_e
+#include "Log.h"
 #include "Memory.h"
 #include "Registry.h"
 #include "SaveState.h"
@@ -146,6 +147,8 @@ HarddiskInterfaceCard::HarddiskInterfaceCard(UINT slot) :
 	m_notBusyCycle = 0;
 
 	m_saveDiskImage = true;	// Save the DiskImage name to Registry
+
+	ResetStats();
 }
 
 HarddiskInterfaceCard::~HarddiskInterfaceCard(void)
@@ -160,6 +163,61 @@ void HarddiskInterfaceCard::Reset(const bool powerCycle)
 	m_hardDiskDrive[HARDDISK_2].m_error = 0;
 }
 
+void HarddiskInterfaceCard::ResetStats(void)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(&m_unpluggedBlockCacheStats, 0, sizeof(m_unpluggedBlockCacheStats));
+}
+
+static void AddBlockCacheStats(HarddiskBlockCache::Stats_t& total, const HarddiskBlockCache::Stats_t& stats)
+{
+	total.hits += stats.hits;
+	total.misses += stats.misses;
+	total.readAheadBlocks += stats.readAheadBlocks;
+	total.readAheadHits += stats.readAheadHits;
+	total.hostReadBlocks += stats.hostReadBlocks;
+	total.hostReadMicroseconds += stats.hostReadMicroseconds;
+	total.blocksWritten += stats.blocksWritten;
+	total.hostWrites += stats.hostWrites;
+	total.hostWriteBlocks += stats.hostWriteBlocks;
+	total.hostWriteMicroseconds += stats.hostWriteMicroseconds;
+}
+
+HarddiskBlockCache::Stats_t HarddiskInterfaceCard::GetBlockCacheStats(void)
+{
+	HarddiskBlockCache::Stats_t total = m_unpluggedBlockCacheStats;
+	for (UINT i = HARDDISK_1; i < NUM_HARDDISKS; i++)
+		AddBlockCacheStats(total, m_hardDiskDrive[i].m_blockCache.GetStats());
+	return total;
+}
+
+// For -disk-stats (and the debugger): a single JSON object
+std::string HarddiskInterfaceCard::GetStatsJson(void)
+{
+	const HarddiskBlockCache::Stats_t cache = GetBlockCacheStats();
+
+	return StrFormat("{\"slot\": %u, \"type\": \"HDD\", \"blocksRead\": %llu, \"blocksWritten\": %llu, \"errors\": %llu, \"dmaCycles\": %llu, "
+		"\"cacheHits\": %llu, \"cacheMisses\": %llu, \"readAheadBlocks\": %llu, \"readAheadHits\": %llu, "
+		"\"hostReadBlocks\": %llu, \"hostReadMicroseconds\": %llu, \"writeBacks\": %llu, \"hostWriteBlocks\": %llu, \"hostWriteMicroseconds\": %llu}",
+		m_slot,
+		(unsigned long long)m_stats.blocksRead, (unsigned long long)m_stats.blocksWritten,
+		(unsigned long long)m_stats.errors, (unsigned long long)m_stats.dmaCycles,
+		(unsigned long long)cache.hits, (unsigned long long)cache.misses,
+		(unsigned long long)cache.readAheadBlocks, (unsigned long long)cache.readAheadHits,
+		(unsigned long long)cache.hostReadBlocks, (unsigned long long)cache.hostReadMicroseconds,
+		(unsigned long long)cache.hostWrites, (unsigned long long)cache.hostWriteBlocks, (unsigned long long)cache.hostWriteMicroseconds);
+}
+
+// Write back the block caches once the guest has stopped writing
+void HarddiskInterfaceCard::Update(const ULONG nExecutedCycles)
+{
+	for (UINT i = HARDDISK_1; i < NUM_HARDDISKS; i++)
+	{
+		if (m_hardDiskDrive[i].m_imageloaded)
+			m_hardDiskDrive[i].m_blockCache.FlushIfIdle(m_hardDiskDrive[i].m_imagehandle);
+	}
+}
+
 //===========================================================================
 
 void HarddiskInterfaceCard::InitializeIO(LPBYTE pCxRomPeripheral)
@@ -182,6 +240,23 @@ void HarddiskInterfaceCard::CleanupDriveInternal(const int iDrive)
 {
 	if (m_hardDiskDrive[iDrive].m_imagehandle)
 	{
+		if (!m_hardDiskDrive[iDrive].m_blockCache.Flush(m_hardDiskDrive[iDrive].m_imagehandle))
+		{
+			// The image is about to be closed, so the blocks that couldn't be written back are lost
+			const UINT numLostBlocks = m_hardDiskDrive[iDrive].m_blockCache.GetNumDirtyBlocks();
+			LogFileOutput("HDD: Failed to write back %u block(s) to %s: they have been lost\n", numLostBlocks, m_hardDiskDrive[iDrive].m_fullname.c_str());
+
+			std::string strText = StrFormat("Failed to write %u block(s) back to the hard disk image:\n%s\n\nThese changes have been lost.",
+											numLostBlocks, m_hardDiskDrive[iDrive].m_fullname.c_str());
+
+			GetFrame().FrameMessageBox(strText.c_str(),
+									   g_pAppTitle.c_str(),
+									   MB_ICONEXCLAMATION | MB_SETFOREGROUND);
+		}
+		m_hardDiskDrive[iDrive].m_blockCache.LogStats(m_hardDiskDrive[iDrive].m_fullname);
+		AddBlockCacheStats(m_unpluggedBlockCacheStats, m_hardDiskDrive[iDrive].m_blockCache.GetStats());
+		m_hardDiskDrive[iDrive].m_blockCache.Reset();
+
 		ImageClose(m_hardDiskDrive[iDrive].m_imagehandle);
 		m_hardDiskDrive[iDrive].m_imagehandle = NULL;
 	}
@@ -488,11 +563,16 @@ BYTE __stdcall HarddiskInterfaceCard::IORead(WORD pc, WORD addr, BYTE bWrite, BY
 						}
 						break;
 					case 0x01: //read
-						if ((pHDD->m_diskblock * HD_BLOCK_SIZE) < ImageGetImageSize(pHDD->m_imagehandle))
+						if ((pHDD->m_diskblock * HD_BLOCK_SIZE) < ImageGetImageSize(pHDD->m_imagehandle)
+							|| pHDD->m_diskblock < pCard->GetImageSizeInBlocks(pHDD->m_imagehandle))
 						{
 							bool breakpointHit = false;
 
-							bool bRes = ImageReadBlock(pHDD->m_imagehandle, pHDD->m_diskblock, pHDD->m_buf);
+							bool bRes = true;
+							if ((pHDD->m_diskblock * HD_BLOCK_SIZE) < ImageGetImageSize(pHDD->m_imagehandle))
+								bRes = pHDD->m_blockCache.Read(pHDD->m_imagehandle, pHDD->m_diskblock, pHDD->m_buf);
+							else
+								memset(pHDD->m_buf, 0, HD_BLOCK_SIZE);	// Sparse: beyond the end of the image (but within the volume), so not yet written - see GetImageSizeInBlocks()
 							if (bRes)
 							{
 								pHDD->m_buf_ptr = 0;
@@ -536,6 +616,8 @@ BYTE __stdcall HarddiskInterfaceCard::IORead(WORD pc, WORD addr, BYTE bWrite, BY
 							{
 								pHDD->m_error = 0;
 								r = 0;
+								pCard->m_stats.blocksRead++;
+								pCard->m_stats.dmaCycles += CYCLES_FOR_DMA_RW_BLOCK;
 
 								if (!breakpointHit)
 									pCard->m_notBusyCycle = g_nCumulativeCycles + (UINT64)CYCLES_FOR_DMA_RW_BLOCK;
@@ -544,35 +626,23 @@ BYTE __stdcall HarddiskInterfaceCard::IORead(WORD pc, WORD addr, BYTE bWrite, BY
 							{
 								pHDD->m_error = 1;
 								r = DEVICE_IO_ERROR;
+								pCard->m_stats.errors++;
 							}
 						}
 						else
 						{
 							pHDD->m_error = 1;
 							r = DEVICE_IO_ERROR;
+							pCard->m_stats.errors++;
 						}
 						break;
 					case 0x02: //write
 						{
 							pHDD->m_status_next = DISK_STATUS_WRITE;	// or DISK_STATUS_PROT if we ever enable write-protect on HDD
 							bool bRes = true;
-							const bool bAppendBlocks = (pHDD->m_diskblock * HD_BLOCK_SIZE) >= ImageGetImageSize(pHDD->m_imagehandle);
 							bool breakpointHit = false;
 
-							if (bAppendBlocks)
-							{
-								memset(pHDD->m_buf, 0, HD_BLOCK_SIZE);
-
-								// Inefficient (especially for gzip/zip files!)
-								UINT uBlock = ImageGetImageSize(pHDD->m_imagehandle) / HD_BLOCK_SIZE;
-								while (uBlock < pHDD->m_diskblock)
-								{
-									bRes = ImageWriteBlock(pHDD->m_imagehandle, uBlock++, pHDD->m_buf);
-									_ASSERT(bRes);
-									if (!bRes)
-										break;
-								}
-							}
+							// NB. Writing past the end of the image grows it in one step (the skipped blocks read as zero), so no need to append zero blocks up to m_diskblock
 
 							// Trap and error on any accesses that overlap with I/O memory (GH#1007)
 							if ((pHDD->m_memblock < APPLE_IO_BEGIN && ((pHDD->m_memblock + HD_BLOCK_SIZE - 1) >= APPLE_IO_BEGIN))	// 1) Starts before I/O, but ends in I/O memory
@@ -610,12 +680,14 @@ BYTE __stdcall HarddiskInterfaceCard::IORead(WORD pc, WORD addr, BYTE bWrite, BY
 							}
 
 							if (bRes)
-								bRes = ImageWriteBlock(pHDD->m_imagehandle, pHDD->m_diskblock, pHDD->m_buf);
+								bRes = pHDD->m_blockCache.Write(pHDD->m_imagehandle, pHDD->m_diskblock, pHDD->m_buf);
 
 							if (bRes)
 							{
 								pHDD->m_error = 0;
 								r = 0;
+								pCard->m_stats.blocksWritten++;
+								pCard->m_stats.dmaCycles += CYCLES_FOR_DMA_RW_BLOCK;
 
 								if (!breakpointHit)
 									pCard->m_notBusyCycle = g_nCumulativeCycles + (UINT64)CYCLES_FOR_DMA_RW_BLOCK;
@@ -624,6 +696,7 @@ BYTE __stdcall HarddiskInterfaceCard::IORead(WORD pc, WORD addr, BYTE bWrite, BY
 							{
 								pHDD->m_error = 1;
 								r = DEVICE_IO_ERROR;
+								pCard->m_stats.errors++;
 							}
 						}
 						break;
@@ -748,6 +821,8 @@ BYTE __stdcall HarddiskInterfaceCard::IOWrite(WORD pc, WORD addr, BYTE bWrite, B
 	return r;
 }
 
+// NB. Blocks past the end of the image file only read as zero when m_userNumBlocks (ie. -harddisknumblocks) makes the volume larger than the file.
+// Otherwise the volume is the file's size (capped at kHarddiskMaxNumBlocks), so reading past the end of the file is an I/O error.
 UINT HarddiskInterfaceCard::GetImageSizeInBlocks(ImageInfo* const pImageInfo)
 {
 	if (m_userNumBlocks != 0)
@@ -849,6 +924,13 @@ void HarddiskInterfaceCard::SaveSnapshot(YamlSaveHelper& yamlSaveHelper)
 	yamlSaveHelper.SaveHexUint8(SS_YAML_KEY_COMMAND, m_command);
 	yamlSaveHelper.SaveHexUint64(SS_YAML_KEY_NOT_BUSY_CYCLE, m_notBusyCycle);
 
+	// Ensure the image files are consistent with the save-state
+	for (UINT i = HARDDISK_1; i < NUM_HARDDISKS; i++)
+	{
+		if (m_hardDiskDrive[i].m_imageloaded)
+			m_hardDiskDrive[i].m_blockCache.Flush(m_hardDiskDrive[i].m_imagehandle);
+	}
+
 	SaveSnapshotHDDUnit(yamlSaveHelper, HARDDISK_1);
 	SaveSnapshotHDDUnit(yamlSaveHelper, HARDDISK_2);
 }
@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Card.h"
 #include "DiskImage.h"
 #include "DiskImageHelper.h"
+#include "HarddiskBlockCache.h"
 
 enum HardDrive_e
 {
@@ -61,6 +62,7 @@ public:
 		memset(m_buf, 0, sizeof(m_buf));
 		m_status_next = DISK_STATUS_OFF;
 		m_status_prev = DISK_STATUS_OFF;
+		m_blockCache.Reset();
 	}
 
 	// From FloppyDisk
@@ -79,6 +81,8 @@ public:
 
 	Disk_Status_e m_status_next;
 	Disk_Status_e m_status_prev;
+
+	HarddiskBlockCache m_blockCache;
 };
 
 class HarddiskInterfaceCard : public Card
@@ -88,7 +92,7 @@ public:
 	virtual ~HarddiskInterfaceCard(void);
 
 	virtual void Reset(const bool powerCycle);
-	virtual void Update(const ULONG nExecutedCycles) {}
+	virtual void Update(const ULONG nExecutedCycles);
 
 	virtual void InitializeIO(LPBYTE pCxRomPeripheral);
 	virtual void Destroy(void);
@@ -106,6 +110,19 @@ public:
 	void GetLightStatus(Disk_Status_e* pDisk1Status);
 	bool ImageSwap(void);
 
+	struct Stats_t
+	{
+		UINT64 blocksRead;
+		UINT64 blocksWritten;
+		UINT64 errors;
+		UINT64 dmaCycles;		// emulated time the interface was busy doing DMA
+	};
+
+	const Stats_t& GetStats(void) { return m_stats; }
+	void ResetStats(void);
+	HarddiskBlockCache::Stats_t GetBlockCacheStats(void);	// both drives, including previously unplugged images
+	std::string GetStatsJson(void);
+
 	static const std::string& GetSnapshotCardName(void);
 	virtual void SaveSnapshot(YamlSaveHelper& yamlSaveHelper);
 	virtual bool LoadSnapshot(YamlLoadHelper& yamlLoadHelper, UINT version);
@@ -136,4 +153,7 @@ private:
 	bool m_saveDiskImage;	// Save the DiskImage name to Registry
 
 	HardDiskDrive m_hardDiskDrive[NUM_HARDDISKS];
+
+	Stats_t m_stats;
+	HarddiskBlockCache::Stats_t m_unpluggedBlockCacheStats;
 };
@@ -0,0 +1,315 @@
+/*
+AppleWin : An Apple //e emulator for Windows
+
+Copyright (C) 1994-1996, Michael O'Brien
+Copyright (C) 1999-2001, Oliver Schmidt
+Copyright (C) 2002-2005, Tom Charlesworth
+Copyright (C) 2006-2024, Tom Charlesworth, Michael Pohoreski, Nick Westgate
+
+AppleWin is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+AppleWin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with AppleWin; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Description: Hard disk block cache
+ *
+ * ProDOS loads a file as a sequence of single-block reads, and each one was a host seek+read.
+ * On slow (eg. network) storage this stalls the emulator. Now sequential reads are detected and
+ * read ahead in one host read, and writes are coalesced into contiguous runs.
+ *
+ * Author: Various
+ */
+
+#include "StdAfx.h"
+
+#include "HarddiskBlockCache.h"
+#include "Common.h"
+#include "CPU.h"
+#include "DiskImage.h"
+#include "Log.h"
+
+#include <chrono>
+
+HarddiskBlockCache::HarddiskBlockCache(void)
+{
+	Reset();
+}
+
+void HarddiskBlockCache::Reset(void)
+{
+	_ASSERT(m_blocks.empty() || m_numDirty == 0);
+
+	m_blocks.clear();
+	m_lru.clear();
+	m_numDirty = 0;
+	m_nextSequentialBlock = (UINT)-1;
+	m_lastWriteCycle = 0;
+	m_deferredWriteError = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//===========================================================================
+
+// Only images where each block access is a host file seek+read/write (ie. not gzip/zip, which are in memory)
+bool HarddiskBlockCache::IsCacheable(ImageInfo* pImageInfo)
+{
+	return pImageInfo->FileType == eFileNormal;
+}
+
+void HarddiskBlockCache::Touch(Block_t& entry, const UINT block)
+{
+	m_lru.erase(entry.lru);
+	m_lru.push_front(block);
+	entry.lru = m_lru.begin();
+}
+
+// Returns NULL if the cache is full, and its least recently used block is dirty and can't be written back
+HarddiskBlockCache::Block_t* HarddiskBlockCache::Insert(ImageInfo* pImageInfo, const UINT block)
+{
+	std::map<UINT, Block_t>::iterator it = m_blocks.find(block);
+	if (it != m_blocks.end())
+	{
+		Touch(it->second, block);
+		return &it->second;
+	}
+
+	// Evict the least recently used block (writing back all dirty blocks first, if necessary)
+	if (m_blocks.size() >= kMaxBlocks)
+	{
+		std::map<UINT, Block_t>::iterator lruIt = m_blocks.find(m_lru.back());
+		if (lruIt->second.dirty)
+			Flush(pImageInfo);
+
+		if (lruIt->second.dirty)
+			return NULL;	// the flush failed: don't lose the write, but don't grow the cache either
+
+		m_lru.pop_back();
+		m_blocks.erase(lruIt);
+	}
+
+	Block_t& entry = m_blocks[block];
+	entry.dirty = false;
+	entry.readAhead = false;
+	m_lru.push_front(block);
+	entry.lru = m_lru.begin();
+	return &entry;
+}
+
+//===========================================================================
+
+bool HarddiskBlockCache::Read(ImageInfo* pImageInfo, const UINT block, BYTE* pBlockBuffer)
+{
+	if (!IsCacheable(pImageInfo))
+		return ImageReadBlock(pImageInfo, block, pBlockBuffer);
+
+	std::map<UINT, Block_t>::iterator it = m_blocks.find(block);
+	if (it != m_blocks.end())
+	{
+		m_stats.hits++;
+		if (it->second.readAhead)
+		{
+			m_stats.readAheadHits++;
+			it->second.readAhead = false;
+		}
+
+		memcpy(pBlockBuffer, it->second.data, HD_BLOCK_SIZE);
+		Touch(it->second, block);
+		m_nextSequentialBlock = block + 1;
+		return true;
+	}
+
+	m_stats.misses++;
+
+	// Sequential miss: read ahead (but not over any blocks that are already cached, as these may be dirty)
+	UINT numBlocks = 1;
+	if (block == m_nextSequentialBlock)
+	{
+		const UINT numImageBlocks = ImageGetImageSize(pImageInfo) / HD_BLOCK_SIZE;
+		if (block < numImageBlocks)
+			numBlocks = MIN(kReadAheadBlocks, numImageBlocks - block);
+
+		for (UINT i = 1; i < numBlocks; i++)
+		{
+			if (m_blocks.find(block + i) != m_blocks.end())
+			{
+				numBlocks = i;
+				break;
+			}
+		}
+	}
+
+	m_nextSequentialBlock = block + 1;
+
+	m_hostBuffer.resize(numBlocks * HD_BLOCK_SIZE);
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool res = ImageReadBlocks(pImageInfo, block, numBlocks, &m_hostBuffer[0]);
+	if (!res && numBlocks > 1)
+	{
+		numBlocks = 1;
+		res = ImageReadBlocks(pImageInfo, block, numBlocks, &m_hostBuffer[0]);
+	}
+	m_stats.hostReadMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if (!res)
+		return false;
+
+	m_stats.hostReadBlocks += numBlocks;
+	m_stats.readAheadBlocks += numBlocks - 1;
+
+	memcpy(pBlockBuffer, &m_hostBuffer[0], HD_BLOCK_SIZE);
+
+	for (UINT i = 0; i < numBlocks; i++)
+	{
+		Block_t* pEntry = Insert(pImageInfo, block + i);
+		if (!pEntry)
+		{
+			m_deferredWriteError = true;	// the block read is still good, but report the failed write-back
+			break;
+		}
+
+		memcpy(pEntry->data, &m_hostBuffer[i * HD_BLOCK_SIZE], HD_BLOCK_SIZE);
+		pEntry->readAhead = (i != 0);
+	}
+
+	return true;
+}
+
+bool HarddiskBlockCache::Write(ImageInfo* pImageInfo, const UINT block, const BYTE* pBlockBuffer)
+{
+	if (!IsCacheable(pImageInfo))
+		return ImageWriteBlock(pImageInfo, block, (LPBYTE)pBlockBuffer);
+
+	if (pImageInfo->bWriteProtected)
+		return false;
+
+	if (m_deferredWriteError)
+	{
+		m_deferredWriteError = false;
+		return false;
+	}
+
+	m_stats.blocksWritten++;
+
+	// Growing the image: write-through (after any pending writes), so that the image's size is always up to date
+	if ((block + 1) * HD_BLOCK_SIZE > ImageGetImageSize(pImageInfo))
+	{
+		if (!Flush(pImageInfo))
+			return false;
+
+		std::map<UINT, Block_t>::iterator it = m_blocks.find(block);	// eg. a partial last block
+		if (it != m_blocks.end())
+		{
+			m_lru.erase(it->second.lru);
+			m_blocks.erase(it);
+		}
+
+		return ImageWriteBlock(pImageInfo, block, (LPBYTE)pBlockBuffer);
+	}
+
+	Block_t* pEntry = Insert(pImageInfo, block);
+	if (!pEntry)
+		return false;
+
+	memcpy(pEntry->data, pBlockBuffer, HD_BLOCK_SIZE);
+	pEntry->readAhead = false;
+	if (!pEntry->dirty)
+	{
+		pEntry->dirty = true;
+		m_numDirty++;
+	}
+
+	m_lastWriteCycle = g_nCumulativeCycles;
+
+	if (m_numDirty >= kMaxDirtyBlocks)
+		return Flush(pImageInfo);
+
+	return true;
+}
+
+// Write back all dirty blocks, coalescing contiguous blocks into a single host write
+bool HarddiskBlockCache::Flush(ImageInfo* pImageInfo)
+{
+	if (m_numDirty == 0)
+		return true;
+
+	bool res = true;
+	std::map<UINT, Block_t>::iterator it = m_blocks.begin();
+
+	while (it != m_blocks.end())
+	{
+		if (!it->second.dirty)
+		{
+			++it;
+			continue;
+		}
+
+		const UINT firstBlock = it->first;
+		std::vector<Block_t*> run;
+		while (it != m_blocks.end() && it->second.dirty && it->first == firstBlock + run.size())
+		{
+			run.push_back(&it->second);
+			++it;
+		}
+
+		m_hostBuffer.resize(run.size() * HD_BLOCK_SIZE);
+		for (UINT i = 0; i < run.size(); i++)
+			memcpy(&m_hostBuffer[i * HD_BLOCK_SIZE], run[i]->data, HD_BLOCK_SIZE);
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const bool runRes = ImageWriteBlocks(pImageInfo, firstBlock, run.size(), &m_hostBuffer[0]);
+		m_stats.hostWriteMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		if (!runRes)
+		{
+			LogFileOutput("HDD: Failed to write back blocks $%04X-$%04X\n", firstBlock, firstBlock + (UINT)run.size() - 1);
+			res = false;
+			continue;	// keep them dirty
+		}
+
+		m_stats.hostWrites++;
+		m_stats.hostWriteBlocks += run.size();
+
+		for (UINT i = 0; i < run.size(); i++)
+			run[i]->dirty = false;
+		m_numDirty -= run.size();
+	}
+
+	return res;
+}
+
+void HarddiskBlockCache::FlushIfIdle(ImageInfo* pImageInfo)
+{
+	if (m_numDirty && g_nCumulativeCycles - m_lastWriteCycle >= kIdleFlushCycles)
+	{
+		if (!Flush(pImageInfo))
+		{
+			m_deferredWriteError = true;
+			m_lastWriteCycle = g_nCumulativeCycles;	// retry after another idle period
+		}
+	}
+}
+
+void HarddiskBlockCache::LogStats(const std::string& name)
+{
+	if (m_stats.hits + m_stats.misses + m_stats.blocksWritten == 0)
+		return;
+
+	LogFileOutput("HDD: Block cache for %s: hits=%u, misses=%u, read-ahead=%u (used=%u), host reads=%u blocks (avg %u us/block), guest writes=%u, host writes=%u (%u blocks, avg %u us/block)\n",
+		name.c_str(),
+		(UINT)m_stats.hits, (UINT)m_stats.misses,
+		(UINT)m_stats.readAheadBlocks, (UINT)m_stats.readAheadHits,
+		(UINT)m_stats.hostReadBlocks, m_stats.hostReadBlocks ? (UINT)(m_stats.hostReadMicroseconds / m_stats.hostReadBlocks) : 0,
+		(UINT)m_stats.blocksWritten,
+		(UINT)m_stats.hostWrites, (UINT)m_stats.hostWriteBlocks, m_stats.hostWriteBlocks ? (UINT)(m_stats.hostWriteMicroseconds / m_stats.hostWriteBlocks) : 0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <list>
+#include <map>
+
+#include "DiskImageHelper.h"
+
+// Block cache for a hard disk image, with sequential read-ahead & write-back coalescing
+// . Only used for uncompressed images (ie. where each block is a host file seek+read/write)
+// . A miss on the block following the previous read reads ahead kReadAheadBlocks in a single host read
+// . Writes are held in the cache and written back in contiguous runs: when kMaxDirtyBlocks are dirty, when the guest has been idle for kIdleFlushCycles, or on Flush()
+// . Writes that grow the image are written through
+// . A failed write-back keeps the blocks dirty (to retry), and is returned to the guest: by the write that triggered it, else by the next write
+// . If the cache is full and its least recently used block can't be written back, then the write fails (rather than growing the cache)
+
+class HarddiskBlockCache
+{
+public:
+	HarddiskBlockCache(void);
+	~HarddiskBlockCache(void) {}
+
+	void Reset(void);	// Pre: Flush()
+	bool Read(ImageInfo* pImageInfo, const UINT block, BYTE* pBlockBuffer);
+	bool Write(ImageInfo* pImageInfo, const UINT block, const BYTE* pBlockBuffer);
+	bool Flush(ImageInfo* pImageInfo);
+	void FlushIfIdle(ImageInfo* pImageInfo);
+	void LogStats(const std::string& name);
+	UINT GetNumDirtyBlocks(void) { return m_numDirty; }
+
+	struct Stats_t
+	{
+		UINT64 hits;
+		UINT64 misses;
+		UINT64 readAheadBlocks;			// speculatively read
+		UINT64 readAheadHits;			// ... and subsequently used
+		UINT64 hostReadBlocks;
+		UINT64 hostReadMicroseconds;
+		UINT64 blocksWritten;			// by the guest
+		UINT64 hostWrites;				// # coalesced host writes
+		UINT64 hostWriteBlocks;
+		UINT64 hostWriteMicroseconds;
+	};
+
+	const Stats_t& GetStats(void) { return m_stats; }
+
+private:
+	struct Block_t
+	{
+		BYTE data[HD_BLOCK_SIZE];
+		bool dirty;
+		bool readAhead;					// read ahead, and not yet used
+		std::list<UINT>::iterator lru;
+	};
+
+	static bool IsCacheable(ImageInfo* pImageInfo);
+	Block_t* Insert(ImageInfo* pImageInfo, const UINT block);
+	void Touch(Block_t& entry, const UINT block);
+
+	static const UINT kMaxBlocks = 1024;			// 512KB
+	static const UINT kReadAheadBlocks = 64;
+	static const UINT kMaxDirtyBlocks = 256;
+	static const UINT kIdleFlushCycles = 1020484 / 2;	// ~0.5 sec
+
+	std::map<UINT, Block_t> m_blocks;		// ordered, so that dirty blocks can be coalesced into contiguous runs
+	std::list<UINT> m_lru;					// most recently used at the front
+	UINT m_numDirty;
+	UINT m_nextSequentialBlock;
+	UINT64 m_lastWriteCycle;
+	bool m_deferredWriteError;				// a write-back not triggered by a guest write has failed
+	std::vector<BYTE> m_hostBuffer;
+
+	Stats_t m_stats;
+};
@@ -30,6 +30,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	#include "VidHD.h"
 
 	#include "NTSC_CharSet.h"
+	#include "NTSC_ModeChange.h"
+	#include "NTSC_TVPixels.h"
+	#include "Log.h"
+	#include "StrFormat.h"
+
+	#include <chrono>
 
 // Some reference material here from 2000:
 // http://www.kreativekorp.com/miscpages/a2info/munafo.shtml
@@ -78,8 +84,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	static int g_nHiresPage    = 1;
 	static int g_nTextPage     = 1;
 
-	static bool g_bDelayVideoMode = false;	// NB. No need to save to save-state, as it will be done immediately after opcode completes in NTSC_VideoUpdateCycles()
-	static uint32_t g_uNewVideoModeFlags = 0;
+	static uint32_t g_uNewVideoModeFlags = 0;		// Most recently set mode (may not be rendered yet, see g_aVideoModeChanges[])
+	static uint32_t g_uVideoModeFlagsApplied = 0;	// Mode that the renderer is currently using
+
+	// Video mode change log (see NTSC_ModeChange.h)
+	// . NTSC_VideoUpdateCycles() renders up to each change, then switches mode
+	// NB. No need to save to save-state, as the log is emptied once the opcode completes in NTSC_VideoUpdateCycles()
+	static const UINT kMaxVideoModeChanges = 8;
+	static VideoModeChange_t g_aVideoModeChanges[kMaxVideoModeChanges];
+	static UINT g_nNumVideoModeChanges = 0;
 
 	// Understanding the Apple II, Timing Generation and the Video Scanner, Pg 3-11
 	// Vertical Scanning
@@ -120,6 +133,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	typedef void (*UpdatePixelFunc_t)(uint16_t);
 	static UpdatePixelFunc_t g_pFuncUpdateBnWPixel = 0; //updatePixelBnWMonitorSingleScanline;
 	static UpdatePixelFunc_t g_pFuncUpdateHuePixel = 0; //updatePixelHueMonitorSingleScanline;
+	static UpdatePixelFunc_t g_pFuncUpdateBnWPixels = 0; // TV modes only: all 14 pixels at once (updatePixelsBnWColorTVSingleScanline), else NULL
+	static UpdatePixelFunc_t g_pFuncUpdateHuePixels = 0; // TV modes only: all 14 pixels at once (updatePixelsHueColorTVSingleScanline), else NULL
+
+	// SHR: the current scanline's decoded SCB & palette
+	static VidHDCard::SHRLine_t g_SHRLine;
+	static const UINT kSHRLineInvalid = (UINT)-1;
+	static UINT g_nSHRLineVert = kSHRLineInvalid;
 
 	static uint8_t  g_nTextFlashCounter = 0;
 	static uint16_t g_nTextFlashMask    = 0;
@@ -148,6 +168,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	static bgra_t g_aBnWMonitorCustom           [NTSC_NUM_SEQUENCES];
 	static bgra_t g_aBnWColorTVCustom           [NTSC_NUM_SEQUENCES];
 
+	// The chroma tables have no run-time parameters, so only build them once per process (or load them from the table cache file)
+	static bool g_bChromaTablesValid = false;
+	static std::string g_sTableCacheFile;	// Optional: see NTSC_SetTableCacheFile()
+
+	// GenerateVideoTables() only depends on the refresh rate (ie. g_videoScannerMaxVert)
+	static UINT g_nVideoTablesMaxVert = 0;
+
 	#define CHROMA_ZEROS 2
 	#define CHROMA_POLES 2
 	#define CHROMA_GAIN  7.438011255f // Should this be 7.15909 MHz ?
@@ -311,6 +338,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 	static csbits_t csbits;		// charset, optionally followed by alt charset
 
+	// Glyph-row cache for the TEXT modes: per char, per glyph row, with flash already applied
+	// . [charset][flash][row][char]
+	// . TEXT40: 7->14 pixel doubled bits (as g_aPixelDoubleMaskHGR), TEXT80 (and the RGB text modes): raw char set bits
+	// . Built on demand for each of the 2 char sets, invalidated when /csbits/ changes (see set_csbits())
+	static uint16_t g_aText40GlyphBits[2][2][8][256];
+	static uint16_t g_aText80GlyphBits[2][2][8][256];
+	static bool g_bTextGlyphBitsValid[2] = { false, false };
+
+	// Set when the Video is tracking which lines change between presented frames (see updateDirtyLines())
+	static DirtyLineTracker* g_pDirtyLineTracker = NULL;
+
 // Prototypes
 	INLINE void      updateFramebufferTVSingleScanline( uint16_t signal, bgra_t *pTable );
 	INLINE void      updateFramebufferTVDoubleScanline( uint16_t signal, bgra_t *pTable );
@@ -319,6 +357,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 	INLINE void      updatePixels( uint16_t bits );
 	INLINE void      updateVideoScannerHorzEOL();
 	INLINE void      updateVideoScannerAddress();
+	static void      updateDirtyLines(bool isSHR);
 
 	static void initChromaPhaseTables();
 	static real initFilterChroma   (real z);
@@ -369,6 +408,8 @@ static void set_csbits()
 	case A2TYPE_BASE64A:		csbits = &csbits_base64a[GetVideo().GetVideoRomRockerSwitch() ? 0 : 1]; g_nVideoCharSet = 0; break; // Apple ][ clone
 	default: _ASSERT(0);		csbits = &csbits_enhanced2e[0]; break;
 	}
+
+	g_bTextGlyphBitsValid[0] = g_bTextGlyphBitsValid[1] = false;
 }
 
 //===========================================================================
@@ -380,9 +421,48 @@ inline float clampZeroOne( const float & x )
 }
 
 //===========================================================================
-inline uint8_t getCharSetBits(int iChar)
+static void initTextGlyphBits(const int charSet)
+{
+	for (UINT flash = 0; flash < 2; flash++)
+	{
+		for (UINT row = 0; row < 8; row++)
+		{
+			for (UINT ch = 0; ch < 256; ch++)
+			{
+				uint16_t c = csbits[charSet][ch][row];
+				uint16_t bits40 = g_aPixelDoubleMaskHGR[c & 0x7F]; // Optimization: hgrbits second 128 entries are mirror of first 128
+
+				if (flash && 0 == charSet && 0x40 == (ch & 0xC0)) // Flash only if mousetext not active
+				{
+					c ^= 0xFFFF;
+					bits40 ^= 0xFFFF;
+				}
+
+				g_aText40GlyphBits[charSet][flash][row][ch] = bits40;
+				g_aText80GlyphBits[charSet][flash][row][ch] = c;
+			}
+		}
+	}
+
+	g_bTextGlyphBitsValid[charSet] = true;
+}
+
+inline void validateTextGlyphBits(void)
+{
+	if (!g_bTextGlyphBitsValid[g_nVideoCharSet])
+		initTextGlyphBits(g_nVideoCharSet);
+}
+
+// Pre: validateTextGlyphBits()
+inline const uint16_t* getText40GlyphRow(void)
 {
-	return csbits[g_nVideoCharSet][iChar][g_nVideoClockVert & 7];
+	return g_aText40GlyphBits[g_nVideoCharSet][g_nTextFlashMask & 1][g_nVideoClockVert & 7];
+}
+
+// Pre: validateTextGlyphBits()
+inline const uint16_t* getText80GlyphRow(void)
+{
+	return g_aText80GlyphBits[g_nVideoCharSet][g_nTextFlashMask & 1][g_nVideoClockVert & 7];
 }
 
 //===========================================================================
@@ -410,6 +490,13 @@ inline uint32_t* getScanlineNext()
 	return (uint32_t*) (g_pVideoAddress - 2*g_kFrameBufferWidth);
 }
 #endif
+//===========================================================================
+// GH#650: The inbetween scanline below the last AppleII scanline, else NULL
+inline uint32_t* getScanlineFinalInbetween()
+{
+	return (g_nVideoClockVert == (VIDEO_SCANNER_Y_DISPLAY-1)) ? getScanlineNextInbetween() : NULL;
+}
+
 //===========================================================================
 inline uint32_t* getScanlinePreviousInbetween()
 {
@@ -510,21 +597,8 @@ inline void updateFlashRate() // TODO: Flash rate should be constant (regardless
 // GH#650:   Prev1(inbetween) = 50% of (50% current + 50% of previous AppleII scanline)
 inline void updateFramebufferTVSingleScanline( uint16_t signal, bgra_t *pTable )
 {
-	uint32_t *pLine0Curr = getScanlineCurrent();
-	uint32_t *pLine1Prev = getScanlinePreviousInbetween();
-	uint32_t *pLine2Prev = getScanlinePrevious();
 	const uint32_t color0 = getScanlineColor( signal, pTable );
-	const uint32_t color2 = *pLine2Prev;
-	uint32_t color1 = ((color0 & 0x00fefefe) >> 1) + ((color2 & 0x00fefefe) >> 1); // 50% Blend
-	color1 = (color1 & 0x00fefefe) >> 1;	// ... then 50% brightness for inbetween line
-
-	*pLine1Prev = color1 | ALPHA32_MASK;
-	*pLine0Curr = color0;
-
-	// GH#650: Draw to final inbetween scanline to avoid residue from other video modes (eg. Amber->TV B&W)
-	if (g_nVideoClockVert == (VIDEO_SCANNER_Y_DISPLAY-1))
-		*getScanlineNextInbetween() = ((color0 & 0x00fcfcfc) >> 2) | ALPHA32_MASK;	// 50% of (50% current + black)) = 25% of current
-
+	NTSC_WriteTVPixel<false>(color0, getScanlineCurrent(), getScanlinePreviousInbetween(), getScanlinePrevious(), getScanlineFinalInbetween());
 	g_pVideoAddress++;
 }
 
@@ -533,20 +607,8 @@ inline void updateFramebufferTVSingleScanline( uint16_t signal, bgra_t *pTable )
 // Original: Prev1(inbetween) = 50% current + 50% of previous AppleII scanline
 inline void updateFramebufferTVDoubleScanline( uint16_t signal, bgra_t *pTable )
 {
-	uint32_t *pLine0Curr = getScanlineCurrent();
-	uint32_t *pLine1Prev = getScanlinePreviousInbetween();
-	uint32_t *pLine2Prev = getScanlinePrevious();
 	const uint32_t color0 = getScanlineColor( signal, pTable );
-	const uint32_t color2 = *pLine2Prev;
-	const uint32_t color1 = ((color0 & 0x00fefefe) >> 1) + ((color2 & 0x00fefefe) >> 1); // 50% Blend
-
-	*pLine1Prev = color1 | ALPHA32_MASK;
-	*pLine0Curr = color0;
-
-	// GH#650: Draw to final inbetween scanline to avoid residue from other video modes (eg. Amber->TV B&W)
-	if (g_nVideoClockVert == (VIDEO_SCANNER_Y_DISPLAY-1))
-		*getScanlineNextInbetween() = ((color0 & 0x00fefefe) >> 1) | ALPHA32_MASK;	// (50% current + black)) = 50% of current
-
+	NTSC_WriteTVPixel<true>(color0, getScanlineCurrent(), getScanlinePreviousInbetween(), getScanlinePrevious(), getScanlineFinalInbetween());
 	g_pVideoAddress++;
 }
 
@@ -598,12 +660,56 @@ void update7MonoPixels( uint16_t bits )
 
 //===========================================================================
 
+// Color TV & B&W TV: generate all 14 pixels first, then write the current & in-between scanlines together (4 pixels at a time with SSE2)
+// . Same result as calling updatePixel{BnW,Hue}ColorTV{Single,Double}Scanline() 14 times, but without the per-pixel call & blend
+template <bool isDoubleScanline>
+inline void updatePixelsTV(const bgra_t* pTables, const UINT tableStride, uint16_t bits)
+{
+	const UINT kNumPixels = 14;
+	uint32_t colors[kNumPixels];
+	g_nLastColumnPixelNTSC = (bits >> (kNumPixels-1)) & 1;
+
+	for (UINT i = 0; i < kNumPixels; i++, bits >>= 1)
+		colors[i] = NTSC_GetTVPixelColor(bits & 1, g_nSignalBitsNTSC, g_nColorPhaseNTSC, (const uint32_t*)pTables, tableStride);
+
+	NTSC_WriteTVPixels<isDoubleScanline>(colors, kNumPixels, getScanlineCurrent(), getScanlinePreviousInbetween(), getScanlinePrevious(), getScanlineFinalInbetween());
+	g_pVideoAddress += kNumPixels;
+}
+
+static void updatePixelsBnWColorTVSingleScanline(uint16_t bits)
+{
+	updatePixelsTV<false>(g_aBnWColorTVCustom, 0, bits);
+}
+
+static void updatePixelsBnWColorTVDoubleScanline(uint16_t bits)
+{
+	updatePixelsTV<true>(g_aBnWColorTVCustom, 0, bits);
+}
+
+static void updatePixelsHueColorTVSingleScanline(uint16_t bits)
+{
+	updatePixelsTV<false>(&g_aHueColorTV[0][0], NTSC_NUM_SEQUENCES, bits);
+}
+
+static void updatePixelsHueColorTVDoubleScanline(uint16_t bits)
+{
+	updatePixelsTV<true>(&g_aHueColorTV[0][0], NTSC_NUM_SEQUENCES, bits);
+}
+
+//===========================================================================
+
 // NB. g_nLastColumnPixelNTSC = bits.b13 will be superseded by these parent funcs which use bits.b14:
 // . updateScreenDoubleHires80(), updateScreenDoubleLores80(), updateScreenText80()
 inline void updatePixels(uint16_t bits)
 {
 	if (!GetColorBurst())
 	{ 
+		if (g_pFuncUpdateBnWPixels)
+		{
+			g_pFuncUpdateBnWPixels(bits);
+			return;
+		}
+
 		/* #1 of 7 */
 		g_pFuncUpdateBnWPixel(bits & 1); bits >>= 1;
 		g_pFuncUpdateBnWPixel(bits & 1); bits >>= 1;
@@ -629,6 +735,12 @@ inline void updatePixels(uint16_t bits)
 	}
 	else
 	{
+		if (g_pFuncUpdateHuePixels)
+		{
+			g_pFuncUpdateHuePixels(bits);
+			return;
+		}
+
 		/* #1 of 7 */                                // abcd efgh ijkl mnop
 		g_pFuncUpdateHuePixel(bits & 1); bits >>= 1; // 0abc defg hijk lmno
 		g_pFuncUpdateHuePixel(bits & 1); bits >>= 1; // 00ab cdef ghi jklmn
@@ -664,6 +776,9 @@ inline void updateVideoScannerHorzEOLSimple()
 		{
 			*(uint32_t*)g_pVideoAddress = 0 | ALPHA32_MASK;		// VT_COLOR_IDEALIZED: TEXT -> HGR can leave junk on RHS (GH#1106)
 			*(getScanlineNextInbetween()) = 0 | ALPHA32_MASK;	// ...and clear junk on RHS for non-'50% Scan lines'
+
+			if (g_pDirtyLineTracker)
+				updateDirtyLines(false);
 		}
 
 		g_nVideoClockHorz = 0;
@@ -708,6 +823,9 @@ inline void updateVideoScannerHorzEOL()
 				*(uint32_t*)g_pVideoAddress = 0 | ALPHA32_MASK;
 				*(getScanlineNextInbetween()) = 0 | ALPHA32_MASK; g_pVideoAddress++;	// Clear junk on RHS for TV (Color/B&W) & Monitor (NTSC/PAL). (GH#1157)
 			}
+
+			if (g_pDirtyLineTracker)
+				updateDirtyLines(false);
 		}
 
 		g_nVideoClockHorz = 0;
@@ -730,11 +848,15 @@ inline void updateVideoScannerHorzEOL_SHR()
 {
 	if (VIDEO_SCANNER_MAX_HORZ == ++g_nVideoClockHorz)
 	{
+		if (g_pDirtyLineTracker && g_nVideoClockVert < VIDEO_SCANNER_Y_DISPLAY_IIGS)
+			updateDirtyLines(true);
+
 		g_nVideoClockHorz = 0;
 
 		if (++g_nVideoClockVert == g_videoScannerMaxVert)
 		{
 			g_nVideoClockVert = 0;
+			g_nSHRLineVert = kSHRLineInvalid;
 		}
 
 		if (g_nVideoClockVert < VIDEO_SCANNER_Y_DISPLAY_IIGS)
@@ -744,6 +866,39 @@ inline void updateVideoScannerHorzEOL_SHR()
 	}
 }
 
+//===========================================================================
+
+// Called at the end of each visible scanline: report its finished framebuffer rows to the dirty line tracker
+// . A scanline renders framebuffer rows 2*vert (current) and 2*vert+1 (in-between, below), but TV styles also blend into
+//   the in-between row above (2*vert-1). So the in-between row below is only finished by the next scanline (or if it's the last)
+// . The rows are still in the cache, so hashing them here is much cheaper than comparing whole frames at present time
+static void updateDirtyLines(bool isSHR)
+{
+	const UINT width = GetVideo().GetFrameBufferBorderlessWidth();
+	const UINT row = 2 * g_nVideoClockVert;
+
+	if (isSHR)
+	{
+		g_pDirtyLineTracker->LineRendered(row, (const uint32_t*)g_pScanLines[row], width);
+		g_pDirtyLineTracker->LineRendered(row + 1, (const uint32_t*)g_pScanLines[row + 1], width);
+		return;
+	}
+
+	// Centre the older //e video modes when running with a VidHD (see GetFrameBufferCentringValue())
+	const UINT line = row + GetVideo().GetFrameBufferCentringOffsetY();
+
+	if (g_nVideoClockVert > 0)
+		g_pDirtyLineTracker->LineRendered(line - 1, (const uint32_t*)g_pScanLines[line - 1], width);
+	g_pDirtyLineTracker->LineRendered(line, (const uint32_t*)g_pScanLines[line], width);
+	if (g_nVideoClockVert == VIDEO_SCANNER_Y_DISPLAY - 1)
+		g_pDirtyLineTracker->LineRendered(line + 1, (const uint32_t*)g_pScanLines[line + 1], width);
+}
+
+void NTSC_SetDirtyLineTracker(DirtyLineTracker* pTracker)
+{
+	g_pDirtyLineTracker = pTracker;
+}
+
 //===========================================================================
 inline void updateVideoScannerAddress()
 {
@@ -852,6 +1007,9 @@ static void ClearOverscanVideoArea(void)
 		for (uint32_t j = 0; j < kOverscanSpanR; j++)
 			pScanLine[j] = CLEAR_COLOUR_SIDE | ALPHA32_MASK;
 	}
+
+	if (g_pDirtyLineTracker)
+		g_pDirtyLineTracker->Reset(GetVideo().GetFrameBufferBorderlessHeight());	// Not written by a scanline
 }
 
 //===========================================================================
@@ -898,6 +1056,10 @@ INLINE uint16_t getVideoScannerAddressSHR()
 
 // Non-Inline _________________________________________________________
 
+// Version of the tables built by initChromaPhaseTables(), for the -ntsc-table-cache file:
+// NB. bump this whenever the filters, colours or anything else that changes the tables' contents is changed
+static const uint32_t kChromaTableFilterVersion = 1;
+
 // Build the 4 phase chroma lookup table
 // The YI'Q' colors are hard-coded
 //===========================================================================
@@ -1064,6 +1226,144 @@ static void initChromaPhaseTables (void)
 
 }
 
+// Table cache file: header, followed by the raw chroma tables
+// . The header is keyed on everything that initChromaPhaseTables() depends on at compile-time, incl. kChromaTableFilterVersion
+//===========================================================================
+struct ChromaTableCacheHeader_t
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t filterVersion;
+	uint32_t buildFlags;
+	uint32_t tableBytes;
+	uint32_t checksum;
+};
+
+static const char kChromaTableCacheMagic[8] = {'A','W','N','T','S','C',0x1a,0};
+static const uint32_t kChromaTableCacheVersion = 2;	// file format
+
+static uint32_t getChromaTableCacheBuildFlags(void)
+{
+	return (NTSC_REMOVE_WHITE_RINGING << 0)
+		| (NTSC_REMOVE_BLACK_GHOSTING << 1)
+		| (NTSC_REMOVE_GRAY_CHROMA << 2)
+		| ((uint32_t)sizeof(real) << 8)
+		| ((uint32_t)NTSC_NUM_SEQUENCES << 16);
+}
+
+static uint32_t getChromaTableCacheBytes(void)
+{
+	return sizeof(g_aBnWMonitor) + sizeof(g_aHueMonitor) + sizeof(g_aBnwColorTV) + sizeof(g_aHueColorTV);
+}
+
+static uint32_t calcChromaTableChecksum(void)
+{
+	// Fletcher-32 over the tables
+	uint32_t sum1 = 0xffff, sum2 = 0xffff;
+	const void* tables[4] = { g_aBnWMonitor, g_aHueMonitor, g_aBnwColorTV, g_aHueColorTV };
+	const size_t sizes[4] = { sizeof(g_aBnWMonitor), sizeof(g_aHueMonitor), sizeof(g_aBnwColorTV), sizeof(g_aHueColorTV) };
+
+	for (UINT t = 0; t < 4; t++)
+	{
+		const uint16_t* p = (const uint16_t*) tables[t];
+		for (size_t i = 0; i < sizes[t] / sizeof(uint16_t); i++)
+		{
+			sum1 = (sum1 + p[i]) % 0xffff;
+			sum2 = (sum2 + sum1) % 0xffff;
+		}
+	}
+
+	return (sum2 << 16) | sum1;
+}
+
+static bool loadChromaTableCache(const std::string& filename)
+{
+	FILE* hFile = fopen(filename.c_str(), "rb");
+	if (!hFile)
+		return false;
+
+	ChromaTableCacheHeader_t header;
+	bool res = fread(&header, sizeof(header), 1, hFile) == 1
+		&& memcmp(header.magic, kChromaTableCacheMagic, sizeof(header.magic)) == 0
+		&& header.version == kChromaTableCacheVersion
+		&& header.filterVersion == kChromaTableFilterVersion
+		&& header.buildFlags == getChromaTableCacheBuildFlags()
+		&& header.tableBytes == getChromaTableCacheBytes();
+
+	if (res)
+	{
+		res = fread(g_aBnWMonitor, sizeof(g_aBnWMonitor), 1, hFile) == 1
+			&& fread(g_aHueMonitor, sizeof(g_aHueMonitor), 1, hFile) == 1
+			&& fread(g_aBnwColorTV, sizeof(g_aBnwColorTV), 1, hFile) == 1
+			&& fread(g_aHueColorTV, sizeof(g_aHueColorTV), 1, hFile) == 1
+			&& header.checksum == calcChromaTableChecksum();
+	}
+
+	fclose(hFile);
+	return res;
+}
+
+static void saveChromaTableCache(const std::string& filename)
+{
+	// Write to a temp file, then rename, so that concurrent instances never see a partial file
+	const std::string tmpFilename = filename + StrFormat(".%08X.tmp", (UINT)std::chrono::steady_clock::now().time_since_epoch().count());
+	FILE* hFile = fopen(tmpFilename.c_str(), "wb");
+	if (!hFile)
+		return;
+
+	ChromaTableCacheHeader_t header;
+	memcpy(header.magic, kChromaTableCacheMagic, sizeof(header.magic));
+	header.version = kChromaTableCacheVersion;
+	header.filterVersion = kChromaTableFilterVersion;
+	header.buildFlags = getChromaTableCacheBuildFlags();
+	header.tableBytes = getChromaTableCacheBytes();
+	header.checksum = calcChromaTableChecksum();
+
+	bool res = fwrite(&header, sizeof(header), 1, hFile) == 1
+		&& fwrite(g_aBnWMonitor, sizeof(g_aBnWMonitor), 1, hFile) == 1
+		&& fwrite(g_aHueMonitor, sizeof(g_aHueMonitor), 1, hFile) == 1
+		&& fwrite(g_aBnwColorTV, sizeof(g_aBnwColorTV), 1, hFile) == 1
+		&& fwrite(g_aHueColorTV, sizeof(g_aHueColorTV), 1, hFile) == 1;
+
+	res = (fclose(hFile) == 0) && res;
+
+	if (!res || rename(tmpFilename.c_str(), filename.c_str()) != 0)
+	{
+		// rename() fails on Windows if the destination exists (eg. another instance just created it)
+		remove(tmpFilename.c_str());
+	}
+}
+
+//===========================================================================
+static bool initChromaPhaseTablesCached(void)
+{
+	if (g_bChromaTablesValid)
+		return true;
+
+	bool loaded = false;
+	if (!g_sTableCacheFile.empty())
+		loaded = loadChromaTableCache(g_sTableCacheFile);
+
+	if (!loaded)
+	{
+		initChromaPhaseTables();
+		if (!g_sTableCacheFile.empty())
+			saveChromaTableCache(g_sTableCacheFile);
+	}
+#ifdef _DEBUG
+	else
+	{
+		// Catch a change to the tables without a bump of kChromaTableFilterVersion
+		const uint32_t checksum = calcChromaTableChecksum();
+		initChromaPhaseTables();
+		_ASSERT(calcChromaTableChecksum() == checksum);
+	}
+#endif
+
+	g_bChromaTablesValid = true;
+	return loaded;
+}
+
 /*
 http://www-users.cs.york.ac.uk/~fisher/mkfilter/trad.html
 Sample Rate: ???
@@ -1693,6 +1993,8 @@ void updateScreenSingleLores40 (long cycles6502)
 //===========================================================================
 void updateScreenText40 (long cycles6502)
 {
+	validateTextGlyphBits();
+
 	for (; cycles6502 > 0; --cycles6502)
 	{
 		uint16_t addr = getVideoScannerAddressTXT();
@@ -1708,11 +2010,7 @@ void updateScreenText40 (long cycles6502)
 			{
 				uint8_t *pMain = MemGetMainPtr(addr);
 				uint8_t  m     = pMain[0];
-				uint8_t  c     = getCharSetBits(m);
-				uint16_t bits  = g_aPixelDoubleMaskHGR[c & 0x7F]; // Optimization: hgrbits second 128 entries are mirror of first 128
-
-				if (0 == g_nVideoCharSet && 0x40 == (m & 0xC0)) // Flash only if mousetext not active
-					bits ^= g_nTextFlashMask;
+				uint16_t bits  = getText40GlyphRow()[m];
 
 				updatePixels( bits );
 			}
@@ -1725,6 +2023,8 @@ void updateScreenText40 (long cycles6502)
 //===========================================================================
 void updateScreenText40RGB(long cycles6502)
 {
+	validateTextGlyphBits();
+
 	for (; cycles6502 > 0; --cycles6502)
 	{
 		uint16_t addr = getVideoScannerAddressTXT();
@@ -1740,10 +2040,7 @@ void updateScreenText40RGB(long cycles6502)
 			{
 				uint8_t* pMain = MemGetMainPtr(addr);
 				uint8_t  m = pMain[0];
-				uint8_t  c = getCharSetBits(m);
-
-				if (0 == g_nVideoCharSet && 0x40 == (m & 0xC0)) // Flash only if mousetext not active
-					c ^= g_nTextFlashMask;
+				uint8_t  c = (uint8_t) getText80GlyphRow()[m];
 
 				UpdateText40ColorCell(g_nVideoClockHorz - VIDEO_SCANNER_HORZ_START, g_nVideoClockVert, addr, g_pVideoAddress, c, m);
 				g_pVideoAddress += 14;
@@ -1758,6 +2055,8 @@ void updateScreenText40RGB(long cycles6502)
 //===========================================================================
 void updateScreenText80 (long cycles6502)
 {
+	validateTextGlyphBits();
+
 	for (; cycles6502 > 0; --cycles6502)
 	{
 		uint16_t addr = getVideoScannerAddressTXT();
@@ -1777,14 +2076,9 @@ void updateScreenText80 (long cycles6502)
 				uint8_t m = pMain[0];
 				uint8_t a = pAux [0];
 
-				uint16_t main = getCharSetBits( m );
-				uint16_t aux  = getCharSetBits( a );
-
-				if ((0 == g_nVideoCharSet) && 0x40 == (m & 0xC0)) // Flash only if mousetext not active
-					main ^= g_nTextFlashMask;
-
-				if ((0 == g_nVideoCharSet) && 0x40 == (a & 0xC0)) // Flash only if mousetext not active
-					aux ^= g_nTextFlashMask;
+				const uint16_t* pGlyphRow = getText80GlyphRow();
+				uint16_t main = pGlyphRow[m];
+				uint16_t aux  = pGlyphRow[a];
 
 				uint16_t bits = (main << 7) | (aux & 0x7f);
 				if ((GetVideo().GetVideoType() != VT_COLOR_IDEALIZED)			// No extra 14M bit needed for VT_COLOR_IDEALIZED
@@ -1802,6 +2096,8 @@ void updateScreenText80 (long cycles6502)
 //===========================================================================
 void updateScreenText80RGB(long cycles6502)
 {
+	validateTextGlyphBits();
+
 	for (; cycles6502 > 0; --cycles6502)
 	{
 		uint16_t addr = getVideoScannerAddressTXT();
@@ -1821,14 +2117,9 @@ void updateScreenText80RGB(long cycles6502)
 				uint8_t m = pMain[0];
 				uint8_t a = pAux[0];
 
-				uint16_t main = getCharSetBits(m);
-				uint16_t aux = getCharSetBits(a);
-
-				if ((0 == g_nVideoCharSet) && 0x40 == (m & 0xC0)) // Flash only if mousetext not active
-					main ^= g_nTextFlashMask;
-
-				if ((0 == g_nVideoCharSet) && 0x40 == (a & 0xC0)) // Flash only if mousetext not active
-					aux ^= g_nTextFlashMask;
+				const uint16_t* pGlyphRow = getText80GlyphRow();
+				uint16_t main = pGlyphRow[m];
+				uint16_t aux = pGlyphRow[a];
 
 				UpdateText80ColorCell(g_nVideoClockHorz - VIDEO_SCANNER_HORZ_START, g_nVideoClockVert, addr, g_pVideoAddress, (uint8_t)aux, a);
 				g_pVideoAddress += 7;
@@ -1855,20 +2146,19 @@ void updateScreenSHR(long cycles6502)
 
 			if (g_nVideoClockHorz >= VIDEO_SCANNER_HORZ_START)
 			{
+				// Fetch the scan-line control byte & decode its palette once per scanline (not per pixel)
+				// . also if rendering started mid-line (eg. after switching to SHR, or a video clock resync)
+				if (g_nVideoClockHorz == VIDEO_SCANNER_HORZ_START || g_nSHRLineVert != g_nVideoClockVert)
+				{
+					uint8_t* pControl = MemGetAuxPtr(0x9D00 + g_nVideoClockVert);	// scan-line control byte
+					VidHDCard::UpdateSHRLine(pControl[0], g_SHRLine);
+					g_nSHRLineVert = g_nVideoClockVert;
+				}
+
 				uint32_t* pAux = (uint32_t*) MemGetAuxPtr(addr);	// 8 pixels (320 mode) / 16 pixels (640 mode)
 				uint32_t a = pAux[0];
 
-				uint8_t* pControl = MemGetAuxPtr(0x9D00 + g_nVideoClockVert);	// scan-line control byte
-				uint8_t c = pControl[0];
-
-				bool is640Mode = !!(c & 0x80);
-				bool isColorFillMode = !!(c & 0x20);
-				UINT paletteSelectCode = c & 0xf;
-				const UINT kColorsPerPalette = 16;
-				const UINT kColorSize = 2;
-				uint16_t addrPalette = 0x9E00 + paletteSelectCode * kColorsPerPalette * kColorSize;
-
-				VidHDCard::UpdateSHRCell(is640Mode, isColorFillMode, addrPalette, g_pVideoAddress, a);
+				VidHDCard::UpdateSHRCell(g_SHRLine, g_pVideoAddress, a);
 				g_pVideoAddress += 16;
 			}
 		}
@@ -1908,6 +2198,7 @@ void NTSC_VideoClockResync(const DWORD dwCyclesThisFrame)
 {
 	g_nVideoClockVert = (uint16_t)(dwCyclesThisFrame / VIDEO_SCANNER_MAX_HORZ) % g_videoScannerMaxVert;
 	g_nVideoClockHorz = (uint16_t)(dwCyclesThisFrame % VIDEO_SCANNER_MAX_HORZ);
+	g_nSHRLineVert = kSHRLineInvalid;
 }
 
 //===========================================================================
@@ -1972,14 +2263,15 @@ void NTSC_SetVideoTextMode( int cols )
 }
 
 //===========================================================================
-void NTSC_SetVideoMode( uint32_t uVideoModeFlags, bool bDelay/*=false*/ )
+static void applyVideoMode( uint32_t uVideoModeFlags )
 {
-	g_uNewVideoModeFlags = uVideoModeFlags;
+	g_uVideoModeFlagsApplied = uVideoModeFlags;
 
 	if (uVideoModeFlags & VF_SHR)
 	{
 		g_pFuncUpdateGraphicsScreen = updateScreenSHR;
 		g_pFuncUpdateTextScreen = updateScreenSHR;
+		g_nSHRLineVert = kSHRLineInvalid;
 		return;
 	}
 
@@ -1989,14 +2281,6 @@ void NTSC_SetVideoMode( uint32_t uVideoModeFlags, bool bDelay/*=false*/ )
 		GetVideo().ClearFrameBuffer();
 	}
 
-	if (bDelay && !g_bFullSpeed)
-	{
-		// (GH#670) NB. if g_bFullSpeed then NTSC_VideoUpdateCycles() won't be called on the next 6502 opcode.
-		//  - Instead it's called when !g_bFullSpeed (eg. drive motor off), then the stale g_uNewVideoModeFlags will get used for NTSC_SetVideoMode()!
-		g_bDelayVideoMode = true;
-		return;
-	}
-
 	g_nVideoMixed   = uVideoModeFlags & VF_MIXED;
 	g_nVideoCharSet = GetVideo().VideoGetSWAltCharSet() ? 1 : 0;
 
@@ -2191,6 +2475,43 @@ void NTSC_SetVideoMode( uint32_t uVideoModeFlags, bool bDelay/*=false*/ )
 	}
 }
 
+//===========================================================================
+// Immediately switch the renderer to this mode (discarding any soft-switch changes still in the log)
+void NTSC_SetVideoMode( uint32_t uVideoModeFlags )
+{
+	g_uNewVideoModeFlags = uVideoModeFlags;
+	g_nNumVideoModeChanges = 0;
+	applyVideoMode(uVideoModeFlags);
+}
+
+// Soft-switch access by the current opcode: switch mode 'delayCycles' after the access
+void NTSC_LogVideoModeChange( uint32_t uVideoModeFlags, UINT delayCycles, uint16_t address, bool isWrite )
+{
+	// (GH#670) NB. if g_bFullSpeed then NTSC_VideoUpdateCycles() won't be called on the next 6502 opcode, so just switch now.
+	if (g_bFullSpeed)
+	{
+		NTSC_SetVideoMode(uVideoModeFlags);
+		return;
+	}
+
+	const uint32_t changedFlags = uVideoModeFlags ^ g_uNewVideoModeFlags;
+	g_uNewVideoModeFlags = uVideoModeFlags;
+
+	if (g_nNumVideoModeChanges == kMaxVideoModeChanges)
+	{
+		// Shouldn't happen (the log is emptied after every opcode), but just in case
+		NTSC_SetVideoMode(uVideoModeFlags);
+		return;
+	}
+
+	VideoModeChange_t& change = g_aVideoModeChanges[g_nNumVideoModeChanges++];
+	change.address = address;
+	change.isWrite = isWrite;
+	change.delayCycles = delayCycles;
+	change.changedFlags = changedFlags;
+	change.videoModeFlags = uVideoModeFlags;
+}
+
 //===========================================================================
 
 void NTSC_SetVideoStyle(void)
@@ -2199,6 +2520,8 @@ void NTSC_SetVideoStyle(void)
 	const VideoRefreshRate_e refresh = GetVideo().GetVideoRefreshRate();
 	uint8_t r, g, b;
 
+	g_pFuncUpdateBnWPixels = g_pFuncUpdateHuePixels = NULL;	// Only the TV modes have batched pixel funcs
+
 	switch ( GetVideo().GetVideoType() )
 	{
 		case VT_COLOR_TV:
@@ -2210,11 +2533,15 @@ void NTSC_SetVideoStyle(void)
 			{
 				g_pFuncUpdateBnWPixel = updatePixelBnWColorTVSingleScanline;
 				g_pFuncUpdateHuePixel = updatePixelHueColorTVSingleScanline;
+				g_pFuncUpdateBnWPixels = updatePixelsBnWColorTVSingleScanline;
+				g_pFuncUpdateHuePixels = updatePixelsHueColorTVSingleScanline;
 			}
 			else
 			{
 				g_pFuncUpdateBnWPixel = updatePixelBnWColorTVDoubleScanline;
 				g_pFuncUpdateHuePixel = updatePixelHueColorTVDoubleScanline;
+				g_pFuncUpdateBnWPixels = updatePixelsBnWColorTVDoubleScanline;
+				g_pFuncUpdateHuePixels = updatePixelsHueColorTVDoubleScanline;
 			}
 			break;
 
@@ -2242,9 +2569,15 @@ void NTSC_SetVideoStyle(void)
 			b = 0xFF;
 			updateMonochromeTables( r, g, b ); // Custom Monochrome color
 			if (half)
+			{
 				g_pFuncUpdateBnWPixel = g_pFuncUpdateHuePixel = updatePixelBnWColorTVSingleScanline;
+				g_pFuncUpdateBnWPixels = g_pFuncUpdateHuePixels = updatePixelsBnWColorTVSingleScanline;
+			}
 			else
+			{
 				g_pFuncUpdateBnWPixel = g_pFuncUpdateHuePixel = updatePixelBnWColorTVDoubleScanline;
+				g_pFuncUpdateBnWPixels = g_pFuncUpdateHuePixels = updatePixelsBnWColorTVDoubleScanline;
+			}
 			break;
 
 		case VT_MONO_AMBER:
@@ -2301,12 +2634,19 @@ void NTSC_Destroy(void)
 	memset(g_pScanLines, 0, sizeof(g_pScanLines));
 }
 
+void NTSC_SetTableCacheFile(const std::string& filename)
+{
+	g_sTableCacheFile = filename;
+}
+
 void NTSC_VideoInit( uint8_t* pFramebuffer ) // wsVideoInit
 {
+	const auto timeStart = std::chrono::steady_clock::now();
+
 	make_csbits();
 	GenerateVideoTables();
 	initPixelDoubleMasks();
-	initChromaPhaseTables();
+	const bool chromaLoaded = initChromaPhaseTablesCached();
 	updateMonochromeTables( 0xFF, 0xFF, 0xFF );
 
 	g_kFrameBufferWidth = GetVideo().GetFrameBufferWidth();
@@ -2330,6 +2670,11 @@ void NTSC_VideoInit( uint8_t* pFramebuffer ) // wsVideoInit
 	GenerateBaseColors(&baseColors);
 	VideoInitializeOriginal(&baseColors);
 
+	const auto timeEnd = std::chrono::steady_clock::now();
+	LogFileOutput("NTSC_VideoInit: %u us (chroma tables %s)\n",
+		(UINT)std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart).count(),
+		chromaLoaded ? "loaded from cache" : "computed");
+
 #if HGR_TEST_PATTERN
 // Init HGR to almost all-possible-combinations
 // CALL-151
@@ -2397,6 +2742,7 @@ void NTSC_VideoReinitialize( DWORD cyclesThisFrame, bool bInitVideoScannerAddres
 
 	g_nVideoClockVert = (uint16_t) (cyclesThisFrame / VIDEO_SCANNER_MAX_HORZ);
 	g_nVideoClockHorz = cyclesThisFrame % VIDEO_SCANNER_MAX_HORZ;
+	g_nSHRLineVert = kSHRLineInvalid;
 
 	if (bInitVideoScannerAddress)		// GH#611
 		updateVideoScannerAddress();	// Pre-condition: g_nVideoClockVert
@@ -2419,7 +2765,9 @@ void NTSC_VideoInitAppleType ()
 //===========================================================================
 void NTSC_VideoInitChroma()
 {
+	// Debugger: force a rebuild (ignoring the table cache)
 	initChromaPhaseTables();
+	g_bChromaTablesValid = true;
 }
 
 //===========================================================================
@@ -2483,16 +2831,26 @@ void NTSC_VideoUpdateCycles( UINT cycles6502 )
 
 	_ASSERT(cycles6502 && cycles6502 < g_videoScanner6502Cycles);	// Use NTSC_VideoRedrawWholeScreen() instead
 
-	if (g_bDelayVideoMode)
+	if (g_nNumVideoModeChanges)
 	{
-		VideoUpdateCycles(1);	// Video mode change is delayed by 1 cycle
+		// Now that the opcode's length is known, place each logged mode change & split the rendering there
+		UINT cyclesDone = 0;
+		for (UINT i = 0; i < g_nNumVideoModeChanges; i++)
+		{
+			const VideoModeChange_t& change = g_aVideoModeChanges[i];
+			const int cycle = NTSC_GetVideoModeChangeCycle(g_aVideoModeChanges, g_nNumVideoModeChanges, i, cycles6502);
+			if (cycle > (int)cyclesDone)
+			{
+				VideoUpdateCycles(cycle - cyclesDone);
+				cyclesDone = cycle;
+			}
 
-		g_bDelayVideoMode = false;
-		NTSC_SetVideoMode(g_uNewVideoModeFlags);
+			applyVideoMode((g_uVideoModeFlagsApplied & ~change.changedFlags) | (change.videoModeFlags & change.changedFlags));
+		}
+		g_nNumVideoModeChanges = 0;
 
-		cycles6502--;
-		if (!cycles6502)
-			return;
+		_ASSERT(cyclesDone < cycles6502);
+		cycles6502 -= cyclesDone;
 	}
 
 	VideoUpdateCycles(cycles6502);
@@ -2572,6 +2930,9 @@ static bool IsNTSC(void)
 
 static void GenerateVideoTables( void )
 {
+	if (g_nVideoTablesMaxVert == g_videoScannerMaxVert)
+		return;	// Already generated for this refresh rate
+
 	eApple2Type currentApple2Type = GetApple2Type();
 	uint32_t currentVideoMode = GetVideo().GetVideoMode();
 	int currentHiresPage = g_nHiresPage;
@@ -2655,6 +3016,8 @@ static void GenerateVideoTables( void )
 	GetVideo().SetVideoMode(currentVideoMode);
 	g_nHiresPage = currentHiresPage;
 	g_nTextPage = currentTextPage;
+
+	g_nVideoTablesMaxVert = g_videoScannerMaxVert;
 }
 
 static void GenerateBaseColors(baseColors_t pBaseNtscColors)
@@ -6,7 +6,8 @@
 extern uint32_t g_nChromaSize;
 
 // Prototypes (Public) ________________________________________________
-void NTSC_SetVideoMode(uint32_t uVideoModeFlags, bool bDelay=false);
+void NTSC_SetVideoMode(uint32_t uVideoModeFlags);
+void NTSC_LogVideoModeChange(uint32_t uVideoModeFlags, UINT delayCycles, uint16_t address, bool isWrite);
 void NTSC_SetVideoStyle(void);
 void NTSC_SetVideoTextMode(int cols);
 uint32_t* NTSC_VideoGetChromaTable(bool bHueTypeMonochrome, bool bMonitorTypeColorTV);
@@ -15,12 +16,14 @@ uint16_t NTSC_VideoGetScannerAddress(const ULONG uExecutedCycles);
 void NTSC_GetVideoVertHorzForDebugger(uint16_t& vert, uint16_t& horz);
 uint16_t NTSC_GetVideoVertForDebugger(void);
 void NTSC_Destroy(void);
+void NTSC_SetTableCacheFile(const std::string& filename);
 void NTSC_VideoInit(uint8_t *pFramebuffer);
 void NTSC_VideoReinitialize(DWORD cyclesThisFrame, bool bInitVideoScannerAddress);
 void NTSC_VideoInitAppleType(void);
 void NTSC_VideoInitChroma(void);
 void NTSC_VideoUpdateCycles(UINT cycles6502);
 void NTSC_VideoRedrawWholeScreen(void);
+void NTSC_SetDirtyLineTracker(DirtyLineTracker* pTracker);
 
 void NTSC_SetRefreshRate(VideoRefreshRate_e rate);
 UINT NTSC_GetCyclesPerFrame(void);
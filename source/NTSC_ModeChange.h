@@ -0,0 +1,38 @@
+#pragma once
+
+// Video mode change log: the current opcode's soft-switch accesses, which take effect part-way through its NTSC_VideoUpdateCycles()
+// . The IO handlers only get the cycle count at the start of the opcode, but the 6502 makes the access on the opcode's last cycle
+//   (or 3 cycles before the end for the read of a read-modify-write, eg. INC $C050), so each change is placed once the opcode's length is known
+// . The delays are relative to a 4-cycle absolute access (eg. STA $C050), which is what they were tuned with (GH#656),
+//   so (eg) STA $C050,X and STA ($FE),Y switch 1 and 2 cycles later than STA $C050
+// . Each only changes the flags that its soft-switch access changed, so that (eg) a delayed TEXT switch doesn't undo an immediate PAGE2 switch
+// NB. Header-only, so that TestVideo can check the placement without the rest of NTSC.cpp
+
+struct VideoModeChange_t
+{
+	uint16_t address;
+	bool isWrite;
+	UINT delayCycles;		// after the access
+	uint32_t changedFlags;
+	uint32_t videoModeFlags;
+};
+
+static const UINT kVideoModeChangeAccessCycle = 3;	// STA/LDA/BIT abs: access is on the opcode's 4th cycle
+
+// Returns the cycle, from the start of an opcode of 'cycles6502' cycles, at which the logged change 'i' takes effect (<= 0 means at the start)
+inline int NTSC_GetVideoModeChangeCycle(const VideoModeChange_t* pChanges, const UINT numChanges, const UINT i, const UINT cycles6502)
+{
+	const VideoModeChange_t& change = pChanges[i];
+
+	UINT accessCycle = cycles6502 - 1;
+	for (UINT j = i + 1; j < numChanges; j++)
+	{
+		if (!change.isWrite && pChanges[j].isWrite && pChanges[j].address == change.address)
+		{
+			accessCycle = (cycles6502 >= 3) ? cycles6502 - 3 : 0;	// Read of a read-modify-write
+			break;
+		}
+	}
+
+	return (int)accessCycle - (int)kVideoModeChangeAccessCycle + (int)change.delayCycles;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Color TV & B&W TV pixel output, shared by the per-pixel updatePixel{BnW,Hue}ColorTV{Single,Double}Scanline() funcs
+// and the batched (14 pixels at a time) updatePixels{BnW,Hue}ColorTV{Single,Double}Scanline() funcs
+// . Each Apple II scanline writes its own framebuffer row, and the inbetween row above it blended with the previous Apple II scanline
+// NB. Header-only, so that TestVideo can check that both paths give the same framebuffer without the rest of NTSC.cpp
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define NTSC_USE_SSE2 1
+#else
+	#define NTSC_USE_SSE2 0
+#endif
+
+static const uint32_t kTVPixelAlphaMask = 0xFF000000;	// ALPHA32_MASK
+
+// Shift 'signal' into the 12-bit signal history, and return its colour from the table for the current colour phase
+// . pTables: Color TV has a table per colour phase (tableStride apart); B&W TV has just the one (tableStride = 0)
+inline uint32_t NTSC_GetTVPixelColor(const uint16_t signal, int& signalBits, int& colorPhase, const uint32_t* pTables, const UINT tableStride)
+{
+	signalBits = ((signalBits << 1) | signal) & 0xFFF; // 12-bit
+	const uint32_t color = pTables[colorPhase * tableStride + signalBits];
+	colorPhase = (colorPhase + 1) & 3;	// Maintain color-phase, as could be switching graphics/text video modes mid-scanline
+	return color;
+}
+
+// Original: Prev1(inbetween) = 50% current + 50% of previous AppleII scanline
+// GH#650:   Single scanline: Prev1(inbetween) = 50% of (50% current + 50% of previous AppleII scanline)
+// GH#650:   Draw to final inbetween scanline (pLine1Next, else NULL) to avoid residue from other video modes (eg. Amber->TV B&W)
+template <bool isDoubleScanline>
+inline void NTSC_WriteTVPixel(const uint32_t color0, uint32_t* pLine0Curr, uint32_t* pLine1Prev, const uint32_t* pLine2Prev, uint32_t* pLine1Next)
+{
+	const uint32_t color2 = *pLine2Prev;
+	uint32_t color1 = ((color0 & 0x00fefefe) >> 1) + ((color2 & 0x00fefefe) >> 1); // 50% Blend
+	if (!isDoubleScanline)
+		color1 = (color1 & 0x00fefefe) >> 1;	// ... then 50% brightness for inbetween line
+
+	*pLine1Prev = color1 | kTVPixelAlphaMask;
+	*pLine0Curr = color0;
+
+	if (pLine1Next)
+	{
+		*pLine1Next = isDoubleScanline
+			? ((color0 & 0x00fefefe) >> 1) | kTVPixelAlphaMask	// (50% current + black)) = 50% of current
+			: ((color0 & 0x00fcfcfc) >> 2) | kTVPixelAlphaMask;	// 50% of (50% current + black)) = 25% of current
+	}
+}
+
+// Same as NTSC_WriteTVPixel() for each of pColors[0..numPixels-1], but 4 pixels at a time with SSE2
+template <bool isDoubleScanline>
+inline void NTSC_WriteTVPixels(const uint32_t* pColors, const UINT numPixels, uint32_t* pLine0Curr, uint32_t* pLine1Prev, const uint32_t* pLine2Prev, uint32_t* pLine1Next)
+{
+	UINT i = 0;
+#if NTSC_USE_SSE2
+	const __m128i mask = _mm_set1_epi32(0x00fefefe);
+	const __m128i alpha = _mm_set1_epi32(kTVPixelAlphaMask);
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		const __m128i color0 = _mm_loadu_si128((const __m128i*)&pColors[i]);
+		const __m128i color2 = _mm_loadu_si128((const __m128i*)&pLine2Prev[i]);
+		__m128i color1 = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(color0, mask), 1), _mm_srli_epi32(_mm_and_si128(color2, mask), 1)); // 50% Blend
+		if (!isDoubleScanline)
+			color1 = _mm_srli_epi32(_mm_and_si128(color1, mask), 1);	// ... then 50% brightness for inbetween line
+
+		_mm_storeu_si128((__m128i*)&pLine1Prev[i], _mm_or_si128(color1, alpha));
+		_mm_storeu_si128((__m128i*)&pLine0Curr[i], color0);
+
+		if (pLine1Next)
+		{
+			const __m128i colorNext = isDoubleScanline
+				? _mm_srli_epi32(_mm_and_si128(color0, mask), 1)
+				: _mm_srli_epi32(_mm_and_si128(color0, _mm_set1_epi32(0x00fcfcfc)), 2);
+			_mm_storeu_si128((__m128i*)&pLine1Next[i], _mm_or_si128(colorNext, alpha));
+		}
+	}
+#endif
+	for (; i < numPixels; i++)
+		NTSC_WriteTVPixel<isDoubleScanline>(pColors[i], &pLine0Curr[i], &pLine1Prev[i], &pLine2Prev[i], pLine1Next ? &pLine1Next[i] : NULL);
+}
@@ -7,6 +7,12 @@
 #include "Interface.h"
 #include "YamlHelper.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RGB_USE_SSE2 1
+#else
+#define RGB_USE_SSE2 0
+#endif
 
 // RGB videocards types
 
@@ -29,6 +35,10 @@ const int MAX_SOURCE_Y = 256;
 static LPBYTE        g_aSourceStartofLine[ MAX_SOURCE_Y ];
 #define  SETSOURCEPIXEL(x,y,c)  g_aSourceStartofLine[(y)][(x)] = (c)
 
+// Same layout as g_aSourceStartofLine[], but with the palette index already resolved to a 32-bit colour.
+// . So CopySource() is just a row copy - see V_ResolveSourcePalette()
+static UINT32*       g_aSourceStartofLineRGB[ MAX_SOURCE_Y ];
+
 // TC: Tried to remove HiresToPalIndex[] translation table, so get purple bars when hires data is: 0x80 0x80...
 // . V_CreateLookup_HiResHalfPixel_Authentic() uses both ColorMapping (CM_xxx) indices and Color_Palette_Index_e (HGR_xxx)!
 #define DO_OPT_PALETTE 0
@@ -552,11 +562,21 @@ static void CopyMixedSource(int x, int y, int sx, int sy, bgra_t *pVideoAddress)
 
 //===========================================================================
 
+// Copy a run of 32-bit pixels: 4 pixels (128 bits) at a time, then the remainder
+static inline void CopyPixels(UINT32* pDst, const UINT32* pSrc, int w)
+{
+#if RGB_USE_SSE2
+	for (; w >= 4; w -= 4, pDst += 4, pSrc += 4)
+		_mm_storeu_si128((__m128i*)pDst, _mm_loadu_si128((const __m128i*)pSrc));
+#endif
+	memcpy(pDst, pSrc, w * sizeof(UINT32));
+}
+
 // Pre: nSrcAdjustment: for 160-color images, src is +1 compared to dst
 static void CopySource(int w, int h, int sx, int sy, bgra_t *pVideoAddress, const int nSrcAdjustment = 0)
 {
 	UINT32* pDst = (UINT32*) pVideoAddress;
-	const BYTE* const pSrc = g_aSourceStartofLine[ sy ] + sx;
+	const UINT32* const pSrc = g_aSourceStartofLineRGB[ sy ] + sx + nSrcAdjustment;
 
 	const bool bIsHalfScanLines = GetVideo().IsVideoStyle(VS_HALF_SCANLINES);
 	const UINT frameBufferWidth = GetVideo().GetFrameBufferWidth();
@@ -570,12 +590,7 @@ static void CopySource(int w, int h, int sx, int sy, bgra_t *pVideoAddress, cons
 		}
 		else
 		{
-			for (int nBytes=0; nBytes<w; ++nBytes)
-			{
-				_ASSERT( *(pSrc+nBytes+nSrcAdjustment) < (sizeof(PaletteRGB_NTSC)/sizeof(PaletteRGB_NTSC[0])) );
-				const RGBQUAD& rRGB = g_pPaletteRGB[ *(pSrc+nBytes+nSrcAdjustment) ];
-				*(pDst+nBytes) = *reinterpret_cast<const UINT32 *>(&rRGB);
-			}
+			CopyPixels(pDst, pSrc, w);
 		}
 
 		pDst -= frameBufferWidth;
@@ -738,8 +753,7 @@ void UpdateHiResRGBCell(int x, int y, uint16_t addr, bgra_t* pVideoAddress)
 	}
 	else
 	{
-		for (int i = 0; i < 14; i++)
-			*(pDst + i) = *(pSrc + i);
+		CopyPixels(pDst, pSrc, 14);
 	}
 }
 
@@ -953,8 +967,7 @@ void UpdateDHiResCellRGB(int x, int y, uint16_t addr, bgra_t* pVideoAddress, boo
 	}
 	else
 	{
-		for (int i = 0; i < 14; i++)
-			*(pDst + i) = *(pSrc + i);
+		CopyPixels(pDst, pSrc, 14);
 	}
 }
 
@@ -1163,15 +1176,40 @@ void UpdateDuochromeCell(int h, int w, bgra_t* pVideoAddress, uint8_t bits, uint
 //===========================================================================
 
 static LPBYTE g_pSourcePixels = NULL;
+static UINT32* g_pSourcePixelsRGB = NULL;
+static const RGBQUAD* g_pSourcePixelsRGBPalette = NULL;	// Palette that g_pSourcePixelsRGB was resolved with
+
+// Re-resolve all the source pixels' palette indices to colours.
+// Only needed when the lookup tables are rebuilt, or the palette changes (ie. not per frame)
+static void V_ResolveSourcePalette(void)
+{
+	if (!g_pSourcePixels || !g_pPaletteRGB)
+		return;
+
+	const UINT32* pPalette = reinterpret_cast<const UINT32*>(g_pPaletteRGB);
+	for (int i = 0; i < SRCOFFS_TOTAL * MAX_SOURCE_Y; i++)
+	{
+		_ASSERT( g_pSourcePixels[i] < (sizeof(PaletteRGB_NTSC)/sizeof(PaletteRGB_NTSC[0])) );
+		g_pSourcePixelsRGB[i] = pPalette[ g_pSourcePixels[i] ];
+	}
+
+	g_pSourcePixelsRGBPalette = g_pPaletteRGB;
+}
 
 static void V_CreateDIBSections(void)
 {
 	if (!g_pSourcePixels)	// NB. Will be non-zero after a VM restart (GH#809)
+	{
 		g_pSourcePixels = new BYTE[SRCOFFS_TOTAL * MAX_SOURCE_Y];
+		g_pSourcePixelsRGB = new UINT32[SRCOFFS_TOTAL * MAX_SOURCE_Y];
+	}
 
 	// CREATE THE OFFSET TABLE FOR EACH SCAN LINE IN THE SOURCE IMAGE
 	for (int y = 0; y < MAX_SOURCE_Y; y++)
+	{
 		g_aSourceStartofLine[ y ] = g_pSourcePixels + SRCOFFS_TOTAL*((MAX_SOURCE_Y-1) - y);
+		g_aSourceStartofLineRGB[ y ] = g_pSourcePixelsRGB + SRCOFFS_TOTAL*((MAX_SOURCE_Y-1) - y);
+	}
 
 	// DRAW THE SOURCE IMAGE INTO THE SOURCE BIT BUFFER
 	memset(g_pSourcePixels, 0, SRCOFFS_TOTAL*MAX_SOURCE_Y);
@@ -1194,6 +1232,8 @@ void VideoInitializeOriginal(baseColors_t pBaseNtscColors)
 	PaletteRGB_NTSC[HGR_ORANGE] = PaletteRGB_NTSC[ORANGE];
 	PaletteRGB_NTSC[HGR_GREEN]  = PaletteRGB_NTSC[GREEN];
 	PaletteRGB_NTSC[HGR_VIOLET] = PaletteRGB_NTSC[MAGENTA];
+
+	V_ResolveSourcePalette();
 }
 
 //===========================================================================
@@ -1206,6 +1246,9 @@ void VideoSwitchVideocardPalette(RGB_Videocard_e videocard, VideoType_e type)
 	{
 		g_pPaletteRGB = PaletteRGB_Feline;
 	}
+
+	if (g_pPaletteRGB != g_pSourcePixelsRGBPalette)
+		V_ResolveSourcePalette();
 }
 
 //===========================================================================
@@ -21,10 +21,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 // ReSharper disable CppInconsistentNaming
 
 #include <StdAfx.h>
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
 
 #include "YamlHelper.h"
 #include "SmartPortOverSlip.h"
@@ -80,6 +82,7 @@ SmartPortOverSlip::~SmartPortOverSlip()
 void SmartPortOverSlip::Reset(const bool powerCycle)
 {
 	LogFileOutput("SmartPortOverSlip Bridge Initialization, reset called\n");
+	clear_read_ahead();
 }
 
 void SmartPortOverSlip::handle_smartport_call()
@@ -128,6 +131,12 @@ void SmartPortOverSlip::handle_smartport_call()
 	const auto device_id = id_and_connection.first;
 	const auto connection = id_and_connection.second.get();
 
+	// Anything other than a read may change what the device would return for a block (write, format, eject via control, ...)
+	if (command != CMD_STATUS && command != CMD_READ_BLOCK)
+	{
+		invalidate_read_ahead(connection, device_id);
+	}
+
 	switch (command)
 	{
 	case CMD_STATUS:
@@ -135,7 +144,7 @@ void SmartPortOverSlip::handle_smartport_call()
 		break;
 	case CMD_READ_BLOCK:
 		// TODO: fix the fact params_loc has changed from +4 to +2
-		read_block(device_id, connection, sp_payload_loc, param_count, params_loc + 2);
+		read_block(device_id, id_and_connection.second, sp_payload_loc, param_count, params_loc + 2);
 		break;
 	case CMD_WRITE_BLOCK:
 		// TODO: fix the fact params_loc has changed from +4 to +2
@@ -320,10 +329,9 @@ void SmartPortOverSlip::handle_prodos_read(uint8_t drive_num, std::pair<int, int
 	auto id_connection = GetCommandListener().find_connection_with_device(device_id);
 
 	// Do a ReadRequest, and shove the 512 byte block into the required memory
-	ReadBlockRequest request(Requestor::next_request_number(), 3, id_connection.first);
 	// $46-47 = Block Number
-	request.set_block_number_from_bytes(mem[0x46], mem[0x47], 0);
-	auto response = Requestor::send_request(request, id_connection.second.get());
+	const uint32_t block = mem[0x46] | (mem[0x47] << 8);
+	auto response = read_block_pipelined(id_connection.first, id_connection.second, 3, block);
 
 	handle_response<ReadBlockResponse>(
 		std::move(response),
@@ -332,6 +340,7 @@ void SmartPortOverSlip::handle_prodos_read(uint8_t drive_num, std::pair<int, int
 			int dirty_page_start = (buffer_location & 0xFF00) >> 8;
 			memdirty[dirty_page_start] = 0xFF;
 			memdirty[dirty_page_start + 1] = 0xFF;
+			stats_.blocks_read++;
 			regs.a = 0;
 			regs.x = 0;
 			regs.y = 2; // 512 bytes
@@ -346,7 +355,9 @@ void SmartPortOverSlip::handle_prodos_write(uint8_t drive_num, std::pair<int, in
 	auto device_id = drive_num == 1 ? disk_devices.first : disk_devices.second;
 	auto id_connection = GetCommandListener().find_connection_with_device(device_id);
 
-	WriteBlockRequest request(Requestor::next_request_number(), 3, id_connection.first);
+	invalidate_read_ahead(id_connection.second.get(), id_connection.first);
+
+	WriteBlockRequest request(Requestor::next_request_number(id_connection.second.get()), 3, id_connection.first);
 	// $46-47 = Block Number
 	request.set_block_number_from_bytes(mem[0x46], mem[0x47], 0);
 	// put data into the request we're sending
@@ -359,6 +370,7 @@ void SmartPortOverSlip::handle_prodos_write(uint8_t drive_num, std::pair<int, in
 	handle_response<WriteBlockResponse>(
 		std::move(response),
 		[this, buffer_location](const WriteBlockResponse *rbr) {
+			stats_.blocks_written++;
 			regs.a = 0;
 			regs.x = 0;
 			regs.y = 2; // 512 bytes
@@ -369,16 +381,35 @@ void SmartPortOverSlip::handle_prodos_write(uint8_t drive_num, std::pair<int, in
 BYTE SmartPortOverSlip::io_write0(WORD programCounter, const WORD address, const BYTE value, ULONG nCycles)
 {
 	const uint8_t loc = address & 0x0f;
+	if (loc != 0x02 || (value != 0x65 && value != 0x66))
+		return 0;
+
+	// The emulation is held for the whole round trip to the device, so time it with the host clock
+	const uint64_t blocks_before = stats_.blocks_read + stats_.blocks_written;
+	const auto start = std::chrono::steady_clock::now();
+
 	// SP = $65 in $02
-	if (value == 0x65 && loc == 0x02)
+	if (value == 0x65)
 	{
 		handle_smartport_call();
 	}
 	// ProDos = $66 in $02
-	else if (value == 0x66 && loc == 0x02)
+	else
 	{
 		handle_prodos_call();
 	}
+
+	const uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	stats_.calls++;
+	stats_.call_microseconds += microseconds;
+	if (regs.a != 0)
+		stats_.errors++;
+	if (stats_.blocks_read + stats_.blocks_written != blocks_before)
+	{
+		stats_.block_microseconds += microseconds;
+		if (block_latencies_.size() < MAX_LATENCY_SAMPLES)
+			block_latencies_.push_back(static_cast<uint32_t>(std::min<uint64_t>(microseconds, UINT32_MAX)));
+	}
 	return 0;
 }
 
@@ -404,12 +435,11 @@ void SmartPortOverSlip::device_count(const WORD sp_payload_loc)
 	set_processor_status(AF_ZERO);
 }
 
-void SmartPortOverSlip::read_block(const BYTE unit_number, Connection *connection, const WORD buffer_location, const BYTE params_count, const WORD block_count_address)
+void SmartPortOverSlip::read_block(const BYTE unit_number, const std::shared_ptr<Connection> &connection, const WORD buffer_location, const BYTE params_count, const WORD block_count_address)
 {
-	ReadBlockRequest request(Requestor::next_request_number(), params_count, unit_number);
 	// Assume that (cmd_list_loc + 4 == block_count_address) holds 3 bytes for the block number. If it's in the payload, this is wrong and will have to be fixed.
-	request.set_block_number_from_ptr(mem, block_count_address);
-	auto response = Requestor::send_request(request, connection);
+	const uint32_t block = mem[block_count_address] | (mem[block_count_address + 1] << 8) | (mem[block_count_address + 2] << 16);
+	auto response = read_block_pipelined(unit_number, connection, params_count, block);
 
 	handle_response<ReadBlockResponse>(std::move(response), [this, buffer_location](const ReadBlockResponse *rbr) {
 		memcpy(mem + buffer_location, rbr->get_block_data().data(), 512);
@@ -417,6 +447,7 @@ void SmartPortOverSlip::read_block(const BYTE unit_number, Connection *connectio
 		int dirty_page_start = (buffer_location & 0xFF00) >> 8;
 		memdirty[dirty_page_start] = 0xFF;
 		memdirty[dirty_page_start + 1] = 0xFF;
+		stats_.blocks_read++;
 
 		regs.a = 0;
 		regs.x = 0;
@@ -424,20 +455,102 @@ void SmartPortOverSlip::read_block(const BYTE unit_number, Connection *connectio
 	});
 }
 
+std::unique_ptr<Response> SmartPortOverSlip::read_block_pipelined(const BYTE unit_number, const std::shared_ptr<Connection> &connection, const BYTE params_count, const uint32_t block)
+{
+	// Entries for connections that have since gone away can never be collected
+	read_ahead_.erase(std::remove_if(read_ahead_.begin(), read_ahead_.end(), [](const ReadAheadEntry &entry) { return !entry.connection->is_connected(); }), read_ahead_.end());
+
+	std::unique_ptr<Response> response;
+	const auto it = std::find_if(read_ahead_.begin(), read_ahead_.end(), [&connection, unit_number, block](const ReadAheadEntry &entry) {
+		return entry.connection == connection && entry.unit_number == unit_number && entry.block == block;
+	});
+
+	if (it != read_ahead_.end())
+	{
+		// Already in flight (usually already received), so this only blocks if the device is slower than the guest
+		stats_.read_ahead_hits++;
+		response = Requestor::receive_response(*it->request, connection.get());
+		read_ahead_.erase(it);
+	}
+	else
+	{
+		// Not the stream we were reading ahead for, so drop it and read this block directly
+		stats_.read_ahead_misses++;
+		invalidate_read_ahead(connection.get(), unit_number);
+
+		ReadBlockRequest request(Requestor::next_request_number(connection.get()), params_count, unit_number);
+		request.set_block_number_from_bytes(block & 0xff, (block >> 8) & 0xff, (block >> 16) & 0xff);
+		response = Requestor::send_request(request, connection.get());
+	}
+
+	// Only keep reading ahead while the device is serving blocks, e.g. stop at the end of the volume
+	const auto rbr = dynamic_cast<ReadBlockResponse *>(response.get());
+	if (rbr != nullptr && rbr->get_status() == 0)
+	{
+		issue_read_ahead(unit_number, connection, block);
+	}
+
+	return response;
+}
+
+void SmartPortOverSlip::issue_read_ahead(const BYTE unit_number, const std::shared_ptr<Connection> &connection, const uint32_t block)
+{
+	for (uint32_t next = block + 1; next <= block + READ_AHEAD_BLOCKS && next <= 0xFFFFFF; next++)
+	{
+		const bool pending = std::any_of(read_ahead_.begin(), read_ahead_.end(), [&connection, unit_number, next](const ReadAheadEntry &entry) {
+			return entry.connection == connection && entry.unit_number == unit_number && entry.block == next;
+		});
+		if (pending)
+			continue;
+
+		auto request = std::make_unique<ReadBlockRequest>(Requestor::next_request_number(connection.get()), 3, unit_number);
+		request->set_block_number_from_bytes(next & 0xff, (next >> 8) & 0xff, (next >> 16) & 0xff);
+		Requestor::send_request_async(*request, connection.get());
+		read_ahead_.push_back(ReadAheadEntry{connection, unit_number, next, std::move(request)});
+	}
+}
+
+void SmartPortOverSlip::invalidate_read_ahead(const Connection *connection, const BYTE unit_number)
+{
+	for (auto it = read_ahead_.begin(); it != read_ahead_.end();)
+	{
+		if (it->connection.get() == connection && it->unit_number == unit_number)
+		{
+			Requestor::abandon_request(*it->request, it->connection.get());
+			it = read_ahead_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void SmartPortOverSlip::clear_read_ahead()
+{
+	for (const auto &entry : read_ahead_)
+	{
+		Requestor::abandon_request(*entry.request, entry.connection.get());
+	}
+	read_ahead_.clear();
+}
+
 void SmartPortOverSlip::write_block(const BYTE unit_number, Connection *connection, const WORD sp_payload_loc, const BYTE params_count, const WORD params_loc)
 {
-	WriteBlockRequest request(Requestor::next_request_number(), params_count, unit_number);
+	WriteBlockRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	// Assume that (cmd_list_loc + 4 == params_loc) holds 3 bytes for the block number. The payload contains the data to write
 	request.set_block_number_from_ptr(mem, params_loc);
 	request.set_block_data_from_ptr(mem, sp_payload_loc);
 
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<WriteBlockResponse>(std::move(response));
+	if (regs.a == 0)
+		stats_.blocks_written++;
 }
 
 void SmartPortOverSlip::read(const BYTE unit_number, Connection *connection, const WORD sp_payload_loc, const BYTE params_count, const WORD params_loc)
 {
-	ReadRequest request(Requestor::next_request_number(), params_count, unit_number);
+	ReadRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	request.set_byte_count_from_ptr(mem, params_loc);
 	request.set_address_from_ptr(mem, params_loc + 2); // move along by byte_count size. would be better to get its size rather than hard code it here.
 	auto response = Requestor::send_request(request, connection);
@@ -460,7 +573,7 @@ void SmartPortOverSlip::read(const BYTE unit_number, Connection *connection, con
 
 void SmartPortOverSlip::write(const BYTE unit_number, Connection *connection, const WORD sp_payload_loc, const BYTE params_count, const WORD params_loc)
 {
-	WriteRequest request(Requestor::next_request_number(), params_count, unit_number);
+	WriteRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	request.set_byte_count_from_ptr(mem, params_loc);
 	request.set_address_from_ptr(mem, params_loc + 2); // move along by byte_count size. would be better to get its size rather than hard code it here.
 	const auto byte_count = request.get_byte_count();
@@ -495,7 +608,7 @@ void SmartPortOverSlip::status_sp(const BYTE unit_number, Connection *connection
 std::unique_ptr<Response> SmartPortOverSlip::status(const BYTE unit_number, Connection *connection, const BYTE params_count, const BYTE status_code, const BYTE network_unit)
 {
 	// see https://www.1000bit.it/support/manuali/apple/technotes/smpt/tn.smpt.2.html
-	const StatusRequest request(Requestor::next_request_number(), params_count, unit_number, status_code, network_unit);
+	const StatusRequest request(Requestor::next_request_number(connection), params_count, unit_number, status_code, network_unit);
 	return Requestor::send_request(request, connection);
 }
 
@@ -520,35 +633,35 @@ void SmartPortOverSlip::control(const BYTE unit_number, Connection *connection,
 	uint8_t *start_ptr = &mem[sp_payload_loc];
 	std::vector<uint8_t> payload(start_ptr, start_ptr + length);
 
-	const ControlRequest request(Requestor::next_request_number(), params_count, unit_number, control_code, network_unit, payload);
+	const ControlRequest request(Requestor::next_request_number(connection), params_count, unit_number, control_code, network_unit, payload);
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<ControlResponse>(std::move(response));
 }
 
 void SmartPortOverSlip::init(const BYTE unit_number, Connection *connection, const BYTE params_count)
 {
-	const InitRequest request(Requestor::next_request_number(), params_count, unit_number);
+	const InitRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<InitResponse>(std::move(response));
 }
 
 void SmartPortOverSlip::open(const BYTE unit_number, Connection *connection, const BYTE params_count)
 {
-	const OpenRequest request(Requestor::next_request_number(), params_count, unit_number);
+	const OpenRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<OpenResponse>(std::move(response));
 }
 
 void SmartPortOverSlip::close(const BYTE unit_number, Connection *connection, const BYTE params_count)
 {
-	const CloseRequest request(Requestor::next_request_number(), params_count, unit_number);
+	const CloseRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<CloseResponse>(std::move(response));
 }
 
 void SmartPortOverSlip::format(const BYTE unit_number, Connection *connection, const BYTE params_count)
 {
-	const FormatRequest request(Requestor::next_request_number(), params_count, unit_number);
+	const FormatRequest request(Requestor::next_request_number(connection), params_count, unit_number);
 	auto response = Requestor::send_request(request, connection);
 	handle_simple_response<FormatResponse>(std::move(response));
 }
@@ -636,4 +749,47 @@ bool SmartPortOverSlip::LoadSnapshot(YamlLoadHelper &yamlLoadHelper, UINT versio
 	return true;
 }
 
-void SmartPortOverSlip::Destroy() {}
+void SmartPortOverSlip::Destroy()
+{
+	if (stats_.calls)
+	{
+		LogFileOutput("SmartPortOverSlip: %llu calls, %llu blocks read, %llu blocks written, read-ahead %llu hits, %llu misses\n",
+			(unsigned long long)stats_.calls, (unsigned long long)stats_.blocks_read, (unsigned long long)stats_.blocks_written,
+			(unsigned long long)stats_.read_ahead_hits, (unsigned long long)stats_.read_ahead_misses);
+	}
+	clear_read_ahead();
+}
+
+// Latency of a block call in microseconds, eg. fraction 0.99 for the 99th percentile
+uint32_t SmartPortOverSlip::GetBlockLatencyPercentile(const double fraction) const
+{
+	if (block_latencies_.empty())
+		return 0;
+
+	std::vector<uint32_t> latencies = block_latencies_;
+	const auto nth = latencies.begin() + static_cast<size_t>(fraction * (latencies.size() - 1));
+	std::nth_element(latencies.begin(), nth, latencies.end());
+	return *nth;
+}
+
+std::string SmartPortOverSlip::GetStatsJson(void)
+{
+	const uint64_t blocks = stats_.blocks_read + stats_.blocks_written;
+	const unsigned long long bytes_per_second = stats_.block_microseconds ? (unsigned long long)(blocks * 512 * 1000000 / stats_.block_microseconds) : 0;
+
+	return StrFormat("{\"slot\": %u, \"type\": \"SPoverSLIP\", \"calls\": %llu, \"blocksRead\": %llu, \"blocksWritten\": %llu, \"errors\": %llu, "
+		"\"readAheadHits\": %llu, \"readAheadMisses\": %llu, \"callMicroseconds\": %llu, \"blockMicroseconds\": %llu, \"blockBytesPerSecond\": %llu, "
+		"\"blockLatencyP50\": %llu, \"blockLatencyP90\": %llu, \"blockLatencyP99\": %llu, \"blockLatencyMax\": %llu}",
+		m_slot, (unsigned long long)stats_.calls,
+		(unsigned long long)stats_.blocks_read, (unsigned long long)stats_.blocks_written, (unsigned long long)stats_.errors,
+		(unsigned long long)stats_.read_ahead_hits, (unsigned long long)stats_.read_ahead_misses,
+		(unsigned long long)stats_.call_microseconds, (unsigned long long)stats_.block_microseconds, bytes_per_second,
+		(unsigned long long)GetBlockLatencyPercentile(0.50), (unsigned long long)GetBlockLatencyPercentile(0.90),
+		(unsigned long long)GetBlockLatencyPercentile(0.99), (unsigned long long)GetBlockLatencyPercentile(1.0));
+}
+
+void SmartPortOverSlip::ResetStats(void)
+{
+	stats_ = Stats{};
+	block_latencies_.clear();
+}
@@ -3,11 +3,14 @@
 
 #include "Card.h"
 
+#include <array>
 #include <memory>
+#include <vector>
 
 #include "CPU.h"
 #include "devrelay/service/Listener.h"
 #include "devrelay/types/Response.h"
+#include "devrelay/commands/ReadBlock.h"
 #include "devrelay/commands/Status.h"
 
 class ControlResponse;
@@ -38,7 +41,7 @@ public:
 	void close(BYTE unit_number, Connection *connection, BYTE params_count);
 	void format(BYTE unit_number, Connection *connection, BYTE params_count);
 	void reset(BYTE unit_number, Connection *connection, BYTE params_count);
-	void read_block(BYTE unit_number, Connection *connection, WORD sp_payload_loc, BYTE params_count, WORD params_loc);
+	void read_block(BYTE unit_number, const std::shared_ptr<Connection> &connection, WORD sp_payload_loc, BYTE params_count, WORD params_loc);
 	void write_block(BYTE unit_number, Connection *connection, WORD sp_payload_loc, BYTE params_count, WORD params_loc);
 	void read(BYTE unit_number, Connection *connection, WORD sp_payload_loc, BYTE params_count, WORD params_loc);
 	void write(BYTE unit_number, Connection *connection, WORD sp_payload_loc, BYTE params_count, WORD params_loc);
@@ -51,6 +54,31 @@ public:
 	void handle_prodos_read(uint8_t drive_num, std::pair<int, int> disk_devices);
 	void handle_prodos_write(uint8_t drive_num, std::pair<int, int> disk_devices);
 
+	// Block reads are pipelined: after a successful read of block N, reads of N+1.. are sent ahead to the device so a sequential
+	// reader finds its next block already received instead of stalling the emulation for a full round trip.
+	std::unique_ptr<Response> read_block_pipelined(BYTE unit_number, const std::shared_ptr<Connection> &connection, BYTE params_count, uint32_t block);
+	void issue_read_ahead(BYTE unit_number, const std::shared_ptr<Connection> &connection, uint32_t block);
+	void invalidate_read_ahead(const Connection *connection, BYTE unit_number);
+	void clear_read_ahead();
+
+	// Host side timing of the guest's calls into the card, reported by -disk-stats and the debugger's DISK STATS
+	struct Stats
+	{
+		uint64_t calls = 0;
+		uint64_t errors = 0;
+		uint64_t blocks_read = 0;
+		uint64_t blocks_written = 0;
+		uint64_t read_ahead_hits = 0;
+		uint64_t read_ahead_misses = 0;
+		uint64_t call_microseconds = 0;	 // all calls, including status/control and network I/O
+		uint64_t block_microseconds = 0; // calls that read or wrote a block
+	};
+
+	const Stats &GetStats(void) const { return stats_; }
+	uint32_t GetBlockLatencyPercentile(double fraction) const;
+	std::string GetStatsJson(void);
+	void ResetStats(void);
+
 	static void set_processor_status(const uint8_t flags) { regs.ps |= flags; }
 	static void unset_processor_status(const uint8_t flags) { regs.ps &= (0xFF - flags); }
 	// if condition is true then set the flags given, else remove them.
@@ -113,4 +141,21 @@ public:
 private:
 	// Ensure no more than 1 card is active as it can cater for all connections to external devices
 	static int active_instances;
+
+	static constexpr uint32_t READ_AHEAD_BLOCKS = 4;
+
+	struct ReadAheadEntry
+	{
+		std::shared_ptr<Connection> connection;
+		BYTE unit_number;
+		uint32_t block;
+		std::unique_ptr<ReadBlockRequest> request;	// already sent, response collected on a hit
+	};
+
+	std::vector<ReadAheadEntry> read_ahead_;
+
+	static constexpr size_t MAX_LATENCY_SAMPLES = 1 << 20;
+
+	Stats stats_;
+	std::vector<uint32_t> block_latencies_; // microseconds per block call, kept for the percentiles
 };
\ No newline at end of file
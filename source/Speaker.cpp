@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "SoundCore.h"
 #include "YamlHelper.h"
 #include "Riff.h"
+#include "VideoCapture.h"
 
 #include "Debugger/Debug.h"	// For DWORD extbench
 
@@ -103,6 +104,15 @@ void Spkr_OutputToRiff(void)
 	g_bSpkrOutputToRiff = true;
 }
 
+// Tap for any sample consumers other than the sound buffer, ie. -wav-speaker and video capture
+static void Spkr_OutputSamples(const short* pSamples, UINT numSamples)
+{
+	if (g_bSpkrOutputToRiff)
+		RiffPutSamples(pSamples, numSamples);
+
+	GetVideoCapture().CaptureAudio(pSamples, numSamples);
+}
+
 UINT Spkr_GetNumChannels(void)
 {
 	return g_nSPKR_NumChannels;
@@ -643,15 +653,13 @@ static ULONG Spkr_SubmitWaveBuffer_FullSpeed(short* pSpeakerBuffer, ULONG nNumSa
 			}
 			
 			memcpy(pDSLockedBuffer0, &pSpeakerBuffer[0], dwBufferSize0);
-			if (g_bSpkrOutputToRiff)
-				RiffPutSamples(pDSLockedBuffer0, dwBufferSize0 / (sizeof(short) * g_nSPKR_NumChannels));
+			Spkr_OutputSamples(pDSLockedBuffer0, dwBufferSize0 / (sizeof(short) * g_nSPKR_NumChannels));
 			nNumSamples = dwBufferSize0 / (sizeof(short) * g_nSPKR_NumChannels);
 
 			if(pDSLockedBuffer1 && dwBufferSize1)
 			{
 				memcpy(pDSLockedBuffer1, &pSpeakerBuffer[dwDSLockedBufferSize0/sizeof(short)], dwBufferSize1);
-				if (g_bSpkrOutputToRiff)
-					RiffPutSamples(pDSLockedBuffer1, dwBufferSize1 / (sizeof(short) * g_nSPKR_NumChannels));
+				Spkr_OutputSamples(pDSLockedBuffer1, dwBufferSize1 / (sizeof(short) * g_nSPKR_NumChannels));
 				nNumSamples += dwBufferSize1 / (sizeof(short) * g_nSPKR_NumChannels);
 			}
 		}
@@ -680,8 +688,7 @@ static ULONG Spkr_SubmitWaveBuffer_FullSpeed(short* pSpeakerBuffer, ULONG nNumSa
 					}
 				}
 
-				if (g_bSpkrOutputToRiff)
-					RiffPutSamples(pDSLockedBuffer0, numSamples);
+				Spkr_OutputSamples(pDSLockedBuffer0, numSamples);
 			}
 
 			if(pDSLockedBuffer1)
@@ -701,8 +708,7 @@ static ULONG Spkr_SubmitWaveBuffer_FullSpeed(short* pSpeakerBuffer, ULONG nNumSa
 					}
 				}
 
-				if (g_bSpkrOutputToRiff)
-					RiffPutSamples(pDSLockedBuffer1, numSamples);
+				Spkr_OutputSamples(pDSLockedBuffer1, numSamples);
 			}
 		}
 
@@ -846,14 +852,12 @@ static ULONG Spkr_SubmitWaveBuffer(short* pSpeakerBuffer, ULONG nNumSamples)
 		}
 
 		memcpy(pDSLockedBuffer0, &pSpeakerBuffer[0], dwDSLockedBufferSize0);
-		if (g_bSpkrOutputToRiff)
-			RiffPutSamples(pDSLockedBuffer0, dwDSLockedBufferSize0 / (sizeof(short) * g_nSPKR_NumChannels));
+		Spkr_OutputSamples(pDSLockedBuffer0, dwDSLockedBufferSize0 / (sizeof(short) * g_nSPKR_NumChannels));
 
 		if(pDSLockedBuffer1)
 		{
 			memcpy(pDSLockedBuffer1, &pSpeakerBuffer[dwDSLockedBufferSize0/sizeof(short)], dwDSLockedBufferSize1);
-			if (g_bSpkrOutputToRiff)
-				RiffPutSamples(pDSLockedBuffer1, dwDSLockedBufferSize1 / (sizeof(short) * g_nSPKR_NumChannels));
+			Spkr_OutputSamples(pDSLockedBuffer1, dwDSLockedBufferSize1 / (sizeof(short) * g_nSPKR_NumChannels));
 		}
 
 		// Commit sound buffer
@@ -54,6 +54,13 @@
 #include "VidHD.h"
 #include "YamlHelper.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VIDHD_USE_SSE2 1
+#else
+#define VIDHD_USE_SSE2 0
+#endif
+
 void VidHDCard::Reset(const bool powerCycle)
 {
 	m_NEWVIDEO = 0;
@@ -127,46 +134,78 @@ bgra_t ConvertIIgs2RGB(Color color)
 	return rgb;
 }
 
-void VidHDCard::UpdateSHRCell(bool is640Mode, bool isColorFillMode, uint16_t addrPalette, bgra_t* pVideoAddress, uint32_t a)
+// Decode the line's palette once, rather than for every pixel
+void VidHDCard::UpdateSHRLine(BYTE scb, SHRLine_t& line)
 {
-	_ASSERT(!is640Mode);		// to do: test this mode
+	line.is640Mode = !!(scb & 0x80);
+	line.isColorFillMode = !!(scb & 0x20);
+
+	const UINT paletteSelectCode = scb & 0xf;
+	const UINT kColorsPerPalette = 16;
+	const UINT kColorSize = 2;
+	const uint16_t addrPalette = 0x9E00 + paletteSelectCode * kColorsPerPalette * kColorSize;
 
 	Color* palette = (Color*) MemGetAuxPtr(addrPalette);
 
-	for (UINT i = 0; i < 4; i++)
+	for (UINT i = 0; i < kColorsPerPalette; i++)
+		line.palette[i] = ConvertIIgs2RGB(palette[i]);
+}
+
+void VidHDCard::UpdateSHRCell(const SHRLine_t& line, bgra_t* pVideoAddress, uint32_t a)
+{
+	_ASSERT(!line.is640Mode);		// to do: test this mode
+
+	const uint32_t* palette = (const uint32_t*) line.palette;
+
+	if (line.isColorFillMode && !line.is640Mode)
 	{
-		if (!is640Mode) // 320 mode
+		// Scalar: fill mode depends on the previous pixel
+		for (UINT i = 0; i < 4; i++)
 		{
 			BYTE pixel1 = (a >> 4) & 0xf;
-			bgra_t color1 = ConvertIIgs2RGB(palette[pixel1]);
-			if (isColorFillMode && pixel1 == 0) color1 = *(pVideoAddress - 1);
+			bgra_t color1 = line.palette[pixel1];
+			if (pixel1 == 0) color1 = *(pVideoAddress - 1);
 			*pVideoAddress++ = color1;
 			*pVideoAddress++ = color1;
 
 			BYTE pixel2 = a & 0xf;
-			bgra_t color2 = ConvertIIgs2RGB(palette[pixel2]);
-			if (isColorFillMode && pixel2 == 0) color2 = color1;
+			bgra_t color2 = line.palette[pixel2];
+			if (pixel2 == 0) color2 = color1;
 			*pVideoAddress++ = color2;
 			*pVideoAddress++ = color2;
+
+			a >>= 8;
 		}
-		else // 640 mode - see IIgs Hardware Ref, Pg.96, Table4-21 'Color Selection in 640 mode'
-		{
-			BYTE pixel1 = (a >> 6) & 0x3;
-			bgra_t color1 = ConvertIIgs2RGB(palette[0x8 + pixel1]);
-			*pVideoAddress++ = color1;
+		return;
+	}
 
-			BYTE pixel2 = (a >> 4) & 0x3;
-			bgra_t color2 = ConvertIIgs2RGB(palette[0xC + pixel2]);
-			*pVideoAddress++ = color2;
+	uint32_t* pDst = (uint32_t*) pVideoAddress;
 
-			BYTE pixel3 = (a >> 2) & 0x3;
-			bgra_t color3 = ConvertIIgs2RGB(palette[0x0 + pixel3]);
-			*pVideoAddress++ = color3;
+	for (UINT i = 0; i < 4; i++, pDst += 4)
+	{
+		uint32_t color1, color2, color3, color4;
 
-			BYTE pixel4 = a & 0x3;
-			bgra_t color4 = ConvertIIgs2RGB(palette[0x4 + pixel4]);
-			*pVideoAddress++ = color4;
+		if (!line.is640Mode) // 320 mode
+		{
+			color1 = color2 = palette[(a >> 4) & 0xf];
+			color3 = color4 = palette[a & 0xf];
 		}
+		else // 640 mode - see IIgs Hardware Ref, Pg.96, Table4-21 'Color Selection in 640 mode'
+		{
+			color1 = palette[0x8 + ((a >> 6) & 0x3)];
+			color2 = palette[0xC + ((a >> 4) & 0x3)];
+			color3 = palette[0x0 + ((a >> 2) & 0x3)];
+			color4 = palette[0x4 + (a & 0x3)];
+		}
+
+#if VIDHD_USE_SSE2
+		_mm_storeu_si128((__m128i*)pDst, _mm_set_epi32(color4, color3, color2, color1));
+#else
+		pDst[0] = color1;
+		pDst[1] = color2;
+		pDst[2] = color3;
+		pDst[3] = color4;
+#endif
 
 		a >>= 8;
 	}
@@ -32,7 +32,16 @@ public:
 	bool IsDHGRBlackAndWhite(void) { return (m_NEWVIDEO & (1 << 5)) ? true : false; }
 	bool IsWriteAux(void);
 
-	static void UpdateSHRCell(bool is640Mode, bool isColorFillMode, uint16_t addrPalette, bgra_t* pVideoAddress, uint32_t a);
+	// Per-scanline state, decoded from the scan-line control byte (SCB) and its palette
+	struct SHRLine_t
+	{
+		bool is640Mode;
+		bool isColorFillMode;
+		bgra_t palette[16];
+	};
+
+	static void UpdateSHRLine(BYTE scb, SHRLine_t& line);
+	static void UpdateSHRCell(const SHRLine_t& line, bgra_t* pVideoAddress, uint32_t a);
 
 	static const std::string& GetSnapshotCardName(void);
 	virtual void SaveSnapshot(YamlSaveHelper& yamlSaveHelper);
@@ -216,11 +216,12 @@ BYTE Video::VideoSetMode(WORD pc, WORD address, BYTE write, BYTE d, ULONG uExecu
 		RGB_SetVideoMode(address);
 
 	// Only 1-cycle delay for VF_TEXT & VF_MIXED mode changes (GH#656)
-	bool delay = false;
+	// . The NTSC renderer places the change at the actual cycle of this access within the opcode
+	UINT delayCycles = 0;
 	if ((oldVideoMode ^ g_uVideoMode) & (VF_TEXT|VF_MIXED))
-		delay = true;
+		delayCycles = 1;
 
-	NTSC_SetVideoMode(g_uVideoMode, delay);
+	NTSC_LogVideoModeChange(g_uVideoMode, delayCycles, address, write != 0);
 
 	return MemReadFloatingBus(uExecutedCycles);
 }
@@ -849,6 +850,24 @@ void Video::ClearFrameBuffer(void)
 {
 	UINT32* frameBuffer = (UINT32*)GetFrameBuffer();
 	std::fill(frameBuffer, frameBuffer + GetFrameBufferWidth() * GetFrameBufferHeight(), OPAQUE_BLACK);
+	m_dirtyLineTracker.Reset(GetFrameBufferBorderlessHeight());	// Not written by the NTSC renderer, so next UpdateDirtyLineRanges() will mark every line as dirty
+}
+
+//===========================================================================
+
+void Video::SetDirtyLineTracking(bool enable)
+{
+	m_dirtyLineTracking = enable;
+	m_dirtyLineTracker.Reset(GetFrameBufferBorderlessHeight());
+	NTSC_SetDirtyLineTracker(enable ? &m_dirtyLineTracker : NULL);
+}
+
+void Video::UpdateDirtyLineRanges(void)
+{
+	if (!m_dirtyLineTracking || !GetFrameBuffer())
+		return;
+
+	m_dirtyLineTracker.Update(GetFrameBufferBorderlessHeight());
 }
 
 // Called when entering debugger, and after viewing Apple II video screen from debugger
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "DirtyLineTracker.h"
+
 // in Windows it seems that the ALPHA value is irrelevant
 // we have selected 0xFF since it works everywhere
 // Windows
@@ -192,6 +194,7 @@ public:
 		g_videoRomSize = 0;
 		g_videoRomRockerSwitch = false;
 		m_hasVidHD = false;
+		m_dirtyLineTracking = false;
 	}
 
 	~Video(void){}
@@ -277,6 +280,18 @@ public:
 	bool HasVidHD(void) { return m_hasVidHD; }
 	void SetVidHD(bool hasVidHD) { m_hasVidHD = hasVidHD; }
 
+	// Dirty line tracking (opt-in, for frontends/remote viewers that only want to upload or encode changed regions)
+	// . Lines are rows of the borderless framebuffer, top-down (ie. the same area as VideoPresentScreen() outputs)
+	// . Ranges are relative to the previous call to UpdateDirtyLineRanges(), which FrameBase::VideoPresentScreen() implementations do first
+	// . The NTSC renderer reports each line as it finishes it (see NTSC_SetDirtyLineTracker()), so a line that is still being
+	//   rendered when the frame is presented is reported by the next UpdateDirtyLineRanges()
+	// . Used by VideoCapture to only copy & convert the changed lines of each frame
+	typedef DirtyLineTracker::Range_t DirtyLineRange_t;
+	void SetDirtyLineTracking(bool enable);
+	bool GetDirtyLineTracking(void) { return m_dirtyLineTracking; }
+	void UpdateDirtyLineRanges(void);
+	const std::vector<DirtyLineRange_t>& GetDirtyLineRanges(void) { return m_dirtyLineTracker.GetRanges(); }
+
 	static const UINT kVideoRomSize2K = 1024*2;
 	static const UINT kVideoRomSize4K = kVideoRomSize2K*2;
 
@@ -295,6 +310,9 @@ private:
 	COLORREF g_nMonochromeRGB;	// saved to Registry
 	bool m_hasVidHD;
 
+	bool m_dirtyLineTracking;
+	DirtyLineTracker m_dirtyLineTracker;
+
 	static const UINT kVideoRomSize8K = kVideoRomSize4K*2;
 	static const UINT kVideoRomSize16K = kVideoRomSize8K*2;
 	static const UINT kVideoRomSizeMax = kVideoRomSize16K;
@@ -0,0 +1,507 @@
+/*
+AppleWin : An Apple //e emulator for Windows
+
+Copyright (C) 1994-1996, Michael O'Brien
+Copyright (C) 1999-2001, Oliver Schmidt
+Copyright (C) 2002-2005, Tom Charlesworth
+Copyright (C) 2006-2024, Tom Charlesworth, Michael Pohoreski, Nick Westgate
+
+AppleWin is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+AppleWin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with AppleWin; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Description: Raw video (Y4M / RGBA) & audio (WAV) capture
+ *
+ * The emulation thread only ever does a memcpy of the presented frame's changed lines (see
+ * Video::GetDirtyLineRanges()) into a free buffer from a preallocated pool. If the writer thread has fallen behind & there is no free buffer then the
+ * frame is dropped (and counted), rather than stalling the emulation on disk I/O. The writer thread then repeats the previous frame in its
+ * place, since Y4M (and raw) video has a fixed frame rate: skipping it would shorten the video, and put it out of sync with the WAV.
+ *
+ * Author: Various
+ */
+
+#include "StdAfx.h"
+#include "VideoCapture.h"
+
+#include "Interface.h"
+#include "Log.h"
+
+VideoCapture& GetVideoCapture(void)
+{
+	static VideoCapture g_videoCapture;	// singleton
+	return g_videoCapture;
+}
+
+VideoCapture::VideoCapture(void)
+{
+	m_isActive = false;
+	m_format = FORMAT_Y4M;
+	m_pVideoFile = NULL;
+	m_pWavFile = NULL;
+	m_width = 0;
+	m_height = 0;
+	m_forceFullFrame = true;
+	m_prevDirtyLineTracking = false;
+	m_audioSampleRate = 0;
+	m_audioNumChannels = 0;
+	m_audioBytesWritten = 0;
+	m_quit = false;
+	m_numFramesToRepeat = 0;
+	m_audioWritePos = 0;
+	m_audioReadPos = 0;
+	m_numFramesCaptured = 0;
+	m_numFramesDropped = 0;
+	m_numFramesWritten = 0;
+	m_numAudioSamplesDropped = 0;
+	m_writeFailed = false;
+}
+
+VideoCapture::~VideoCapture(void)
+{
+	Stop();
+}
+
+VideoCapture::Format_e VideoCapture::GetFormatFromFilename(const std::string& filename)
+{
+	const size_t dot = filename.find_last_of('.');
+	if (dot != std::string::npos)
+	{
+		const std::string ext = filename.substr(dot);
+		if (_stricmp(ext.c_str(), ".rgba") == 0 || _stricmp(ext.c_str(), ".raw") == 0)
+			return FORMAT_RAW_RGBA;
+	}
+
+	return FORMAT_Y4M;
+}
+
+//===========================================================================
+
+bool VideoCapture::Start(const std::string& videoFilename, const std::string& wavFilename, UINT fpsNumerator, UINT fpsDenominator, UINT audioSampleRate, UINT audioNumChannels)
+{
+	if (m_isActive)
+		Stop();
+
+	m_format = GetFormatFromFilename(videoFilename);
+	m_width = GetVideo().GetFrameBufferBorderlessWidth();
+	m_height = GetVideo().GetFrameBufferBorderlessHeight();
+
+	m_pVideoFile = fopen(videoFilename.c_str(), "wb");
+	if (!m_pVideoFile)
+	{
+		LogFileOutput("VideoCapture: Failed to open: %s\n", videoFilename.c_str());
+		return false;
+	}
+
+	if (m_format == FORMAT_Y4M)
+	{
+		// Fixed frame size for the whole stream (frames of a different size, eg. after a VidHD change, are dropped)
+		fprintf(m_pVideoFile, "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C444\n", m_width, m_height, fpsNumerator, fpsDenominator);
+	}
+
+	m_audioSampleRate = audioSampleRate;
+	m_audioNumChannels = audioNumChannels;
+	m_audioBytesWritten = 0;
+	if (!wavFilename.empty() && m_audioNumChannels)
+	{
+		m_pWavFile = fopen(wavFilename.c_str(), "wb");
+		if (!m_pWavFile || !WriteWavHeader())
+			LogFileOutput("VideoCapture: Failed to open: %s\n", wavFilename.c_str());
+	}
+
+	// Preallocate everything, so that the emulation thread never allocates
+	m_framePool.resize(kNumFrameBuffers);
+	m_freeFrames.clear();
+	for (UINT i = 0; i < kNumFrameBuffers; i++)
+	{
+		m_framePool[i].pixels.resize(m_width * m_height);
+		m_framePool[i].dirtyLines.reserve(m_height);
+		m_framePool[i].numRepeats = 0;
+		m_freeFrames.push_back(i);
+	}
+	m_readyFrames = std::queue<UINT>();
+	m_numFramesToRepeat = 0;
+
+	m_audioRing.resize(m_pWavFile ? (kAudioBufferSeconds * m_audioSampleRate * m_audioNumChannels) : 0);
+	m_audioWritePos = 0;
+	m_audioReadPos = 0;
+
+	// Black, in case frames are dropped before the first one is written (eg. if the frame size has already changed)
+	m_writeBuffer.assign(m_width * m_height * sizeof(uint32_t), 0);
+	if (m_format == FORMAT_Y4M)
+	{
+		memset(&m_writeBuffer[0], 16, m_width * m_height);							// Y
+		memset(&m_writeBuffer[m_width * m_height], 128, m_width * m_height * 2);	// Cb, Cr
+	}
+
+	m_numFramesCaptured = 0;
+	m_numFramesDropped = 0;
+	m_numFramesWritten = 0;
+	m_numAudioSamplesDropped = 0;
+	m_writeFailed = false;
+
+	// Only the changed lines get copied & converted, so the first frame (and the one after any drop) must be copied in full
+	m_prevDirtyLineTracking = GetVideo().GetDirtyLineTracking();
+	GetVideo().SetDirtyLineTracking(true);
+	m_forceFullFrame = true;
+
+	m_quit = false;
+	m_writerThread = std::thread(&VideoCapture::WriterThread, this);
+	m_isActive = true;
+
+	LogFileOutput("VideoCapture: Started: %s (%ux%u, %s)\n", videoFilename.c_str(), m_width, m_height, m_format == FORMAT_Y4M ? "Y4M" : "RGBA");
+	return true;
+}
+
+void VideoCapture::Stop(void)
+{
+	if (!m_isActive)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_cv.notify_one();
+	m_writerThread.join();	// Drains all pending frames & audio first (unless a write failed)
+
+	fclose(m_pVideoFile);
+	m_pVideoFile = NULL;
+
+	if (m_pWavFile)
+	{
+		FinishWavFile();
+		fclose(m_pWavFile);
+		m_pWavFile = NULL;
+	}
+
+	m_isActive = false;
+	GetVideo().SetDirtyLineTracking(m_prevDirtyLineTracking);
+
+	LogFileOutput("VideoCapture: Stopped: captured=%u, written=%u, dropped=%u, audio samples dropped=%u\n",
+		(UINT)m_numFramesCaptured, (UINT)m_numFramesWritten, (UINT)m_numFramesDropped, (UINT)m_numAudioSamplesDropped);
+
+	m_framePool.clear();
+	m_audioRing.clear();
+	m_writeBuffer.clear();
+}
+
+UINT64 VideoCapture::GetNumFramesWritten(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numFramesWritten;
+}
+
+//===========================================================================
+
+// Called at the end of each VideoPresentScreen()
+void VideoCapture::CaptureFrame(void)
+{
+	if (!m_isActive)
+		return;
+
+	if (m_writeFailed)
+	{
+		Stop();
+		return;
+	}
+
+	Video& video = GetVideo();
+	if (video.GetFrameBufferBorderlessWidth() != m_width || video.GetFrameBufferBorderlessHeight() != m_height)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			DropFrame();
+		}
+		m_cv.notify_one();
+		return;
+	}
+
+	UINT idx;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_freeFrames.empty())
+		{
+			DropFrame();	// NB. the writer is busy, so no need to notify it
+			return;
+		}
+		idx = m_freeFrames.back();
+		m_freeFrames.pop_back();
+	}
+
+	// Framebuffer is bottom-up (see NTSC_VideoInit()), so flip to top-down whilst copying the borderless area
+	const UINT pitch = video.GetFrameBufferWidth();
+	const uint32_t* pSrc = (const uint32_t*) video.GetFrameBuffer();
+	pSrc += video.GetFrameBufferBorderHeight() * pitch + video.GetFrameBufferBorderWidth();	// Skip bottom border & left border
+	pSrc += (m_height - 1) * pitch;		// Start at top line
+
+	Frame_t& frame = m_framePool[idx];
+	frame.dirtyLines.clear();
+	if (m_forceFullFrame)
+	{
+		DirtyLineTracker::Range_t range;
+		range.firstLine = 0;
+		range.numLines = m_height;
+		frame.dirtyLines.push_back(range);
+		m_forceFullFrame = false;
+	}
+	else
+	{
+		frame.dirtyLines = video.GetDirtyLineRanges();	// NB. capacity was reserved for the worst case by Start()
+	}
+
+	uint32_t* pDst = &frame.pixels[0];
+	for (size_t i = 0; i < frame.dirtyLines.size(); i++)
+	{
+		const DirtyLineTracker::Range_t& range = frame.dirtyLines[i];
+		for (UINT y = range.firstLine; y < range.firstLine + range.numLines; y++)
+		{
+			memcpy(pDst, pSrc - (int)y * (int)pitch, m_width * sizeof(uint32_t));
+			pDst += m_width;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readyFrames.push(idx);
+	}
+	m_cv.notify_one();
+
+	m_numFramesCaptured++;
+}
+
+// Called with m_mutex held
+void VideoCapture::DropFrame(void)
+{
+	m_numFramesDropped++;
+	m_forceFullFrame = true;	// This frame's changes would otherwise be lost
+
+	// Repeat the previous frame in its place: the last one queued, or if none then the last one written
+	if (m_readyFrames.empty())
+		m_numFramesToRepeat++;
+	else
+		m_framePool[m_readyFrames.back()].numRepeats++;
+}
+
+void VideoCapture::CaptureAudio(const short* pSamples, UINT numSamples)
+{
+	if (!m_isActive || m_audioRing.empty() || m_writeFailed)
+		return;
+
+	const UINT64 ringSize = m_audioRing.size() / m_audioNumChannels;	// in sample frames
+
+	UINT64 writePos;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const UINT64 space = ringSize - (m_audioWritePos - m_audioReadPos);
+		if (numSamples > space)
+		{
+			m_numAudioSamplesDropped += numSamples - space;
+			numSamples = (UINT) space;
+		}
+		writePos = m_audioWritePos;
+	}
+
+	// NB. Writer thread never reads beyond m_audioWritePos, so it's safe to fill this region without the lock
+	for (UINT i = 0; i < numSamples; )
+	{
+		const UINT offset = (UINT) ((writePos + i) % ringSize);
+		const UINT count = (UINT) std::min<UINT64>(numSamples - i, ringSize - offset);
+		memcpy(&m_audioRing[offset * m_audioNumChannels], &pSamples[i * m_audioNumChannels], count * m_audioNumChannels * sizeof(short));
+		i += count;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_audioWritePos += numSamples;
+	}
+	m_cv.notify_one();
+}
+
+//===========================================================================
+
+void VideoCapture::WriterThread(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_cv.wait(lock, [this] { return m_quit || m_numFramesToRepeat || !m_readyFrames.empty() || m_audioWritePos != m_audioReadPos; });
+
+		bool ok = true;
+
+		if (m_numFramesToRepeat)
+		{
+			const UINT numRepeats = m_numFramesToRepeat;
+			m_numFramesToRepeat = 0;
+
+			lock.unlock();
+			ok = WriteBufferedFrame(numRepeats);
+			lock.lock();
+		}
+
+		if (ok && !m_readyFrames.empty())
+		{
+			const UINT idx = m_readyFrames.front();
+			m_readyFrames.pop();
+			const UINT numRepeats = m_framePool[idx].numRepeats;
+			m_framePool[idx].numRepeats = 0;
+
+			lock.unlock();
+			ok = WriteFrame(m_framePool[idx]) && WriteBufferedFrame(numRepeats);
+			lock.lock();
+
+			m_freeFrames.push_back(idx);
+			m_numFramesWritten++;
+		}
+
+		if (ok && m_audioWritePos != m_audioReadPos)
+		{
+			const UINT64 ringSize = m_audioRing.size() / m_audioNumChannels;
+			const UINT offset = (UINT) (m_audioReadPos % ringSize);
+			const UINT count = (UINT) std::min<UINT64>(m_audioWritePos - m_audioReadPos, ringSize - offset);
+
+			lock.unlock();
+			ok = WriteAudio(&m_audioRing[offset * m_audioNumChannels], count);
+			lock.lock();
+
+			m_audioReadPos += count;
+		}
+
+		if (!ok)
+		{
+			LogFileOutput("VideoCapture: Write failed (errno=%d), stopping capture\n", errno);
+			m_writeFailed = true;
+			break;
+		}
+
+		if (m_quit && m_numFramesToRepeat == 0 && m_readyFrames.empty() && m_audioWritePos == m_audioReadPos)
+			break;
+	}
+}
+
+// NB. m_writeBuffer holds the previous converted frame, so only the changed lines need converting
+bool VideoCapture::WriteFrame(const Frame_t& frame)
+{
+	const UINT numPixels = m_width * m_height;
+	const uint32_t* pSrc = &frame.pixels[0];
+
+	if (m_format == FORMAT_RAW_RGBA)
+	{
+		for (size_t i = 0; i < frame.dirtyLines.size(); i++)
+		{
+			const DirtyLineTracker::Range_t& range = frame.dirtyLines[i];
+			uint8_t* pDst = &m_writeBuffer[range.firstLine * m_width * 4];
+
+			for (UINT j = 0; j < range.numLines * m_width; j++)
+			{
+				const bgra_t& pixel = (const bgra_t&) *pSrc++;
+				*pDst++ = pixel.r;
+				*pDst++ = pixel.g;
+				*pDst++ = pixel.b;
+				*pDst++ = ALPHA;
+			}
+		}
+
+		return WriteBufferedFrame(1);
+	}
+
+	// Y4M (C444): Y, Cb and Cr planes - BT.601 limited range
+	for (size_t i = 0; i < frame.dirtyLines.size(); i++)
+	{
+		const DirtyLineTracker::Range_t& range = frame.dirtyLines[i];
+		uint8_t* pY = &m_writeBuffer[range.firstLine * m_width];
+		uint8_t* pU = pY + numPixels;
+		uint8_t* pV = pU + numPixels;
+
+		for (UINT j = 0; j < range.numLines * m_width; j++)
+		{
+			const bgra_t& pixel = (const bgra_t&) *pSrc++;
+			const int r = pixel.r, g = pixel.g, b = pixel.b;
+			pY[j] = (uint8_t) ((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+			pU[j] = (uint8_t) (((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+			pV[j] = (uint8_t) (((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	return WriteBufferedFrame(1);
+}
+
+// Writes the last converted frame count times
+bool VideoCapture::WriteBufferedFrame(UINT count)
+{
+	const size_t size = m_width * m_height * (m_format == FORMAT_Y4M ? 3 : 4);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		if (m_format == FORMAT_Y4M && fputs("FRAME\n", m_pVideoFile) == EOF)
+			return false;
+		if (fwrite(&m_writeBuffer[0], 1, size, m_pVideoFile) != size)
+			return false;
+	}
+
+	return true;
+}
+
+//===========================================================================
+
+// Same format as RiffInitWriteFile(): 16-bit PCM
+bool VideoCapture::WriteWavHeader(void)
+{
+	const UINT32 zero = 0;
+	const UINT32 fmtLength = 16;
+	const UINT16 pcmFormat = 1;
+	const UINT16 numChannels = (UINT16) m_audioNumChannels;
+	const UINT32 sampleRate = m_audioSampleRate;
+	const UINT32 bytesPerSecond = m_audioSampleRate * 2 * m_audioNumChannels;
+	const UINT16 blockAlign = (UINT16) (2 * m_audioNumChannels);
+	const UINT16 bitsPerSample = 16;
+
+	fwrite("RIFF", 4, 1, m_pWavFile);
+	fwrite(&zero, 4, 1, m_pWavFile);			// total size: fixed up by FinishWavFile()
+	fwrite("WAVE", 4, 1, m_pWavFile);
+	fwrite("fmt ", 4, 1, m_pWavFile);
+	fwrite(&fmtLength, 4, 1, m_pWavFile);
+	fwrite(&pcmFormat, 2, 1, m_pWavFile);
+	fwrite(&numChannels, 2, 1, m_pWavFile);
+	fwrite(&sampleRate, 4, 1, m_pWavFile);
+	fwrite(&bytesPerSecond, 4, 1, m_pWavFile);
+	fwrite(&blockAlign, 2, 1, m_pWavFile);
+	fwrite(&bitsPerSample, 2, 1, m_pWavFile);
+	fwrite("data", 4, 1, m_pWavFile);
+	return fwrite(&zero, 4, 1, m_pWavFile) == 1;	// data length: fixed up by FinishWavFile()
+}
+
+bool VideoCapture::WriteAudio(const short* pSamples, UINT numSamples)
+{
+	if (!m_pWavFile)
+		return true;
+
+	const size_t bytes = numSamples * m_audioNumChannels * sizeof(short);
+	if (fwrite(pSamples, 1, bytes, m_pWavFile) != bytes)
+		return false;
+	m_audioBytesWritten += bytes;
+	return true;
+}
+
+void VideoCapture::FinishWavFile(void)
+{
+	const UINT32 kHeaderSize = 44;
+	const UINT32 dataLength = (UINT32) m_audioBytesWritten;
+	const UINT32 totalLength = dataLength + kHeaderSize - 8;
+
+	fseek(m_pWavFile, 4, SEEK_SET);
+	fwrite(&totalLength, 4, 1, m_pWavFile);
+	fseek(m_pWavFile, kHeaderSize - 4, SEEK_SET);
+	fwrite(&dataLength, 4, 1, m_pWavFile);
+}
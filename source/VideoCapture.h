@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "DirtyLineTracker.h"
+
+// Raw video capture (Y4M or raw RGBA) with an optional paired WAV file.
+// . The emulation thread copies the changed lines of each presented frame into a preallocated buffer (or drops it if none are free)
+// . A background writer thread does all the colour-space conversion (of just the changed lines) and disk I/O
+// . A dropped frame is written as a repeat of the previous one, so the fixed frame rate video stays in sync with the WAV
+// . A failed write stops the capture
+
+class VideoCapture
+{
+public:
+	VideoCapture(void);
+	~VideoCapture(void);
+
+	enum Format_e
+	{
+		FORMAT_Y4M,			// YUV4MPEG2, 4:4:4 (BT.601)
+		FORMAT_RAW_RGBA,	// Headerless, 32bpp RGBA, top-down
+	};
+
+	bool Start(const std::string& videoFilename, const std::string& wavFilename, UINT fpsNumerator, UINT fpsDenominator, UINT audioSampleRate, UINT audioNumChannels);
+	void Stop(void);
+	bool IsActive(void) { return m_isActive; }
+
+	// Called from the emulation thread
+	void CaptureFrame(void);
+	void CaptureAudio(const short* pSamples, UINT numSamples);
+
+	UINT64 GetNumFramesCaptured(void) { return m_numFramesCaptured; }
+	UINT64 GetNumFramesDropped(void) { return m_numFramesDropped; }
+	UINT64 GetNumFramesWritten(void);
+	UINT64 GetNumAudioSamplesDropped(void) { return m_numAudioSamplesDropped; }
+
+	static Format_e GetFormatFromFilename(const std::string& filename);
+
+private:
+	struct Frame_t
+	{
+		std::vector<uint32_t> pixels;	// BGRA, top-down: only the lines in dirtyLines, packed together
+		std::vector<DirtyLineTracker::Range_t> dirtyLines;
+		UINT numRepeats;				// frames dropped after this one (guarded by m_mutex)
+	};
+
+	void DropFrame(void);
+	void WriterThread(void);
+	bool WriteFrame(const Frame_t& frame);
+	bool WriteBufferedFrame(UINT count);
+	bool WriteAudio(const short* pSamples, UINT numSamples);
+	bool WriteWavHeader(void);
+	void FinishWavFile(void);
+
+	static const UINT kNumFrameBuffers = 8;			// ~130ms of slack at 60Hz
+	static const UINT kAudioBufferSeconds = 2;
+
+	bool m_isActive;
+	Format_e m_format;
+	FILE* m_pVideoFile;
+	FILE* m_pWavFile;
+
+	UINT m_width;
+	UINT m_height;
+	bool m_forceFullFrame;				// emulation thread only: set when the writer's last frame isn't the last presented frame
+	bool m_prevDirtyLineTracking;
+
+	UINT m_audioSampleRate;
+	UINT m_audioNumChannels;
+	UINT64 m_audioBytesWritten;
+
+	// Shared between the emulation thread & the writer thread (guarded by m_mutex)
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_quit;
+	std::vector<Frame_t> m_framePool;
+	std::vector<UINT> m_freeFrames;
+	std::queue<UINT> m_readyFrames;
+	UINT m_numFramesToRepeat;				// frames dropped whilst m_readyFrames was empty: repeats of the last frame written
+	std::vector<short> m_audioRing;			// interleaved samples
+	UINT64 m_audioWritePos;					// in sample frames (ie. all channels)
+	UINT64 m_audioReadPos;
+
+	std::thread m_writerThread;
+	std::vector<uint8_t> m_writeBuffer;		// writer thread only: the converted last frame, updated a line at a time
+
+	UINT64 m_numFramesCaptured;
+	UINT64 m_numFramesDropped;
+	UINT64 m_numFramesWritten;				// guarded by m_mutex
+	UINT64 m_numAudioSamplesDropped;
+	std::atomic<bool> m_writeFailed;		// set by the writer thread, which then exits: the emulation thread stops the capture
+};
+
+VideoCapture& GetVideoCapture(void);
@@ -41,6 +41,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "ParallelPrinter.h"
 #include "Registry.h"
 #include "Riff.h"
+#include "VideoCapture.h"
 #include "SaveState.h"
 #include "SerialComms.h"
 #include "SoundCore.h"
@@ -52,6 +53,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 #include "Windows/Win32Frame.h"
 #include "RGBMonitor.h"
+#include "devrelay/service/DeviceSimulator.h"
+#include "devrelay/service/Listener.h"
 #include "NTSC.h"
 
 #include "Configuration/About.h"
@@ -260,10 +263,7 @@ static void ContinueExecution(void)
 #endif
 		g_dwCyclesThisFrame -= dwClksPerFrame;
 
-		if (g_bFullSpeed)
-			GetFrame().VideoRedrawScreenDuringFullSpeed(g_dwCyclesThisFrame);
-		else
-			GetFrame().VideoPresentScreen(); // Just copy the output of our Apple framebuffer to the system Back Buffer
+		GetFrame().VideoUpdateAtEndOfFrame(g_dwCyclesThisFrame);
 	}
 
 #ifdef LOG_PERF_TIMINGS
@@ -669,6 +669,42 @@ static void OneTimeInitialization(HINSTANCE passinstance)
 	LogFileOutput("Init: FrameRegisterClass()\n");
 }
 
+// -sp-sim: serve the images from the built-in SmartPort device simulator, for a SmartPort over SLIP card to boot from
+static void StartSmartPortSimulator(void)
+{
+	DeviceSimulator& simulator = GetDeviceSimulator();
+	if (simulator.get_device_count() == 0)	// the volumes are kept across a restart, like a real device
+	{
+		for (const std::string& image : g_cmdLine.spSimImages)
+			simulator.add_volume_from_file(image);
+		if (simulator.get_device_count() == 0)
+			return;
+
+		simulator.add_char_device();
+		simulator.add_network_device();
+
+		if (g_cmdLine.spSimExitSeconds)
+			simulator.set_idle_callback(g_cmdLine.spSimExitSeconds, [] { PostMessage(GetFrame().g_hFrameWindow, WM_CLOSE, 0, 0); });
+	}
+
+	Listener& listener = GetCommandListener();
+	if (!listener.get_is_listening())
+	{
+		listener.Initialize(listener.get_ip_address(), listener.get_port(), listener.get_response_timeout());
+		listener.start();
+	}
+
+	if (!simulator.start(listener.get_ip_address(), listener.get_port()))
+		return;
+
+	// Wait for the Listener to register the devices, so that booting straight away finds them
+	const DWORD startTime = GetTickCount();
+	while (listener.get_total_device_count() < simulator.get_device_count() && GetTickCount() - startTime < 5000)
+		Sleep(10);
+
+	LogFileOutput("Main: SmartPort simulator, %d devices registered\n", listener.get_total_device_count());
+}
+
 // DO INITIALIZATION THAT MUST BE REPEATED FOR A RESTART
 static void RepeatInitialization(void)
 {
@@ -685,6 +721,9 @@ static void RepeatInitialization(void)
 			LogFileOutput("Main: LoadConfiguration()\n");
 		}
 
+		if (!g_cmdLine.spSimImages.empty())
+			StartSmartPortSimulator();
+
 		if (g_cmdLine.model != A2TYPE_MAX)
 			SetApple2Type(g_cmdLine.model);
 
@@ -812,6 +851,9 @@ static void RepeatInitialization(void)
 			}
 		}
 
+		if (!g_cmdLine.ntscTableCacheFile.empty())
+			NTSC_SetTableCacheFile(g_cmdLine.ntscTableCacheFile);
+
 		// Create window after inserting/removing VidHD card (as it affects width & height)
 		{
 			Win32Frame::GetWin32Frame().SetViewportScale(Win32Frame::GetWin32Frame().GetViewportScale(), true);
@@ -819,6 +861,13 @@ static void RepeatInitialization(void)
 			GetFrame().Initialize(true); // g_pFramebufferinfo been created now & COM init'ed
 			LogFileOutput("Main: VideoInitialize()\n");
 
+			// Start after GetFrame().Initialize(), since capture frame size depends on VidHD
+			if (!g_cmdLine.videoCaptureFile.empty() && !GetVideoCapture().IsActive())
+			{
+				GetVideoCapture().Start(g_cmdLine.videoCaptureFile, g_cmdLine.videoCaptureWavFile,
+					(UINT)Get6502BaseClock(), NTSC_GetCyclesPerFrame(), SPKR_SAMPLE_RATE, Spkr_GetNumChannels());
+			}
+
 			LogFileOutput("Main: FrameCreateWindow() - pre\n");
 			Win32Frame::GetWin32Frame().FrameCreateWindow();	// GetFrame().g_hFrameWindow is now valid
 			LogFileOutput("Main: FrameCreateWindow() - post\n");
@@ -844,6 +893,9 @@ static void RepeatInitialization(void)
 				g_fullScreenResolutionChangedByUser = true;
 		}
 
+		if (g_cmdLine.fullSpeedRedraw != FrameBase::FSR_TIMED)
+			GetFrame().SetFullSpeedRedraw(g_cmdLine.fullSpeedRedraw, g_cmdLine.fullSpeedFrameSkip);
+
 		// Pre: may need g_hFrameWindow for MessageBox errors
 		// Post: may enable HDD, required for MemInitialize()->MemInitializeIO()
 		{
@@ -880,6 +932,12 @@ static void RepeatInitialization(void)
 		if (g_cmdLine.noDisk2StepperDefer)
 			GetCardMgr().GetDisk2CardMgr().SetStepperDefer(false);
 
+		if (g_cmdLine.diskFastLoad)
+		{
+			const UINT cyclesPerSector = g_cmdLine.diskFastLoadCyclesPerSector ? g_cmdLine.diskFastLoadCyclesPerSector : Disk2CardManager::kFastLoadDefaultCyclesPerSector;
+			GetCardMgr().GetDisk2CardMgr().SetFastLoad(true, cyclesPerSector);
+		}
+
 		// Call DebugInitialize() after SetCurrentImageDir()
 		DebugInitialize();
 		LogFileOutput("Main: DebugInitialize()\n");
@@ -993,6 +1051,15 @@ static void Shutdown(void)
 	CoUninitialize();
 	LogFileOutput("Exit: CoUninitialize()\n");
 
+	GetVideoCapture().Stop();	// Before LogDone(), as it logs the capture stats
+	GetFrame().LogVideoFrameStats();
+
+	if (!g_cmdLine.diskStatsFile.empty())
+	{
+		if (!GetCardMgr().WriteDiskStats(g_cmdLine.diskStatsFile))
+			LogFileOutput("Exit: Failed to write disk stats: %s\n", g_cmdLine.diskStatsFile.c_str());
+	}
+
 	LogDone();
 
 	RiffFinishWriteFile();
@@ -8,7 +8,10 @@
 #include "Log.h"
 #include "Memory.h"
 #include "CardManager.h"
+#include "DiskImage.h"
+#include "DiskImageHelper.h"
 #include "Debugger/Debug.h"
+#include "VideoCapture.h"
 #include "Tfe/PCapBackend.h"
 #include "../resource/resource.h"
 
@@ -20,6 +23,8 @@ Win32Frame::Win32Frame()
 	g_pFramebufferinfo = NULL;
 	num_draw_devices = 0;
 	g_lpDD = NULL;
+	m_lastScanLine = 0;
+	m_newDisplayRefresh = false;
 	g_hLogoBitmap = (HBITMAP)0;
 	g_hDeviceBitmap = (HBITMAP)0;
 	g_hDeviceDC = (HDC)0;
@@ -160,6 +165,38 @@ void Win32Frame::Destroy(void)
 }
 
 //===========================================================================
+// Number of random 512-byte block reads per second from an HDD image
+static DWORD BenchmarkHDDBlockReads(const std::string& pathname)
+{
+	ImageInfo* pImageInfo = NULL;
+	bool writeProtected = true;
+	std::string filenameInZip;
+	const ImageError_e error = ImageOpen(pathname, &pImageInfo, &writeProtected, false, filenameInZip, false);
+
+	if (error != eIMAGE_ERROR_NONE)
+		return 0;
+
+	const UINT numBlocks = ImageGetImageSize(pImageInfo) / HD_BLOCK_SIZE;
+	BYTE block[HD_BLOCK_SIZE];
+	DWORD totalreads = 0;
+	UINT seed = 1;
+
+	DWORD milliseconds = GetTickCount();
+	while (GetTickCount() == milliseconds);
+	milliseconds = GetTickCount();
+	do {
+		for (UINT i = 0; i < 1000; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			ImageReadBlock(pImageInfo, (seed >> 8) % numBlocks, block);
+		}
+		totalreads += 1000;
+	} while (GetTickCount() - milliseconds < 1000);
+
+	ImageClose(pImageInfo);
+	return totalreads;
+}
+
 void Win32Frame::Benchmark(void)
 {
 	_ASSERT(g_nAppMode == MODE_BENCHMARK);
@@ -222,6 +259,51 @@ void Win32Frame::Benchmark(void)
 		totalhiresfps++;
 	} while (GetTickCount() - milliseconds < 1000);
 
+	// SEE HOW MANY SUPER HI-RES FRAMES PER SECOND WE CAN PRODUCE (VIDHD ONLY),
+	// CYCLING THROUGH A SET OF FRAMES THAT USE A DIFFERENT PALETTE ON EVERY
+	// SCANLINE AND REWRITE ALL THE PALETTES EACH FRAME (LIKE 3200-COLOUR DEMOS)
+	DWORD totalshrfps = 0;
+	if (video.HasVidHD())
+	{
+		const UINT kSHRPixelDataEnd = 0x9D00;
+		const UINT kSHRControlBytes = 0x9D00;
+		const UINT kSHRPalettes = 0x9E00;
+		const UINT kSHRNumLines = 200;
+
+		for (UINT addr = 0x2000; addr < kSHRPixelDataEnd; addr++)
+			*MemGetAuxPtr(addr) = (BYTE)((addr & 0xff) ^ (addr >> 8));
+
+		// Frame set: 320 mode, 320 mode with colour-fill on odd scanlines, 320 mode with palettes in reverse order
+		const UINT kNumSHRFrames = 3;
+		video.SetVideoMode(VF_SHR);
+		milliseconds = GetTickCount();
+		while (GetTickCount() == milliseconds);
+		milliseconds = GetTickCount();
+		cycle = 0;
+		do {
+			for (UINT i = 0; i < 16 * 16; i++)	// 16 palettes x 16 colours
+			{
+				const UINT color = (i + cycle * 37) & 0xfff;
+				*MemGetAuxPtr(kSHRPalettes + i * 2 + 0) = (BYTE)(color & 0xff);
+				*MemGetAuxPtr(kSHRPalettes + i * 2 + 1) = (BYTE)(color >> 8);
+			}
+
+			const UINT frame = cycle % kNumSHRFrames;
+			for (UINT line = 0; line < kSHRNumLines; line++)
+			{
+				BYTE scb = (frame == 2) ? (BYTE)(15 - (line & 0xf)) : (BYTE)(line & 0xf);
+				if (frame == 1 && (line & 1))
+					scb |= 0x20;	// colour-fill
+				*MemGetAuxPtr(kSHRControlBytes + line) = scb;
+			}
+
+			VideoRedrawScreen();
+			cycle++;
+			totalshrfps++;
+		} while (GetTickCount() - milliseconds < 1000);
+		video.SetVideoMode(VF_HIRES);
+	}
+
 	// DETERMINE HOW MANY 65C02 CLOCK CYCLES WE CAN EMULATE PER SECOND WITH
 	// NOTHING ELSE GOING ON
 	DWORD totalmhz10[2] = { 0,0 };	// bVideoUpdate & !bVideoUpdate
@@ -313,18 +395,45 @@ void Win32Frame::Benchmark(void)
 		realisticfps++;
 	} while (GetTickCount() - milliseconds < 1000);
 
+	// HOW MANY HDD BLOCKS CAN WE READ PER SECOND
+	DWORD totalhddreads = 0;
+	{
+		char szTempPath[MAX_PATH];
+		GetTempPath(MAX_PATH, szTempPath);
+		const std::string pathname = std::string(szTempPath) + "AppleWin-Benchmark.hdv";
+
+		const UINT kHDDImageSize = 4 * 1024 * 1024;
+		HANDLE hFile = CreateFile(pathname.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			std::vector<BYTE> image(kHDDImageSize, 0xE5);
+			DWORD dwBytesWritten = 0;
+			BOOL res = WriteFile(hFile, &image[0], kHDDImageSize, &dwBytesWritten, NULL);
+			CloseHandle(hFile);
+
+			if (res && dwBytesWritten == kHDDImageSize)
+				totalhddreads = BenchmarkHDDBlockReads(pathname);
+
+			DeleteFile(pathname.c_str());
+		}
+	}
+
 	// DISPLAY THE RESULTS
 	DisplayLogo();
+	std::string strSHR = video.HasVidHD() ? StrFormat(", %u shr", (unsigned)totalshrfps) : "";
 	std::string strText = StrFormat(
-		"Pure Video FPS:\t%u hires, %u text\n"
+		"Pure Video FPS:\t%u hires, %u text%s\n"
 		"Pure CPU MHz:\t%u.%u%s (video update)\n"
-		"Pure CPU MHz:\t%u.%u%s (full-speed)\n\n"
+		"Pure CPU MHz:\t%u.%u%s (full-speed)\n"
+		"HDD blocks/s:\t%u (random reads)\n\n"
 		"EXPECTED AVERAGE VIDEO GAME\n"
 		"PERFORMANCE: %u FPS",
 		(unsigned)totalhiresfps,
 		(unsigned)totaltextfps,
+		strSHR.c_str(),
 		(unsigned)(totalmhz10[0] / 10), (unsigned)(totalmhz10[0] % 10), (LPCTSTR)(IS_APPLE2 ? " (6502)" : ""),
 		(unsigned)(totalmhz10[1] / 10), (unsigned)(totalmhz10[1] % 10), (LPCTSTR)(IS_APPLE2 ? " (6502)" : ""),
+		(unsigned)totalhddreads,
 		(unsigned)realisticfps);
 	FrameMessageBox(
 		strText.c_str(),
@@ -449,6 +558,8 @@ void Win32Frame::DisplayLogo(void)
 
 void Win32Frame::VideoPresentScreen(void)
 {
+	GetVideo().UpdateDirtyLineRanges();
+
 	HDC hFrameDC = FrameGetDC();
 
 	if (hFrameDC)
@@ -471,6 +582,7 @@ void Win32Frame::VideoPresentScreen(void)
 			xSrc, ySrc,
 			video.GetFrameBufferBorderlessWidth(), video.GetFrameBufferBorderlessHeight(),
 			SRCCOPY);
+		CountFramePresented();
 	}
 
 #ifdef NO_DIRECT_X
@@ -479,6 +591,43 @@ void Win32Frame::VideoPresentScreen(void)
 #endif // NO_DIRECT_X
 
 	GdiFlush();
+
+	GetVideoCapture().CaptureFrame();
+}
+
+// FSR_WHEN_READY: poll the display's scan line, and only present again once it has wrapped around (ie. a new refresh has begun).
+// This is called once per emulated video frame, which at full-speed is many times per host refresh.
+bool Win32Frame::IsReadyToPresent(void)
+{
+#ifdef NO_DIRECT_X
+	return FrameBase::IsReadyToPresent();
+#else
+	if (!g_lpDD)
+		return FrameBase::IsReadyToPresent();
+
+	DWORD scanLine = 0;
+	const HRESULT hr = g_lpDD->GetScanLine(&scanLine);
+	if (hr == DDERR_VERTICALBLANKINPROGRESS)
+	{
+		m_newDisplayRefresh = true;
+		scanLine = 0;
+	}
+	else if (FAILED(hr))
+	{
+		return FrameBase::IsReadyToPresent();	// eg. DDERR_UNSUPPORTED by the display driver
+	}
+	else if (scanLine < m_lastScanLine)
+	{
+		m_newDisplayRefresh = true;
+	}
+	m_lastScanLine = scanLine;
+
+	if (!m_newDisplayRefresh)
+		return false;
+
+	m_newDisplayRefresh = false;
+	return true;
+#endif // NO_DIRECT_X
 }
 
 //===========================================================================
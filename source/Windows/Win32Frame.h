@@ -50,6 +50,7 @@ public:
 	virtual void Initialize(bool resetVideoState);
 	virtual void Destroy(void);
 	virtual void VideoPresentScreen(void);
+	virtual bool IsReadyToPresent(void);
 	virtual void ResizeWindow(void);
 
 	virtual int FrameMessageBox(LPCSTR lpText, LPCSTR lpCaption, UINT uType);
@@ -155,6 +156,8 @@ private:
 	GUID draw_device_guid[MAX_DRAW_DEVICES];
 	int num_draw_devices;
 	LPDIRECTDRAW g_lpDD;
+	DWORD m_lastScanLine;		// for IsReadyToPresent()
+	bool m_newDisplayRefresh;
 
 	HBITMAP buttonbitmap[BUTTONS];
 
@@ -53,6 +53,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "../resource/resource.h"
 #include "Configuration/PropertySheet.h"
 #include "Debugger/Debug.h"
+#include "devrelay/service/DeviceSimulator.h"
 #if _MSC_VER < 1900	// VS2013 or before (cl.exe v18.x or before)
 #include <sys/stat.h>
 #endif
@@ -1055,6 +1056,7 @@ LRESULT Win32Frame::WndProc(
     case WM_DESTROY:
       LogFileOutput("WM_DESTROY\n");
       GetCommandListener().stop();
+      GetDeviceSimulator().stop();	// after the Listener has closed its end of the connection
       DragAcceptFiles(window,0);
 	  if (!g_bRestart)	// GH#564: Only save-state on shutdown (not on a restart)
 		Snapshot_Shutdown();
@@ -2154,6 +2156,12 @@ void Win32Frame::ProcessDiskPopupMenu(HWND hwnd, POINT pt, const int iDrive)
 	if (disk2Card.IsDriveEmpty(iDrive))
 		EnableMenuItem(hmenu, ID_DISKMENU_EJECT, MF_GRAYED);
 
+	if (!disk2Card.IsMultiFileZipInDrive(iDrive))
+	{
+		EnableMenuItem(hmenu, ID_DISKMENU_NEXT_DISK_IN_ZIP, MF_GRAYED);
+		EnableMenuItem(hmenu, ID_DISKMENU_PREV_DISK_IN_ZIP, MF_GRAYED);
+	}
+
 	if (disk2Card.GetProtect(iDrive))
 	{
 		// If image-file is read-only (or a gzip) then disable these menu items
@@ -2178,6 +2186,12 @@ void Win32Frame::ProcessDiskPopupMenu(HWND hwnd, POINT pt, const int iDrive)
 	if (iCommand == ID_DISKMENU_WRITEPROTECTION_OFF)
 		disk2Card.SetProtect( iDrive, false );
 	else
+	if (iCommand == ID_DISKMENU_NEXT_DISK_IN_ZIP)
+		disk2Card.InsertNextDiskInZip( iDrive, true );
+	else
+	if (iCommand == ID_DISKMENU_PREV_DISK_IN_ZIP)
+		disk2Card.InsertNextDiskInZip( iDrive, false );
+	else
 	if (iCommand == ID_DISKMENU_SENDTO_CIDERPRESS)
 	{
 		static char szCiderpressNotFoundCaption[] = "CiderPress not found";
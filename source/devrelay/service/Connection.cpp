@@ -1,5 +1,6 @@
 #ifdef DEV_RELAY_SLIP
 
+#include <algorithm>
 #include <condition_variable>
 #include <cstdint>
 #include <mutex>
@@ -14,14 +15,92 @@ std::optional<std::vector<uint8_t>> Connection::wait_for_response(uint8_t reques
 {
 	std::unique_lock<std::mutex> lock(data_mutex_);
 	// mutex is unlocked as it goes into a wait, so then the inserting thread can
-	// add to map, and this can then pick it up when notified, or timeout.
-	if (!data_cv_.wait_for(lock, timeout, [this, request_id]() { return data_map_.count(request_id) > 0; }))
+	// fill the slot, and this can then pick it up when notified, or timeout.
+	if (!data_cv_.wait_for(lock, timeout, [this, request_id]() { return slots_[request_id].ready; }))
 	{
 		return std::nullopt;
 	}
-	std::vector<uint8_t> response_data = data_map_[request_id];
-	data_map_.erase(request_id);
-	return response_data;
+	return take_slot(request_id);
+}
+
+// data_mutex_ must be held
+std::optional<std::vector<uint8_t>> Connection::take_slot(const uint8_t id)
+{
+	ResponseSlot &slot = slots_[id];
+	slot.ready = false;
+	ready_count_--;
+	return std::move(slot.data);
+}
+
+// Drops any response held for the given id, e.g. a stray frame, so a new request using the id does not pick it up
+void Connection::discard_response(uint8_t request_id)
+{
+	std::lock_guard<std::mutex> lock(data_mutex_);
+	if (slots_[request_id].ready)
+	{
+		slip_decoder_.recycle(*take_slot(request_id));
+	}
+}
+
+// Gives up on a request that was sent, e.g. a read-ahead that is no longer wanted, or one that timed out.
+// Its response is dropped whether it is already here or arrives within the timeout. Responses only echo the request number,
+// so until then the number must not be reused (see is_abandoned), else the late response would be taken as the new request's.
+void Connection::abandon_response(uint8_t request_id, std::chrono::seconds timeout)
+{
+	std::lock_guard<std::mutex> lock(data_mutex_);
+	ResponseSlot &slot = slots_[request_id];
+	if (slot.ready)
+	{
+		slip_decoder_.recycle(*take_slot(request_id));
+	}
+	else
+	{
+		slot.abandoned_until = std::chrono::steady_clock::now() + timeout;
+	}
+}
+
+bool Connection::is_abandoned(uint8_t request_id)
+{
+	std::lock_guard<std::mutex> lock(data_mutex_);
+	return std::chrono::steady_clock::now() < slots_[request_id].abandoned_until;
+}
+
+// Frames are keyed on their first byte, the request number, which is the same for a request and its response
+void Connection::receive_data(const uint8_t *data, const size_t length)
+{
+	bool received = false;
+	slip_decoder_.feed(data, length, [this, &received](std::vector<uint8_t> &&packet) {
+		std::lock_guard<std::mutex> lock(data_mutex_);
+		ResponseSlot &slot = slots_[packet[0]];
+		if (slot.abandoned_until != std::chrono::steady_clock::time_point())
+		{
+			// the late response to an abandoned request, unless it is so late that the number may have been reused
+			const bool abandoned = std::chrono::steady_clock::now() < slot.abandoned_until;
+			slot.abandoned_until = std::chrono::steady_clock::time_point();
+			if (abandoned)
+			{
+				slip_decoder_.recycle(std::move(packet));
+				return;
+			}
+		}
+		if (slot.ready)
+		{
+			// an unclaimed frame with the same number is stale, the newer one replaces it
+			slip_decoder_.recycle(std::move(slot.data));
+		}
+		else
+		{
+			ready_count_++;
+		}
+		slot.data = std::move(packet);
+		slot.ready = true;
+		received = true;
+	});
+
+	if (received)
+	{
+		data_cv_.notify_all();
+	}
 }
 
 // This is used by devices that are waiting for requests from AppleWin.
@@ -32,13 +111,10 @@ std::optional<std::vector<uint8_t>> Connection::wait_for_request()
 	while (is_connected_)
 	{
 		std::unique_lock<std::mutex> lock(data_mutex_);
-		if (data_cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !data_map_.empty(); }))
+		if (data_cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() { return ready_count_ > 0; }))
 		{
-			const auto it = data_map_.begin();
-			std::vector<uint8_t> request_data = it->second;
-			data_map_.erase(it);
-
-			return request_data;
+			const auto it = std::find_if(slots_.begin(), slots_.end(), [](const ResponseSlot &slot) { return slot.ready; });
+			return take_slot(static_cast<uint8_t>(it - slots_.begin()));
 		}
 	}
 	return std::nullopt;
@@ -6,12 +6,13 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
-#include <map>
 #include <mutex>
 #include <optional>
 #include <thread>
 #include <vector>
 
+#include "../slip/SLIP.h"
+
 class Connection
 {
 public:
@@ -25,15 +26,36 @@ public:
 	void set_is_connected(const bool is_connected) { is_connected_ = is_connected; }
 
 	std::optional<std::vector<uint8_t>> wait_for_response(uint8_t request_id, std::chrono::seconds timeout);
+	void discard_response(uint8_t request_id);
+	void abandon_response(uint8_t request_id, std::chrono::seconds timeout);
+	bool is_abandoned(uint8_t request_id);
+	// Hands a buffer returned by wait_for_response/wait_for_request back for reuse by the decoder
+	void recycle_buffer(std::vector<uint8_t> &&buffer) { slip_decoder_.recycle(std::move(buffer)); }
 	std::optional<std::vector<uint8_t>> wait_for_request();
 
+	// Called by whatever reads the transport (a reading thread, or the Reactor) with the bytes that arrived, in any chunking
+	void receive_data(const uint8_t *data, size_t length);
+
 	void join();
 
 private:
 	std::atomic<bool> is_connected_{false};
 
+	// One slot per request number: a frame goes straight to slots_[packet[0]], with no map to search or rebalance
+	struct ResponseSlot
+	{
+		bool ready = false;
+		std::vector<uint8_t> data;
+		std::chrono::steady_clock::time_point abandoned_until{}; // a response arriving before this is for an abandoned request
+	};
+
+	std::optional<std::vector<uint8_t>> take_slot(uint8_t id);
+
+	std::array<ResponseSlot, 256> slots_;
+	size_t ready_count_ = 0;
+
 protected:
-	std::map<uint8_t, std::vector<uint8_t>> data_map_;
+	SLIPDecoder slip_decoder_;
 	std::thread reading_thread_;
 
 	std::mutex data_mutex_;
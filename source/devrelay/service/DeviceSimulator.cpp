@@ -0,0 +1,491 @@
+#if defined(DEV_RELAY_SLIP) && defined(SLIP_PROTOCOL_NET)
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "DeviceSimulator.h"
+
+#include "../commands/Read.h"
+#include "../commands/ReadBlock.h"
+#include "../commands/Status.h"
+#include "../commands/Write.h"
+#include "../commands/WriteBlock.h"
+#include "../types/Request.h"
+#include "../types/Response.h"
+
+#include "Log.h"
+
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+	#define CLOSE_SOCKET closesocket
+	#define SHUTDOWN_SOCKET(s) shutdown(s, SD_BOTH)
+	#define SOCKET_ERROR_CODE WSAGetLastError()
+#else
+	#include <arpa/inet.h>
+	#include <errno.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/socket.h>
+	#include <sys/time.h>
+	#include <unistd.h>
+	#define CLOSE_SOCKET close
+	#define SHUTDOWN_SOCKET(s) shutdown(s, SHUT_RDWR)
+	#define SOCKET_ERROR_CODE errno
+	#define INVALID_SOCKET -1
+	#define SOCKET_ERROR -1
+#endif
+
+namespace
+{
+	// SmartPort error codes returned by the simulated devices
+	constexpr uint8_t SP_OK = 0x00;
+	constexpr uint8_t SP_BAD_CMD = 0x01;
+	constexpr uint8_t SP_BAD_CTL = 0x21;
+	constexpr uint8_t SP_IO_ERROR = 0x27;
+	constexpr uint8_t SP_NO_WRITE = 0x2B;
+	constexpr uint8_t SP_BAD_BLOCK = 0x2D;
+	constexpr uint8_t SP_OFFLINE = 0x2F;
+
+	// DIB device types and status bytes
+	constexpr uint8_t DIB_TYPE_HARDDISK = 0x02;
+	constexpr uint8_t DIB_TYPE_CHAR = 0x0F;
+	constexpr uint8_t DIB_TYPE_NETWORK = 0x11;
+	constexpr uint8_t DIB_STATUS_BLOCK = 0xF8;	 // block device, write/read allowed, online, format allowed
+	constexpr uint8_t DIB_STATUS_BLOCK_WP = 0xBC; // as above, but write protected
+	constexpr uint8_t DIB_STATUS_CHAR = 0x70;	 // write/read allowed, online
+
+	constexpr int CONNECT_ATTEMPTS = 50; // the Listener starts asynchronously, keep trying for 5 seconds
+	constexpr int RECEIVE_TIMEOUT_MS = 100;
+
+	uint16_t get_uint16(const std::array<uint8_t, 2> &bytes) { return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8)); }
+	uint32_t get_uint24(const std::array<uint8_t, 3> &bytes) { return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16); }
+
+	// Request::from_packet trusts the packet length, so check it before handing the packet over
+	size_t minimum_packet_size(const uint8_t command)
+	{
+		switch (command)
+		{
+		case CMD_STATUS:
+			return 8;
+		case CMD_READ_BLOCK:
+			return 9;
+		case CMD_WRITE_BLOCK:
+			return 11 + DeviceSimulator::BLOCK_SIZE;
+		case CMD_READ:
+		case CMD_WRITE:
+			return 11;
+		case CMD_CONTROL:
+			return 13;
+		default:
+			return 4;
+		}
+	}
+}
+
+DeviceSimulator &GetDeviceSimulator(void)
+{
+	static DeviceSimulator simulator;
+	return simulator;
+}
+
+DeviceSimulator::~DeviceSimulator() { stop(); }
+
+bool DeviceSimulator::add_volume_from_file(const std::string &filename, const bool write_protected)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		LogFileOutput("DeviceSimulator: unable to open volume image: %s\n", filename.c_str());
+		return false;
+	}
+	std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// 2IMG images carry a header giving the offset and length of the ProDOS ordered data
+	if (image.size() >= 64 && std::memcmp(image.data(), "2IMG", 4) == 0)
+	{
+		const uint32_t offset = image[0x18] | (image[0x19] << 8) | (image[0x1A] << 16) | ((uint32_t)image[0x1B] << 24);
+		uint64_t length = image[0x1C] | (image[0x1D] << 8) | (image[0x1E] << 16) | ((uint32_t)image[0x1F] << 24);
+		if (length == 0)	// some tools only set the ProDOS block count
+			length = (uint64_t)(image[0x14] | (image[0x15] << 8) | (image[0x16] << 16) | ((uint32_t)image[0x17] << 24)) * BLOCK_SIZE;
+		if (offset > image.size() || length > image.size() - offset)
+		{
+			LogFileOutput("DeviceSimulator: bad 2IMG header in: %s\n", filename.c_str());
+			return false;
+		}
+		image = std::vector<uint8_t>(image.begin() + offset, image.begin() + offset + length);
+	}
+
+	if (image.empty() || image.size() % BLOCK_SIZE != 0 || image.size() / BLOCK_SIZE > 0xFFFFFF)
+	{
+		LogFileOutput("DeviceSimulator: not a ProDOS ordered block image: %s\n", filename.c_str());
+		return false;
+	}
+
+	std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+	name = name.substr(0, name.find_last_of('.'));
+	add_volume(name, std::move(image), write_protected);
+	return true;
+}
+
+void DeviceSimulator::add_volume(const std::string &name, std::vector<uint8_t> blocks, const bool write_protected)
+{
+	Device device;
+	device.type = DeviceType::Block;
+	device.name = name;
+	device.blocks = std::move(blocks);
+	device.write_protected = write_protected;
+	devices_.push_back(std::move(device));
+}
+
+void DeviceSimulator::add_char_device()
+{
+	Device device;
+	device.type = DeviceType::Char;
+	device.name = "SIMSERIAL";
+	devices_.push_back(std::move(device));
+}
+
+void DeviceSimulator::add_network_device()
+{
+	Device device;
+	device.type = DeviceType::Network;
+	device.name = "SIMNETWORK";
+	devices_.push_back(std::move(device));
+}
+
+void DeviceSimulator::set_idle_callback(const unsigned int idle_seconds, std::function<void()> on_idle)
+{
+	idle_seconds_ = idle_seconds;
+	on_idle_ = std::move(on_idle);
+}
+
+bool DeviceSimulator::start(const std::string &ip_address, const uint16_t port)
+{
+	stop();
+	if (devices_.empty())
+		return false;
+
+#ifdef WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+	{
+		LogFileOutput("DeviceSimulator: WSAStartup failed: %d\n", WSAGetLastError());
+		return false;
+	}
+#endif
+
+	// A Listener bound to all interfaces is reached over the loopback interface
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	inet_pton(AF_INET, ip_address == "0.0.0.0" ? "127.0.0.1" : ip_address.c_str(), &address.sin_addr);
+
+	for (int attempt = 0; attempt < CONNECT_ATTEMPTS && socket_ == -1; attempt++)
+	{
+		const auto s = socket(AF_INET, SOCK_STREAM, 0);
+		if (s == INVALID_SOCKET)
+			break;
+		if (connect(s, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+		{
+			socket_ = static_cast<int>(s);
+			break;
+		}
+		CLOSE_SOCKET(s);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	if (socket_ == -1)
+	{
+		LogFileOutput("DeviceSimulator: unable to connect to listener on port %d, error code: %d\n", port, SOCKET_ERROR_CODE);
+#ifdef WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	// Every request is a small write waiting on its response, so don't let Nagle hold them back
+#ifdef WIN32
+	const char no_delay = 1;
+	const DWORD timeout = RECEIVE_TIMEOUT_MS;
+	setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+#else
+	const int no_delay = 1;
+	const timeval timeout = {0, RECEIVE_TIMEOUT_MS * 1000};
+	setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+	setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+	slip_decoder_.reset();
+	requests_ = 0;
+	last_request_ = std::chrono::steady_clock::now();
+	is_running_ = true;
+	simulator_thread_ = std::thread(&DeviceSimulator::simulator_function, this);
+	LogFileOutput("DeviceSimulator: started with %d devices\n", static_cast<int>(devices_.size()));
+	return true;
+}
+
+void DeviceSimulator::stop()
+{
+	is_running_ = false;
+	if (simulator_thread_.joinable())
+		simulator_thread_.join();
+
+	if (socket_ != -1)
+	{
+		SHUTDOWN_SOCKET(socket_);
+		CLOSE_SOCKET(socket_);
+		socket_ = -1;
+		LogFileOutput("DeviceSimulator: stopped, %llu requests, %llu blocks read, %llu blocks written\n",
+			static_cast<unsigned long long>(requests_), static_cast<unsigned long long>(blocks_read_), static_cast<unsigned long long>(blocks_written_));
+#ifdef WIN32
+		WSACleanup();
+#endif
+	}
+}
+
+void DeviceSimulator::simulator_function()
+{
+	std::vector<uint8_t> buffer(16 * 1024);
+	bool idle_reported = false;
+
+	while (is_running_)
+	{
+		const int bytes_read = recv(socket_, reinterpret_cast<char *>(buffer.data()), static_cast<int>(buffer.size()), 0);
+		if (bytes_read > 0)
+		{
+			slip_decoder_.feed(buffer.data(), bytes_read, [this](std::vector<uint8_t> &&packet) {
+				const auto response = handle_packet(packet);
+				slip_decoder_.recycle(std::move(packet));
+				if (!response.empty())
+				{
+					const auto slip_data = SLIP::encode(response);
+					send(socket_, reinterpret_cast<const char *>(slip_data.data()), static_cast<int>(slip_data.size()), 0);
+				}
+			});
+			last_request_ = std::chrono::steady_clock::now();
+			continue;
+		}
+
+		if (bytes_read == 0)
+		{
+			LogFileOutput("DeviceSimulator: listener closed the connection\n");
+			break;
+		}
+
+#ifdef WIN32
+		const bool timed_out = WSAGetLastError() == WSAETIMEDOUT;
+#else
+		const bool timed_out = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+		if (!timed_out)
+		{
+			LogFileOutput("DeviceSimulator: receive failed, error code: %d\n", SOCKET_ERROR_CODE);
+			break;
+		}
+
+		if (on_idle_ && !idle_reported && blocks_read_ > 0 && std::chrono::steady_clock::now() - last_request_ >= std::chrono::seconds(idle_seconds_))
+		{
+			LogFileOutput("DeviceSimulator: idle for %d seconds\n", idle_seconds_);
+			idle_reported = true;
+			on_idle_();
+		}
+	}
+	is_running_ = false;
+}
+
+std::vector<uint8_t> DeviceSimulator::handle_packet(const std::vector<uint8_t> &packet)
+{
+	if (packet.size() < 4 || packet.size() < minimum_packet_size(packet[1]))
+	{
+		LogFileOutput("DeviceSimulator: dropping short packet, %d bytes\n", static_cast<int>(packet.size()));
+		return {};
+	}
+
+	std::unique_ptr<Request> request;
+	try
+	{
+		request = Request::from_packet(packet);
+	}
+	catch (const std::exception &)
+	{
+		LogFileOutput("DeviceSimulator: unknown command %d\n", packet[1]);
+		return {};
+	}
+
+	requests_++;
+	return handle_request(*request);
+}
+
+std::vector<uint8_t> DeviceSimulator::handle_request(const Request &request)
+{
+	const uint8_t device_id = request.get_device_id();
+	const uint8_t command = request.get_command_number();
+
+	// The Listener scans with INIT from device 1 upwards until a non-zero status marks the last device
+	if (command == CMD_INIT)
+	{
+		const uint8_t status = device_id >= devices_.size() ? SP_OFFLINE : SP_OK;
+		return request.create_response(device_id, status, nullptr, 0)->serialize();
+	}
+
+	if (device_id == 0 || device_id > devices_.size())
+		return request.create_response(device_id, SP_OFFLINE, nullptr, 0)->serialize();
+
+	Device &device = devices_[device_id - 1];
+	uint8_t status = SP_OK;
+	std::vector<uint8_t> data;
+
+	switch (command)
+	{
+	case CMD_STATUS:
+		return handle_status(request, device);
+
+	case CMD_READ_BLOCK: {
+		const uint32_t block = get_uint24(static_cast<const ReadBlockRequest &>(request).get_block_number());
+		if (device.type != DeviceType::Block)
+			status = SP_BAD_CMD;
+		else if (block >= device.blocks.size() / BLOCK_SIZE)
+			status = SP_BAD_BLOCK;
+		else
+		{
+			data.assign(device.blocks.begin() + block * BLOCK_SIZE, device.blocks.begin() + (block + 1) * BLOCK_SIZE);
+			blocks_read_++;
+		}
+		break;
+	}
+
+	case CMD_WRITE_BLOCK: {
+		const auto &write_block = static_cast<const WriteBlockRequest &>(request);
+		const uint32_t block = get_uint24(write_block.get_block_number());
+		if (device.type != DeviceType::Block)
+			status = SP_BAD_CMD;
+		else if (device.write_protected)
+			status = SP_NO_WRITE;
+		else if (block >= device.blocks.size() / BLOCK_SIZE)
+			status = SP_BAD_BLOCK;
+		else
+		{
+			std::copy(write_block.get_block_data().begin(), write_block.get_block_data().end(), device.blocks.begin() + block * BLOCK_SIZE);
+			blocks_written_++;
+		}
+		break;
+	}
+
+	case CMD_FORMAT:
+		if (device.type != DeviceType::Block)
+			status = SP_BAD_CMD;
+		else if (device.write_protected)
+			status = SP_NO_WRITE;
+		else
+			std::fill(device.blocks.begin(), device.blocks.end(), 0);
+		break;
+
+	case CMD_CONTROL:
+		break;
+
+	case CMD_OPEN:
+		device.is_open = true;
+		break;
+
+	case CMD_CLOSE:
+		device.is_open = false;
+		device.packets.clear();
+		break;
+
+	case CMD_READ: {
+		const uint16_t byte_count = get_uint16(static_cast<const ReadRequest &>(request).get_byte_count());
+		if (device.type == DeviceType::Char)
+		{
+			const size_t count = std::min<size_t>(byte_count, device.char_buffer.size());
+			data.assign(device.char_buffer.begin(), device.char_buffer.begin() + count);
+			device.char_buffer.erase(device.char_buffer.begin(), device.char_buffer.begin() + count);
+		}
+		else if (device.type == DeviceType::Network)
+		{
+			if (!device.is_open)
+				status = SP_IO_ERROR;
+			else if (!device.packets.empty())
+			{
+				data = std::move(device.packets.front());
+				device.packets.pop_front();
+				if (data.size() > byte_count)
+					data.resize(byte_count);
+			}
+		}
+		else
+		{
+			status = SP_BAD_CMD;
+		}
+		break;
+	}
+
+	case CMD_WRITE: {
+		const auto &write = static_cast<const WriteRequest &>(request);
+		if (device.type == DeviceType::Char)
+			device.char_buffer.insert(device.char_buffer.end(), write.get_data().begin(), write.get_data().end());
+		else if (device.type == DeviceType::Network && device.is_open)
+			device.packets.push_back(write.get_data());
+		else
+			status = device.type == DeviceType::Network ? SP_IO_ERROR : SP_BAD_CMD;
+		break;
+	}
+
+	default:
+		status = SP_BAD_CMD;
+		break;
+	}
+
+	return request.create_response(device_id, status, data.data(), static_cast<uint16_t>(data.size()))->serialize();
+}
+
+std::vector<uint8_t> DeviceSimulator::handle_status(const Request &request, Device &device)
+{
+	const uint8_t status_code = static_cast<const StatusRequest &>(request).get_status_code();
+	const bool is_block = device.type == DeviceType::Block;
+	const uint32_t block_count = is_block ? static_cast<uint32_t>(device.blocks.size() / BLOCK_SIZE) : 0;
+	const uint8_t dib_status = is_block ? (device.write_protected ? DIB_STATUS_BLOCK_WP : DIB_STATUS_BLOCK) : DIB_STATUS_CHAR;
+
+	std::vector<uint8_t> data;
+	switch (status_code)
+	{
+	case 0x00: // general status
+		data = {dib_status, static_cast<uint8_t>(block_count), static_cast<uint8_t>(block_count >> 8), static_cast<uint8_t>(block_count >> 16)};
+		break;
+
+	case 0x03: { // device information block
+		data = {dib_status, static_cast<uint8_t>(block_count), static_cast<uint8_t>(block_count >> 8), static_cast<uint8_t>(block_count >> 16)};
+		std::string name = device.name;
+		std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) { return static_cast<char>(std::toupper(c)); });
+		name.resize(std::min<size_t>(name.size(), 16));
+		data.push_back(static_cast<uint8_t>(name.size()));
+		name.resize(16, ' ');
+		data.insert(data.end(), name.begin(), name.end());
+		data.push_back(is_block ? DIB_TYPE_HARDDISK : device.type == DeviceType::Char ? DIB_TYPE_CHAR : DIB_TYPE_NETWORK);
+		data.push_back(0x00); // subtype
+		data.push_back(0x01); // version 1.0
+		data.push_back(0x00);
+		break;
+	}
+
+	case 'S': // network status: bytes waiting, connected, error
+		if (device.type != DeviceType::Network)
+			return request.create_response(request.get_device_id(), SP_BAD_CTL, nullptr, 0)->serialize();
+		{
+			const size_t waiting = device.packets.empty() ? 0 : device.packets.front().size();
+			data = {static_cast<uint8_t>(waiting), static_cast<uint8_t>(waiting >> 8), static_cast<uint8_t>(device.is_open ? 1 : 0), 0x00};
+		}
+		break;
+
+	default:
+		return request.create_response(request.get_device_id(), SP_BAD_CTL, nullptr, 0)->serialize();
+	}
+
+	return request.create_response(request.get_device_id(), SP_OK, data.data(), static_cast<uint16_t>(data.size()))->serialize();
+}
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+#if defined(DEV_RELAY_SLIP) && defined(SLIP_PROTOCOL_NET)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../slip/SLIP.h"
+
+class Request;
+
+// A stand-in SmartPort device for benchmarking and testing without hardware. It connects to the Listener over
+// localhost like any other devrelay device, and answers requests from in-memory devices: block volumes (loaded from
+// .po/.hdv/.2mg images, or created blank), a character loopback device and a network loopback device.
+// Changes to volumes are never written back to the image files.
+class DeviceSimulator
+{
+public:
+	DeviceSimulator() = default;
+	~DeviceSimulator();
+
+	// Devices must be added before start(), volumes first so ProDOS finds them as its two drives
+	bool add_volume_from_file(const std::string &filename, bool write_protected = false);
+	void add_volume(const std::string &name, std::vector<uint8_t> blocks, bool write_protected = false);
+	void add_char_device();
+	void add_network_device();
+	size_t get_device_count() const { return devices_.size(); }
+
+	// Called once from the simulator thread when blocks have been served, and no requests have arrived for idle_seconds
+	void set_idle_callback(unsigned int idle_seconds, std::function<void()> on_idle);
+
+	bool start(const std::string &ip_address, uint16_t port);
+	void stop();
+	bool is_running() const { return is_running_; }
+
+	uint64_t get_blocks_read() const { return blocks_read_; }
+	uint64_t get_blocks_written() const { return blocks_written_; }
+
+	// Builds the serialized response the device sends back for a request packet, empty if the packet is not understood
+	std::vector<uint8_t> handle_packet(const std::vector<uint8_t> &packet);
+
+	static constexpr uint16_t BLOCK_SIZE = 512;
+
+private:
+	enum class DeviceType
+	{
+		Block,
+		Char,
+		Network
+	};
+
+	struct Device
+	{
+		DeviceType type;
+		std::string name;
+		std::vector<uint8_t> blocks;			 // Block: the volume, BLOCK_SIZE bytes per block
+		bool write_protected = false;
+		bool is_open = false;
+		std::vector<uint8_t> char_buffer;		 // Char: bytes written, waiting to be read back
+		std::deque<std::vector<uint8_t>> packets; // Network: packets written, waiting to be read back
+	};
+
+	std::vector<uint8_t> handle_request(const Request &request);
+	std::vector<uint8_t> handle_status(const Request &request, Device &device);
+	void simulator_function();
+
+	std::vector<Device> devices_;
+	int socket_ = -1;
+	std::thread simulator_thread_;
+	std::atomic<bool> is_running_{false};
+	SLIPDecoder slip_decoder_;
+
+	unsigned int idle_seconds_ = 0;
+	std::function<void()> on_idle_;
+	std::chrono::steady_clock::time_point last_request_;
+
+	std::atomic<uint64_t> blocks_read_{0};
+	std::atomic<uint64_t> blocks_written_{0};
+	uint64_t requests_ = 0;
+};
+
+extern class DeviceSimulator &GetDeviceSimulator(void);
+
+#endif
@@ -13,6 +13,7 @@
 #include "../slip/SLIP.h"
 
 #include "Log.h"
+#include "Reactor.h"
 #include "Requestor.h"
 #include "TCPConnection.h"
 
@@ -43,7 +44,11 @@ Listener &GetCommandListener(void)
 	return listener;
 }
 
-Listener::Listener() : is_listening_(false) {}
+Listener::Listener() : is_listening_(false)
+{
+	// Statics are destroyed in reverse order of construction, and stop() closes connections through the Reactor, so it must outlive us
+	GetReactor();
+}
 
 void Listener::Initialize(std::string ip_address, const uint16_t port, const uint16_t response_timeout)
 {
@@ -111,6 +116,22 @@ void Listener::listener_function()
 		return;
 	}
 
+	if (port_ == 0)
+	{
+#ifdef WIN32
+		if (getsockname(server_fd, reinterpret_cast<SOCKADDR *>(&address), &address_length) == SOCKET_ERROR)
+#else
+		if (getsockname(server_fd, (struct sockaddr *)&address, &address_length) == SOCKET_ERROR)
+#endif
+		{
+			LogFileOutput("Listener::listener_function - getsockname failed\n");
+			return;
+		}
+		port_ = ntohs(address.sin_port);
+		address_length = sizeof(address);
+		LogFileOutput("Listener::listener_function - listening on port %d\n", port_.load());
+	}
+
 	if (listen(server_fd, 3) < 0)
 	{
 		LogFileOutput("Listener::listener_function - listen failed\n");
@@ -195,7 +216,7 @@ void Listener::create_connection(unsigned int socket)
 	while (still_scanning && connection_info_map_.size() < 254)
 	{
 		LogFileOutput("SmartPortOverSlip listener sending request for device_id: %d\n", device_id);
-		InitRequest request(Requestor::next_request_number(), 1, device_id);
+		InitRequest request(Requestor::next_request_number(conn.get()), 1, device_id);
 		const auto response = Requestor::send_request(request, conn.get());
 		const auto init_response = dynamic_cast<InitResponse *>(response.get());
 		if (init_response == nullptr)
@@ -294,7 +315,7 @@ std::pair<int, int> Listener::first_two_disk_devices(std::function<bool(const st
 		const uint8_t unit_number = id_and_connection.first;
 
 		// DIB request to get information block. We need the device id the target understands here, not the unit_number from the ids maintained by host
-		const StatusRequest request(Requestor::next_request_number(), 3, id_and_connection.first, 3, 0); // no network unit here
+		const StatusRequest request(Requestor::next_request_number(id_and_connection.second), 3, id_and_connection.first, 3, 0); // no network unit here
 
 		std::unique_ptr<Response> response = Requestor::send_request(request, id_and_connection.second);
 
@@ -1,6 +1,7 @@
 #pragma once
 #if defined(DEV_RELAY_SLIP) && defined(SLIP_PROTOCOL_NET)
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -17,7 +18,7 @@ class Listener
 {
 private:
 	std::string ip_address_;
-	uint16_t port_;
+	std::atomic<uint16_t> port_;	// 0 to listen on any free port, then set to the port chosen once listening
 	uint16_t response_timeout_;
 	std::thread listening_thread_;
 
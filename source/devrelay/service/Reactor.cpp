@@ -0,0 +1,211 @@
+#if defined(DEV_RELAY_SLIP) && defined(SLIP_PROTOCOL_NET)
+
+#include <chrono>
+#include <cstring>
+
+#include "Reactor.h"
+
+#include "Listener.h"
+#include "Log.h"
+
+#ifdef WIN32
+	#include <winsock2.h>
+	#define POLL_SOCKETS WSAPoll
+	#define SOCKET_ERROR_CODE WSAGetLastError()
+	#define SOCKET_INTERRUPTED WSAEINTR
+#else
+	#include <errno.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	#define POLL_SOCKETS poll
+	#define SOCKET_ERROR_CODE errno
+	#define SOCKET_INTERRUPTED EINTR
+#endif
+
+#ifdef __linux__
+	#include <sys/epoll.h>
+#endif
+
+// How often the I/O thread wakes up without any traffic, to notice stop() and (for poll) newly added sockets
+static constexpr int POLL_TIMEOUT_MS = 20;
+static constexpr size_t READ_BUFFER_SIZE = 16384;
+static constexpr int MAX_EVENTS = 64;
+
+Reactor &GetReactor(void)
+{
+	static Reactor reactor;
+	return reactor;
+}
+
+Reactor::Reactor() : buffer_(READ_BUFFER_SIZE) {}
+
+Reactor::~Reactor() { stop(); }
+
+void Reactor::start()
+{
+	if (is_running_)
+		return;
+
+#ifdef __linux__
+	epoll_fd_ = epoll_create1(0);
+	if (epoll_fd_ < 0)
+	{
+		LogFileOutput("Reactor::start - epoll_create1 failed, errno: %d\n", errno);
+		return;
+	}
+#endif
+
+	is_running_ = true;
+	reactor_thread_ = std::thread(&Reactor::reactor_function, this);
+	LogFileOutput("Reactor::start - I/O thread running\n");
+}
+
+void Reactor::stop()
+{
+	if (!is_running_)
+		return;
+
+	is_running_ = false;
+	if (reactor_thread_.joinable())
+		reactor_thread_.join();
+
+#ifdef __linux__
+	close(epoll_fd_);
+	epoll_fd_ = -1;
+#endif
+}
+
+void Reactor::add(const int socket, const std::shared_ptr<Connection> &connection)
+{
+	std::lock_guard<std::mutex> lock(connections_mutex_);
+	start();
+	connections_[socket] = connection;
+
+#ifdef __linux__
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = socket;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) < 0)
+	{
+		LogFileOutput("Reactor::add - epoll_ctl failed for socket %d, errno: %d\n", socket, errno);
+	}
+#endif
+}
+
+// Stops servicing the socket; the caller is then free to close it
+void Reactor::remove(const int socket)
+{
+	std::lock_guard<std::mutex> lock(connections_mutex_);
+	drop(socket);
+}
+
+size_t Reactor::get_connection_count()
+{
+	std::lock_guard<std::mutex> lock(connections_mutex_);
+	return connections_.size();
+}
+
+// connections_mutex_ must be held
+void Reactor::drop(const int socket)
+{
+	if (connections_.erase(socket) == 0)
+		return;
+
+#ifdef __linux__
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+#endif
+}
+
+void Reactor::reactor_function()
+{
+#ifdef __linux__
+	epoll_event events[MAX_EVENTS];
+#else
+	std::vector<pollfd> fds;
+#endif
+
+	while (is_running_)
+	{
+#ifdef __linux__
+		const int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, POLL_TIMEOUT_MS);
+		for (int i = 0; i < count; i++)
+		{
+			dispatch(events[i].data.fd);
+		}
+#else
+		// poll has no registration, so the set is rebuilt each time round (WSAPoll rejects POLLIN, as it includes POLLRDBAND)
+		fds.clear();
+		{
+			std::lock_guard<std::mutex> lock(connections_mutex_);
+			for (const auto &socket_and_connection : connections_)
+			{
+				pollfd fd{};
+				fd.fd = socket_and_connection.first;
+				fd.events = POLLRDNORM;
+				fds.push_back(fd);
+			}
+		}
+
+		if (fds.empty())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_TIMEOUT_MS));
+			continue;
+		}
+
+		const int count = POLL_SOCKETS(fds.data(), static_cast<unsigned long>(fds.size()), POLL_TIMEOUT_MS);
+		if (count <= 0)
+			continue;
+
+		for (const auto &fd : fds)
+		{
+			if (fd.revents & (POLLRDNORM | POLLHUP | POLLERR))
+			{
+				dispatch(static_cast<int>(fd.fd));
+			}
+		}
+#endif
+	}
+}
+
+// The socket is readable: one recv(), then hand the bytes to the connection's SLIP decoder.
+// Level-triggered, so anything left over is reported again on the next wait.
+void Reactor::dispatch(const int socket)
+{
+	std::shared_ptr<Connection> connection;
+	{
+		std::lock_guard<std::mutex> lock(connections_mutex_);
+		const auto it = connections_.find(socket);
+		if (it == connections_.end())
+			return;
+		connection = it->second;
+	}
+
+	const int valread = recv(socket, reinterpret_cast<char *>(buffer_.data()), static_cast<int>(buffer_.size()), 0);
+	if (valread > 0)
+	{
+		connection->receive_data(buffer_.data(), valread);
+		return;
+	}
+
+	if (valread < 0)
+	{
+		const int error_code = SOCKET_ERROR_CODE;
+		if (error_code == SOCKET_INTERRUPTED)
+			return;
+		LogFileOutput("Reactor: error reading socket %d, error code: %d\n", socket, error_code);
+	}
+	else
+	{
+		LogFileOutput("Reactor: recv == 0 on socket %d, disconnecting\n", socket);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(connections_mutex_);
+		drop(socket);
+	}
+	connection->set_is_connected(false);
+	GetCommandListener().connection_closed(connection.get());
+}
+
+#endif
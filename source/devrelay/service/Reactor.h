@@ -0,0 +1,49 @@
+#pragma once
+#if defined(DEV_RELAY_SLIP) && defined(SLIP_PROTOCOL_NET)
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Connection.h"
+
+// A single I/O thread servicing the sockets of every network Connection, instead of a reading thread per connection.
+// Uses epoll on Linux, and poll (WSAPoll on Windows) elsewhere. Incoming bytes are handed to the owning Connection,
+// which decodes them into its response slots; a closed or failed socket is reported to the Listener.
+class Reactor
+{
+public:
+	Reactor();
+	~Reactor();
+
+	void add(int socket, const std::shared_ptr<Connection> &connection);
+	void remove(int socket);
+
+	size_t get_connection_count();
+
+private:
+	void start();
+	void stop();
+	void reactor_function();
+	void dispatch(int socket);
+	void drop(int socket);
+
+	std::mutex connections_mutex_;
+	std::map<int, std::shared_ptr<Connection>> connections_;
+
+	std::thread reactor_thread_;
+	std::atomic<bool> is_running_{false};
+	std::vector<uint8_t> buffer_;
+
+#ifdef __linux__
+	int epoll_fd_ = -1;
+#endif
+};
+
+extern class Reactor &GetReactor(void);
+
+#endif
@@ -11,26 +11,52 @@ Requestor::Requestor() = default;
 
 std::unique_ptr<Response> Requestor::send_request(const Request &request, Connection *connection)
 {
+	send_request_async(request, connection);
+	return receive_response(request, connection);
+}
+
+void Requestor::send_request_async(const Request &request, Connection *connection)
+{
+	// Request numbers wrap at 256, so clear out any late response to an abandoned request that used this number
+	connection->discard_response(request.get_request_sequence_number());
+
 	// Send the serialized request
 	connection->send_data(request.serialize());
+}
 
+std::unique_ptr<Response> Requestor::receive_response(const Request &request, Connection *connection)
+{
 	std::optional<std::vector<uint8_t>> response_data = connection->wait_for_response(request.get_request_sequence_number(), std::chrono::seconds(GetCommandListener().get_response_timeout()));
 	if (!response_data)
 	{
 		std::cerr << "Requestor::send_request timeout waiting for response" << std::endl;
+		abandon_request(request, connection);
 		return nullptr;
 	}
 
 	// Deserialize the response data into a Response object.
 	// Each Request type (e.g. StatusRequest) is able to deserialize into its twin Response (e.g. StatusResponse).
-	return request.deserialize(*response_data);
+	auto response = request.deserialize(*response_data);
+	connection->recycle_buffer(std::move(*response_data));
+	return response;
 }
 
-uint8_t Requestor::next_request_number()
+void Requestor::abandon_request(const Request &request, Connection *connection)
 {
-	const uint8_t current_number = request_number_;
-	request_number_ = (request_number_ + 1) % 256;
-	return current_number;
+	connection->abandon_response(request.get_request_sequence_number(), std::chrono::seconds(GetCommandListener().get_response_timeout()));
+}
+
+uint8_t Requestor::next_request_number(Connection *connection)
+{
+	// If every number is abandoned (e.g. the device has stopped responding) then just use the next one
+	for (int i = 0; i < 256; i++)
+	{
+		const uint8_t current_number = request_number_;
+		request_number_ = (request_number_ + 1) % 256;
+		if (connection == nullptr || !connection->is_abandoned(current_number))
+			return current_number;
+	}
+	return request_number_++;
 }
 
 #endif
@@ -13,7 +13,15 @@ public:
 
 	// The Request's deserialize function will always return a Response, e.g. StatusRequest -> StatusResponse
 	static std::unique_ptr<Response> send_request(const Request &request, Connection *connection);
-	static uint8_t next_request_number();
+
+	// Pipelined form of send_request: send_request_async() returns as soon as the request is written,
+	// and receive_response() later waits for (or immediately picks up) the matching Response.
+	static void send_request_async(const Request &request, Connection *connection);
+	static std::unique_ptr<Response> receive_response(const Request &request, Connection *connection);
+	static void abandon_request(const Request &request, Connection *connection);
+
+	// Pass the connection the request is for, so that numbers of abandoned requests still awaiting a response are skipped
+	static uint8_t next_request_number(Connection *connection = nullptr);
 
 private:
 	static uint8_t request_number_;
@@ -97,53 +97,54 @@ std::vector<uint8_t> SLIP::decode(const std::vector<uint8_t> &data)
 }
 
 // This breaks up a vector of data into a list of decoded vectors of serialized objects.
-// The returned data is already "SLIP::decode"d
+// The returned data is already "SLIP::decode"d. Any trailing partial frame is discarded, use SLIPDecoder for a stream.
 std::vector<std::vector<uint8_t>> SLIP::split_into_packets(const uint8_t *data, size_t bytes_read)
 {
-	// The list of decoded SLIP packets
 	std::vector<std::vector<uint8_t>> decoded_packets;
+	SLIPDecoder decoder;
+	decoder.feed(data, bytes_read, [&decoded_packets](std::vector<uint8_t> &&packet) { decoded_packets.push_back(std::move(packet)); });
+	return decoded_packets;
+}
 
-	enum class State
-	{
-		NotParsing,
-		Parsing
-	} state = State::NotParsing;
+void SLIPDecoder::reset()
+{
+	state_ = State::Idle;
+	frame_.clear();
+}
 
-	// Iterate over the data and find the SLIP packet boundaries
-	size_t i = 0;
-	const uint8_t *packet_start = nullptr; // Keep track of where the packet starts
-	while (i < bytes_read)
+void SLIPDecoder::recycle(std::vector<uint8_t> &&buffer)
+{
+	std::lock_guard<std::mutex> lock(pool_mutex_);
+	if (pool_.size() < MAX_POOLED_BUFFERS && buffer.capacity() > 0)
 	{
-		switch (state)
-		{
-		case State::NotParsing:
-			// If we are not yet parsing and see a SLIP_END byte (which also marks start), start parsing a new SLIP packet
-			if (data[i] == SLIP_END)
-			{
-				state = State::Parsing;
-				packet_start = data + i; // Mark the start of the packet
-			}
-			break;
-		case State::Parsing:
-			// If we see another SLIP_END byte, we have reached the end of the SLIP packet
-			if (data[i] == SLIP_END)
-			{
-				// Extract the SLIP packet data
-				std::vector<uint8_t> slip_packet_data(packet_start, data + i + 1); // Include all bytes in the packet
+		buffer.clear();
+		pool_.push_back(std::move(buffer));
+	}
+}
 
-				// Add the data to the list of SLIP decoded packets
-				decoded_packets.push_back(SLIP::decode(slip_packet_data));
+// A bad escape sequence or an oversized frame loses only that frame
+void SLIPDecoder::drop_frame(const bool at_end)
+{
+	dropped_frames_++;
+	frame_.clear();
+	state_ = at_end ? State::Frame : State::Discard;
+}
 
-				// Transition back to the NotParsing state
-				state = State::NotParsing;
-			}
-			break;
+std::vector<uint8_t> SLIPDecoder::take_buffer()
+{
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex_);
+		if (!pool_.empty())
+		{
+			std::vector<uint8_t> buffer = std::move(pool_.back());
+			pool_.pop_back();
+			return buffer;
 		}
-		i++;
 	}
 
-	return decoded_packets;
+	std::vector<uint8_t> buffer;
+	buffer.reserve(INITIAL_BUFFER_SIZE);
+	return buffer;
 }
 
-
 #endif
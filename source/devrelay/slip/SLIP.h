@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <mutex>
 #include <stdint.h>
+#include <utility>
 #include <vector>
 
 #define SLIP_END 0300	  /* indicates end of packet */
@@ -17,3 +19,105 @@ public:
 	static std::vector<uint8_t> decode(const std::vector<uint8_t> &data);
 	static std::vector<std::vector<uint8_t>> split_into_packets(const uint8_t *data, size_t bytes_read);
 };
+
+// Incremental decoder for a SLIP byte stream. State is kept between calls to feed(), so a frame that arrives split
+// across several reads is reassembled instead of being lost. Each decoded frame is moved out in its own buffer, taken
+// from a small pool that the consumer can refill with recycle() once it has finished with the data.
+class SLIPDecoder
+{
+public:
+	static constexpr size_t MAX_FRAME_SIZE = 0x10000; // larger frames are dropped, the stream resyncs on the next END
+	static constexpr size_t MAX_POOLED_BUFFERS = 16;
+	static constexpr size_t INITIAL_BUFFER_SIZE = 600; // a block response, plus some headroom
+
+	// Decodes length bytes, calling on_packet(std::vector<uint8_t> &&) for every complete, non-empty frame.
+	template <typename Func>
+	void feed(const uint8_t *data, const size_t length, Func on_packet)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			const uint8_t byte = data[i];
+			switch (state_)
+			{
+			case State::Idle:
+				// Anything before the first END is noise from a partial frame
+				if (byte == SLIP_END)
+					state_ = State::Frame;
+				break;
+			case State::Frame:
+				if (byte == SLIP_END)
+				{
+					// END closes this frame and opens the next one, empty frames (END END) are skipped
+					if (!frame_.empty())
+					{
+						on_packet(std::move(frame_));
+						frame_ = take_buffer();
+					}
+				}
+				else if (byte == SLIP_ESC)
+				{
+					state_ = State::Escape;
+				}
+				else
+				{
+					append(byte);
+				}
+				break;
+			case State::Escape:
+				if (byte == SLIP_ESC_END)
+				{
+					state_ = State::Frame;
+					append(SLIP_END);
+				}
+				else if (byte == SLIP_ESC_ESC)
+				{
+					state_ = State::Frame;
+					append(SLIP_ESC);
+				}
+				else
+				{
+					drop_frame(byte == SLIP_END);
+				}
+				break;
+			case State::Discard:
+				if (byte == SLIP_END)
+					state_ = State::Frame;
+				break;
+			}
+		}
+	}
+
+	void reset();
+	void recycle(std::vector<uint8_t> &&buffer);
+	size_t get_dropped_frames() const { return dropped_frames_; }
+
+private:
+	enum class State
+	{
+		Idle,
+		Frame,
+		Escape,
+		Discard
+	};
+
+	void append(const uint8_t byte)
+	{
+		if (frame_.size() >= MAX_FRAME_SIZE)
+		{
+			drop_frame(false);
+			return;
+		}
+		frame_.push_back(byte);
+	}
+
+	void drop_frame(bool at_end);
+	std::vector<uint8_t> take_buffer();
+
+	State state_ = State::Idle;
+	std::vector<uint8_t> frame_;
+	size_t dropped_frames_ = 0;
+
+	// recycle() is called by the consumer thread, feed() by the reading thread
+	std::mutex pool_mutex_;
+	std::vector<std::vector<uint8_t>> pool_;
+};
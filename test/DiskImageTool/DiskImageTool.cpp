@@ -0,0 +1,748 @@
+#include "stdafx.h"
+
+#include "../../source/Common.h"
+#include "../../source/Core.h"
+#include "../../source/CPU.h"
+#include "../../source/DiskImageHelper.h"
+#include "../../source/Interface.h"
+#include "../../source/Log.h"
+#include "../../source/Memory.h"
+
+#include "zlib.h"
+
+// Headless validation & conversion of a library of disk images, using the emulator's own image classes
+// (so an image that passes here is read exactly as AppleWin reads it).
+// . All images in the directories (recursively) & files on the command line are shared out between worker threads
+// . Validate: image CRC32 (and WOZ header CRC), 4&4 address field & 6&2 data field checksums of every track,
+//   and for .dsk/.po: the nibblize->denibblize round-trip of every sector
+// . Convert (-convert <ext> -out <dir>): 5.25" images to .dsk/.do/.po/.nib/.woz, 2IMG/HDV hard disk images to .po/.hdv (unwrapped).
+//   Each converted image is re-opened & its decoded data compared with the source's
+//
+// Output: one line per image, then the totals & throughput (images/s). Exit code is 1 if any image failed.
+
+// From AppleWin.cpp
+std::string g_VERSIONSTRING = "DiskImageTool";
+
+FrameBase& GetFrame(void)
+{
+	// Only used for the WOZ CRC mismatch prompt, which is disabled (see main())
+	throw std::runtime_error("GetFrame() isn't supported");
+}
+
+// From Memory.cpp (only used when booting .apl/.prg images)
+LPBYTE mem = NULL;
+LPBYTE memdirty = NULL;
+
+// From CPU.cpp
+regsrec regs;
+
+//-------------------------------------
+
+enum Status_e {STATUS_OK, STATUS_WARN, STATUS_FAIL, STATUS_SKIP, NUM_STATUS};
+static const char* const g_statusName[NUM_STATUS] = {"OK", "WARN", "FAIL", "SKIP"};
+
+struct Result_t
+{
+	Result_t() : status(STATUS_FAIL), type("?"), imageCrc(0), dataCrc(0) {}
+
+	Status_e status;
+	std::string type;
+	UINT32 imageCrc;		// of the image data, as stored
+	UINT32 dataCrc;			// of the decoded sectors (5.25") or blocks (HDD): independent of the image's format
+	std::string message;
+};
+
+struct Options_t
+{
+	Options_t() : numThreads(0) {}
+
+	std::string convertExt;	// eg. ".woz" (or empty to just validate)
+	std::string outDir;
+	UINT numThreads;
+};
+
+//-------------------------------------
+
+static std::string ToLower(std::string str)
+{
+	for (size_t i = 0; i < str.size(); i++)
+		str[i] = (char)tolower((unsigned char)str[i]);
+	return str;
+}
+
+static bool HasSuffix(const std::string& str, const char* pSuffix)
+{
+	const size_t len = strlen(pSuffix);
+	return str.size() > len && ToLower(str.substr(str.size() - len)) == pSuffix;
+}
+
+// NB. ".gz" is stripped first, eg. "game.dsk.gz" => ".dsk"
+static std::string GetLowerExt(std::string pathname)
+{
+	if (HasSuffix(pathname, GZ_SUFFIX))
+		pathname.resize(pathname.size() - GZ_SUFFIX_LEN);
+
+	const size_t dot = pathname.find_last_of('.');
+	const size_t slash = pathname.find_last_of("\\/");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return "";
+	return ToLower(pathname.substr(dot));
+}
+
+static bool IsImageFilename(const std::string& filename)
+{
+	if (HasSuffix(filename, GZ_SUFFIX) || HasSuffix(filename, ZIP_SUFFIX))
+		return true;
+
+	static const char* const kImageExts[] = {".dsk", ".do", ".po", ".nib", ".nb2", ".woz", ".2mg", ".2img", ".hdv", ".iie"};
+	const std::string ext = GetLowerExt(filename);
+	for (UINT i = 0; i < sizeof(kImageExts) / sizeof(kImageExts[0]); i++)
+	{
+		if (ext == kImageExts[i])
+			return true;
+	}
+	return false;
+}
+
+// eg. ("C:\\Images\\game.dsk.gz", "D:\\Out", ".woz") => "D:\\Out\\game.woz"
+static std::string GetOutputPathname(const std::string& pathname, const Options_t& options)
+{
+	std::string name = pathname.substr(pathname.find_last_of("\\/") + 1);	// NB. npos+1 == 0
+
+	if (HasSuffix(name, GZ_SUFFIX))
+		name.resize(name.size() - GZ_SUFFIX_LEN);
+	else if (HasSuffix(name, ZIP_SUFFIX))
+		name.resize(name.size() - ZIP_SUFFIX_LEN);
+
+	const size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos && dot > 0)
+		name.resize(dot);
+
+	return options.outDir + "\\" + name + options.convertExt;
+}
+
+static bool FileExists(const std::string& pathname)
+{
+	return GetFileAttributes(pathname.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+static void FindImages(const std::string& dir, std::vector<std::string>& pathnames)
+{
+	WIN32_FIND_DATA findData;
+	HANDLE hFind = FindFirstFile((dir + "\\*").c_str(), &findData);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		const std::string name = findData.cFileName;
+		if (name == "." || name == "..")
+			continue;
+
+		const std::string pathname = dir + "\\" + name;
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			FindImages(pathname, pathnames);
+		else if (IsImageFilename(name))
+			pathnames.push_back(pathname);
+	}
+	while (FindNextFile(hFind, &findData));
+
+	FindClose(hFind);
+}
+
+static const char* GetTypeName(const eImageType type)
+{
+	switch (type)
+	{
+	case eImageDO:		return "DO";
+	case eImagePO:		return "PO";
+	case eImageNIB1:	return "NIB";
+	case eImageNIB2:	return "NB2";
+	case eImageHDV:		return "HDV";
+	case eImageIIE:		return "IIE";
+	case eImageAPL:		return "APL";
+	case eImagePRG:		return "PRG";
+	case eImageWOZ1:	return "WOZ1";
+	case eImageWOZ2:	return "WOZ2";
+	default:			return "?";
+	}
+}
+
+//-------------------------------------
+
+// Check the 4&4 address field & 6&2 data field checksums of every sector in a track's nibbles (NB. the track wraps around)
+// Returns a bitmap of the good sectors, and the # of sectors with a bad checksum (or missing data field)
+static UINT16 CheckTrackChecksums(const BYTE* pNibbles, const int numNibbles, UINT& badSectors)
+{
+	struct Decode62Table
+	{
+		Decode62Table(void)
+		{
+			memset(value, 0xFF, sizeof(value));
+			const BYTE* pDiskByte = CImageBase::GetDiskByteTable();
+			for (BYTE i = 0; i < 0x40; i++)
+				value[pDiskByte[i]] = i;
+		}
+		BYTE value[0x100];	// 0xFF = invalid nibble
+	};
+	static const Decode62Table decode62;
+
+	const int kMaxGap2 = 64;	// nibbles between the address field's epilogue & the data field's prologue
+	const int kDataFieldNibbles = 342 + 1;	// 6&2 encoded data + checksum
+
+	UINT16 goodSectors = 0;
+	badSectors = 0;
+
+	if (numNibbles == 0)
+		return 0;
+
+#define NIB(n) pNibbles[(n) % numNibbles]
+
+	for (int i = 0; i < numNibbles; i++)
+	{
+		if (NIB(i) != 0xD5 || NIB(i+1) != 0xAA || NIB(i+2) != 0x96)
+			continue;
+
+		BYTE field[4];	// volume, track, sector, checksum
+		for (int j = 0; j < 4; j++)
+			field[j] = ((NIB(i+3+j*2) << 1) | 1) & NIB(i+4+j*2);
+
+		if ((field[0] ^ field[1] ^ field[2]) != field[3] || field[2] >= NUM_SECTORS)
+		{
+			badSectors++;
+			continue;
+		}
+
+		int data = i + 3 + 8;
+		const int dataEnd = data + kMaxGap2;
+		while (data < dataEnd && !(NIB(data) == 0xD5 && NIB(data+1) == 0xAA && NIB(data+2) == 0xAD))
+			data++;
+
+		if (data == dataEnd)
+		{
+			badSectors++;
+			continue;
+		}
+
+		// Each nibble is the XOR of adjacent 6-bit values, so XOR'ing all of them (inc. the checksum) gives 0
+		BYTE checksum = 0;
+		bool valid = true;
+		for (int j = 0; j < kDataFieldNibbles && valid; j++)
+		{
+			const BYTE value = decode62.value[NIB(data+3+j)];
+			valid = (value != 0xFF);
+			checksum ^= value;
+		}
+
+		if (!valid || checksum != 0)
+			badSectors++;
+		else
+			goodSectors |= 1 << field[2];
+	}
+
+#undef NIB
+
+	return goodSectors;
+}
+
+static UINT CountSectors(UINT16 sectors)
+{
+	UINT count = 0;
+	for (; sectors; sectors >>= 1)
+		count += sectors & 1;
+	return count;
+}
+
+//-------------------------------------
+
+// Each worker thread has its own image helpers, as CImageBase's work buffer isn't thread-safe
+class DiskImageWorker
+{
+public:
+	DiskImageWorker(const Options_t& options) : m_options(options) {}
+	~DiskImageWorker(void) {}
+
+	Result_t Process(const std::string& pathname);
+
+private:
+	ImageError_e OpenImage(CImageHelperBase& helper, ImageInfo& image, const std::string& pathname);
+	int GetTrackNibbles(ImageInfo& image, const UINT track);
+	void ValidateFloppy(ImageInfo& image, Result_t& result);
+	void ConvertFloppy(ImageInfo& src, Result_t& result);
+	void ValidateHardDisk(ImageInfo& image, Result_t& result, FILE* hOutFile);
+	void ConvertHardDisk(ImageInfo& src, Result_t& result);
+
+	const Options_t& m_options;
+	CDiskImageHelper m_diskImageHelper;
+	CHardDiskImageHelper m_hardDiskImageHelper;
+	std::vector<BYTE> m_trackBuffer;	// as read from the image (for WOZ: a bit-stream)
+	std::vector<BYTE> m_nibbles;
+};
+
+ImageError_e DiskImageWorker::OpenImage(CImageHelperBase& helper, ImageInfo& image, const std::string& pathname)
+{
+	image.bWriteProtected = true;	// never modify the source image
+	image.pImageHelper = &helper;
+
+	std::string filenameInZip;	// use the zip's first disk image
+	return helper.Open(pathname.c_str(), &image, false, filenameInZip);
+}
+
+// Returns the # of nibbles in m_nibbles
+// . WOZ tracks are bit-streams, so shift them through a disk latch (like the Disk II): the 1st revolution gets the latch in sync, and the 2nd revolution's nibbles are used
+int DiskImageWorker::GetTrackNibbles(ImageInfo& image, const UINT track)
+{
+	const UINT maxNibbles = MAX(NIBBLES_PER_TRACK, image.maxNibblesPerTrack);
+	if (m_trackBuffer.size() < maxNibbles)
+	{
+		m_trackBuffer.resize(maxNibbles);
+		m_nibbles.resize(maxNibbles);
+	}
+
+	int numNibbles = 0;
+	UINT bitCount = 0;
+	image.pImageType->Read(&image, (float)(track * 2), &m_trackBuffer[0], &numNibbles, &bitCount, true);
+
+	const eImageType type = image.pImageType->GetType();
+	if (type != eImageWOZ1 && type != eImageWOZ2)
+	{
+		memcpy(&m_nibbles[0], &m_trackBuffer[0], numNibbles);
+		return numNibbles;
+	}
+
+	if (bitCount == 0)
+		bitCount = numNibbles * 8;
+
+	int n = 0;
+	BYTE latch = 0;
+	for (UINT i = 0; i < bitCount * 2; i++)
+	{
+		const UINT bit = i % bitCount;
+		latch = (latch << 1) | ((m_trackBuffer[bit >> 3] >> (7 - (bit & 7))) & 1);
+		if (latch & 0x80)
+		{
+			if (i >= bitCount && n < (int)maxNibbles)
+				m_nibbles[n++] = latch;
+			latch = 0;
+		}
+	}
+
+	return n;
+}
+
+//===========================================================================
+
+Result_t DiskImageWorker::Process(const std::string& pathname)
+{
+	Result_t result;
+
+	ImageInfo image;
+	ImageError_e err = OpenImage(m_diskImageHelper, image, pathname);
+	if (err == eIMAGE_ERROR_NONE && image.pImageType && image.pImageType->GetType() != eImageHDV)
+	{
+		result.type = GetTypeName(image.pImageType->GetType());
+
+		if (!image.pImageType->AllowRW() || !image.uNumTracks)
+		{
+			result.status = STATUS_SKIP;
+			result.message = "not a disk image";
+		}
+		else
+		{
+			ValidateFloppy(image, result);
+			if (result.status != STATUS_FAIL && !m_options.convertExt.empty())
+				ConvertFloppy(image, result);
+		}
+
+		m_diskImageHelper.Close(&image);
+		return result;
+	}
+
+	m_diskImageHelper.Close(&image);
+
+	// Not a 5.25" image, so try as a hard disk image (eg. .hdv, or an 800KB or larger .2mg/.po)
+	ImageInfo hdd;
+	err = OpenImage(m_hardDiskImageHelper, hdd, pathname);
+	if (err != eIMAGE_ERROR_NONE || !hdd.pImageType)
+	{
+		m_hardDiskImageHelper.Close(&hdd);
+		result.message = StrFormat("unable to open (error=%d)", err);
+		return result;
+	}
+
+	result.type = GetTypeName(hdd.pImageType->GetType());
+	if (m_options.convertExt.empty())
+		ValidateHardDisk(hdd, result, NULL);
+	else
+		ConvertHardDisk(hdd, result);
+
+	m_hardDiskImageHelper.Close(&hdd);
+	return result;
+}
+
+//===========================================================================
+
+void DiskImageWorker::ValidateFloppy(ImageInfo& image, Result_t& result)
+{
+	CImageBase* pImageType = image.pImageType;
+	const eImageType type = pImageType->GetType();
+	const bool isWOZ = (type == eImageWOZ1 || type == eImageWOZ2);
+	const bool isSectorImage = (type == eImageDO || type == eImagePO);
+
+	// NB. For WOZ, the header CRC has already been checked by Open()
+	result.imageCrc = isWOZ ? crc32(0, image.pImageBuffer, image.uImageSize)
+							: crc32(0, image.pImageBuffer + image.uOffset, image.uImageSize);
+
+	// Denibblize every track into an in-memory DOS order image
+	// (NB. its hFile is INVALID_HANDLE_VALUE, so Write() just updates pImageBuffer)
+	DWORD size = 0;
+	ImageInfo scratch;
+	scratch.pImageHelper = &m_diskImageHelper;
+	scratch.pImageType = m_diskImageHelper.GetImageForCreation(".do", &size);
+	scratch.uNumTracks = image.uNumTracks;
+	scratch.uImageSize = image.uNumTracks * TRACK_DENIBBLIZED_SIZE;
+	scratch.pImageBuffer = new BYTE[scratch.uImageSize];
+	memset(scratch.pImageBuffer, 0, scratch.uImageSize);
+
+	UINT numSectors = 0, badSectors = 0, incompleteTracks = 0, mismatches = 0, numDataTracks = 0;
+
+	for (UINT track = 0; track < image.uNumTracks; track++)
+	{
+		const int numNibbles = GetTrackNibbles(image, track);
+
+		UINT bad = 0;
+		const UINT good = CountSectors(CheckTrackChecksums(&m_nibbles[0], numNibbles, bad));
+		if (good == 0 && bad == 0)
+			continue;	// unformatted (eg. WOZ track 35+)
+
+		numSectors += good;
+		badSectors += bad;
+		if (good != NUM_SECTORS || bad)
+			incompleteTracks++;
+		numDataTracks = track + 1;
+
+		scratch.pImageType->Write(&scratch, (float)(track * 2), &m_nibbles[0], numNibbles);
+
+		if (!isSectorImage)
+			continue;
+
+		for (UINT sector = 0; sector < NUM_SECTORS; sector++)
+		{
+			BYTE original[256], roundTrip[256];
+			pImageType->ReadPhysicalSector(&image, track, sector, original);
+			scratch.pImageType->ReadPhysicalSector(&scratch, track, sector, roundTrip);
+			if (memcmp(original, roundTrip, sizeof(original)) != 0)
+				mismatches++;
+		}
+	}
+
+	if (isSectorImage)
+		numDataTracks = image.uNumTracks;
+
+	result.dataCrc = crc32(0, scratch.pImageBuffer, numDataTracks * TRACK_DENIBBLIZED_SIZE);
+	m_diskImageHelper.Close(&scratch);
+
+	result.message = StrFormat("tracks=%u sectors=%u", numDataTracks, numSectors);
+
+	if (mismatches)
+	{
+		result.status = STATUS_FAIL;
+		result.message += StrFormat(": %u sectors don't round-trip", mismatches);
+	}
+	else if (badSectors || incompleteTracks)
+	{
+		result.status = STATUS_WARN;	// eg. copy-protected
+		result.message += StrFormat(": %u bad checksums, %u non-standard tracks", badSectors, incompleteTracks);
+	}
+	else
+	{
+		result.status = STATUS_OK;
+	}
+}
+
+void DiskImageWorker::ConvertFloppy(ImageInfo& src, Result_t& result)
+{
+	static const char* const kFloppyExts[] = {".dsk", ".do", ".po", ".nib", ".woz"};
+	bool supported = false;
+	for (UINT i = 0; i < sizeof(kFloppyExts) / sizeof(kFloppyExts[0]); i++)
+		supported |= (m_options.convertExt == kFloppyExts[i]);
+
+	if (!supported)
+	{
+		result.status = STATUS_FAIL;
+		result.message += StrFormat(": can't convert a 5.25\" image to %s", m_options.convertExt.c_str());
+		return;
+	}
+
+	const std::string outPathname = GetOutputPathname(src.szFilename, m_options);
+	if (FileExists(outPathname))
+	{
+		result.status = STATUS_FAIL;
+		result.message += ": " + outPathname + " already exists";
+		return;
+	}
+
+	if (m_options.convertExt == ".po")
+	{
+		// PO images aren't created by CDiskImageHelper, so create a blank one for it to open
+		std::vector<BYTE> blank(TRACKS_STANDARD * TRACK_DENIBBLIZED_SIZE, 0);
+		FILE* hFile = fopen(outPathname.c_str(), "wb");
+		const bool res = hFile && fwrite(&blank[0], 1, blank.size(), hFile) == blank.size();
+		if (hFile)
+			fclose(hFile);
+		if (!res)
+		{
+			result.status = STATUS_FAIL;
+			result.message += ": unable to create " + outPathname;
+			return;
+		}
+	}
+
+	ImageInfo dst;
+	dst.pImageHelper = &m_diskImageHelper;
+	std::string filenameInZip;
+	ImageError_e err = m_diskImageHelper.Open(outPathname.c_str(), &dst, true, filenameInZip);
+	if (err != eIMAGE_ERROR_NONE || !dst.pImageType || !dst.pImageType->AllowRW() || dst.bWriteProtected)
+	{
+		m_diskImageHelper.Close(&dst);
+		result.status = STATUS_FAIL;
+		result.message += StrFormat(": unable to create %s (error=%d)", outPathname.c_str(), err);
+		return;
+	}
+
+	const eImageType dstType = dst.pImageType->GetType();
+	const UINT numTracks = MIN(src.uNumTracks, dst.uNumTracks);
+
+	for (UINT track = 0; track < numTracks; track++)
+	{
+		int numNibbles = GetTrackNibbles(src, track);
+
+		UINT bad = 0;
+		if (CheckTrackChecksums(&m_nibbles[0], numNibbles, bad) == 0 && bad == 0)
+			continue;	// unformatted: leave blank
+
+		if (dstType == eImageNIB1)
+		{
+			// NIB tracks are a fixed length: pad with sync nibbles (or truncate)
+			if (numNibbles < NIBBLES_PER_TRACK_NIB)
+				memset(&m_nibbles[numNibbles], 0xFF, NIBBLES_PER_TRACK_NIB - numNibbles);
+			numNibbles = NIBBLES_PER_TRACK_NIB;
+		}
+
+		// As ImageWriteTrack()
+		dst.pImageType->Write(&dst, (float)(track * 2), &m_nibbles[0], numNibbles);
+		if (dstType == eImageWOZ1 || dstType == eImageWOZ2)
+		{
+			DWORD dummy;
+			m_diskImageHelper.WOZUpdateInfo(&dst, dummy);
+		}
+	}
+
+	m_diskImageHelper.Close(&dst);
+
+	// Verify: the converted image must decode to the same data
+	Result_t converted;
+	ImageInfo check;
+	err = OpenImage(m_diskImageHelper, check, outPathname);
+	if (err == eIMAGE_ERROR_NONE && check.pImageType && check.pImageType->AllowRW())
+		ValidateFloppy(check, converted);
+	m_diskImageHelper.Close(&check);
+
+	if (err != eIMAGE_ERROR_NONE || converted.status == STATUS_FAIL || converted.dataCrc != result.dataCrc)
+	{
+		result.status = STATUS_FAIL;
+		result.message += ": converted image " + outPathname + " doesn't match";
+		return;
+	}
+
+	result.message += " => " + outPathname;
+}
+
+//===========================================================================
+
+// Read every block (optionally copying them to hOutFile)
+void DiskImageWorker::ValidateHardDisk(ImageInfo& image, Result_t& result, FILE* hOutFile)
+{
+	const UINT numBlocks = image.uImageSize / HD_BLOCK_SIZE;
+	uLong crc = crc32(0, NULL, 0);
+
+	for (UINT block = 0; block < numBlocks; block++)
+	{
+		BYTE buffer[HD_BLOCK_SIZE];
+		if (!image.pImageType->Read(&image, block, buffer))
+		{
+			result.status = STATUS_FAIL;
+			result.message = StrFormat("unable to read block $%04X", block);
+			return;
+		}
+
+		crc = crc32(crc, buffer, HD_BLOCK_SIZE);
+
+		if (hOutFile && fwrite(buffer, 1, HD_BLOCK_SIZE, hOutFile) != HD_BLOCK_SIZE)
+		{
+			result.status = STATUS_FAIL;
+			result.message = "unable to write converted image";
+			return;
+		}
+	}
+
+	result.imageCrc = result.dataCrc = crc;
+	result.status = STATUS_OK;
+	result.message = StrFormat("blocks=%u", numBlocks);
+}
+
+void DiskImageWorker::ConvertHardDisk(ImageInfo& src, Result_t& result)
+{
+	if (m_options.convertExt != ".po" && m_options.convertExt != ".hdv")
+	{
+		result.status = STATUS_FAIL;
+		result.message = StrFormat("can't convert a hard disk image to %s", m_options.convertExt.c_str());
+		return;
+	}
+
+	const std::string outPathname = GetOutputPathname(src.szFilename, m_options);
+	if (FileExists(outPathname))
+	{
+		result.status = STATUS_FAIL;
+		result.message = outPathname + " already exists";
+		return;
+	}
+
+	// Unwrapped (eg. from .2mg), so just the blocks
+	FILE* hOutFile = fopen(outPathname.c_str(), "wb");
+	if (!hOutFile)
+	{
+		result.status = STATUS_FAIL;
+		result.message = "unable to create " + outPathname;
+		return;
+	}
+
+	ValidateHardDisk(src, result, hOutFile);
+	fclose(hOutFile);
+	if (result.status == STATUS_FAIL)
+		return;
+
+	// Verify
+	Result_t converted;
+	ImageInfo check;
+	ImageError_e err = OpenImage(m_hardDiskImageHelper, check, outPathname);
+	if (err == eIMAGE_ERROR_NONE && check.pImageType)
+		ValidateHardDisk(check, converted, NULL);
+	m_hardDiskImageHelper.Close(&check);
+
+	if (err != eIMAGE_ERROR_NONE || converted.status != STATUS_OK || converted.dataCrc != result.dataCrc)
+	{
+		result.status = STATUS_FAIL;
+		result.message += ": converted image " + outPathname + " doesn't match";
+		return;
+	}
+
+	result.message += " => " + outPathname;
+}
+
+//===========================================================================
+
+static int Usage(void)
+{
+	printf("Usage: DiskImageTool [-j <threads>] [-convert <ext> -out <dir>] <dir|image> ...\n");
+	printf("  Validates every disk image (recursively) in each <dir>, and each <image>\n");
+	printf("  -j <threads>     : number of worker threads (default: one per core)\n");
+	printf("  -convert <ext>   : also convert each image to <ext>: .dsk, .do, .po, .nib or .woz (5.25\"), .po or .hdv (hard disk)\n");
+	printf("  -out <dir>       : directory for the converted images (existing files aren't overwritten)\n");
+	return 1;
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	Options_t options;
+	std::vector<std::string> pathnames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-j" && i + 1 < argc)
+		{
+			options.numThreads = atoi(argv[++i]);
+		}
+		else if (arg == "-convert" && i + 1 < argc)
+		{
+			options.convertExt = ToLower(argv[++i]);
+			if (options.convertExt[0] != '.')
+				options.convertExt = "." + options.convertExt;
+		}
+		else if (arg == "-out" && i + 1 < argc)
+		{
+			options.outDir = argv[++i];
+		}
+		else if (arg[0] == '-')
+		{
+			return Usage();
+		}
+		else
+		{
+			const DWORD attribs = GetFileAttributes(arg.c_str());
+			if (attribs == INVALID_FILE_ATTRIBUTES)
+			{
+				fprintf(stderr, "Not found: %s\n", arg.c_str());
+				return 1;
+			}
+
+			if (attribs & FILE_ATTRIBUTE_DIRECTORY)
+				FindImages(arg, pathnames);
+			else
+				pathnames.push_back(arg);
+		}
+	}
+
+	if (pathnames.empty() || (!options.convertExt.empty() && options.outDir.empty()))
+		return Usage();
+
+	if (options.numThreads == 0)
+		options.numThreads = MAX(1U, std::thread::hardware_concurrency());
+	options.numThreads = MIN(options.numThreads, (UINT)pathnames.size());
+
+	CImageHelperBase::SetPromptOnWOZCRCMismatch(false);	// just reject the image
+
+	std::atomic<size_t> nextImage(0);
+	std::mutex outputMutex;
+	UINT count[NUM_STATUS] = {0};
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (UINT t = 0; t < options.numThreads; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			DiskImageWorker worker(options);
+
+			for (size_t i = nextImage++; i < pathnames.size(); i = nextImage++)
+			{
+				Result_t result;
+				try
+				{
+					result = worker.Process(pathnames[i]);
+				}
+				catch (const std::exception& e)
+				{
+					result.message = e.what();
+				}
+
+				std::lock_guard<std::mutex> lock(outputMutex);
+				count[result.status]++;
+				printf("%-4s %-4s image=%08X data=%08X %s: %s\n", g_statusName[result.status], result.type.c_str(), result.imageCrc, result.dataCrc, pathnames[i].c_str(), result.message.c_str());
+			}
+		}));
+	}
+
+	for (UINT t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("\n%u images: %u OK, %u WARN, %u FAIL, %u SKIP\n", (UINT)pathnames.size(), count[STATUS_OK], count[STATUS_WARN], count[STATUS_FAIL], count[STATUS_SKIP]);
+	printf("%.2f s with %u threads: %.1f images/s\n", seconds, options.numThreads, seconds > 0 ? pathnames.size() / seconds : 0.0);
+
+	return count[STATUS_FAIL] ? 1 : 0;
+}
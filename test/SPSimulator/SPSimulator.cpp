@@ -0,0 +1,128 @@
+#include "stdafx.h"
+
+#include <csignal>
+#include <cstdarg>
+
+#include "../../source/devrelay/service/DeviceSimulator.h"
+
+#ifdef _WIN32
+	#pragma comment(lib, "ws2_32.lib")
+#endif
+
+// Standalone SmartPort device simulator: the emulator's -sp-sim, but without the emulator
+// . Serves ProDOS ordered images (.po, .hdv or .2mg) as block devices, plus a character & a network loopback device,
+//   to the Listener of a SmartPort over SLIP card (eg. AppleWin on another host)
+// . The images are held in memory, and writes are not saved
+// . Runs until the Listener closes the connection, no requests have arrived for -exit-idle seconds (once blocks have been served), or Ctrl-C
+//
+// On Linux (or any POSIX host), from this directory (as one line):
+//   g++ -std=c++17 -O2 -pthread -DDEV_RELAY_SLIP -DSLIP_PROTOCOL_NET -I../../source -o SPSimulator SPSimulator.cpp
+//       ../../source/devrelay/service/DeviceSimulator.cpp ../../source/devrelay/slip/SLIP.cpp
+//       ../../source/devrelay/types/*.cpp ../../source/devrelay/commands/*.cpp
+
+// From Log.cpp: the simulator's log goes to the console instead
+void LogFileOutput(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+}
+
+static std::atomic<bool> g_stop(false);
+
+static void OnSignal(int)
+{
+	g_stop = true;
+}
+
+static int Usage(void)
+{
+	printf("Usage: SPSimulator [-ip <address>] [-port <port>] [-exit-idle <seconds>] <image> ...\n");
+	printf("  Serves each ProDOS ordered <image> (.po, .hdv or .2mg) as a block device to a SmartPort over SLIP card\n");
+	printf("  -ip <address>        : the Listener's address (default: 127.0.0.1)\n");
+	printf("  -port <port>         : the Listener's port (default: 1985)\n");
+	printf("  -exit-idle <seconds> : exit once no requests have arrived for <seconds>, after blocks have been served\n");
+	return 1;
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	std::string ipAddress = "127.0.0.1";
+	int port = 1985;
+	int exitIdleSeconds = 0;
+	std::vector<std::string> images;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-ip" && i + 1 < argc)
+		{
+			ipAddress = argv[++i];
+		}
+		else if (arg == "-port" && i + 1 < argc)
+		{
+			port = atoi(argv[++i]);
+			if (port < 1 || port > 65535)
+				return Usage();
+		}
+		else if (arg == "-exit-idle" && i + 1 < argc)
+		{
+			exitIdleSeconds = atoi(argv[++i]);
+			if (exitIdleSeconds < 1)
+				return Usage();
+		}
+		else if (arg[0] == '-')
+		{
+			return Usage();
+		}
+		else
+		{
+			images.push_back(arg);
+		}
+	}
+
+	if (images.empty())
+		return Usage();
+
+	DeviceSimulator& simulator = GetDeviceSimulator();
+
+	// Volumes first, so that ProDOS finds them as its two drives
+	for (const std::string& image : images)
+	{
+		if (!simulator.add_volume_from_file(image))
+		{
+			fprintf(stderr, "Unable to load: %s\n", image.c_str());
+			return 1;
+		}
+	}
+
+	simulator.add_char_device();
+	simulator.add_network_device();
+
+	if (exitIdleSeconds)
+		simulator.set_idle_callback(exitIdleSeconds, [] { g_stop = true; });	// NB. called from the simulator's thread, so it can't stop() itself
+
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+
+	if (!simulator.start(ipAddress, (uint16_t)port))
+	{
+		fprintf(stderr, "Unable to connect to the Listener at %s:%d\n", ipAddress.c_str(), port);
+		return 1;
+	}
+
+	printf("Serving %u device(s) to %s:%d\n", (unsigned)simulator.get_device_count(), ipAddress.c_str(), port);
+	fflush(stdout);
+
+	while (!g_stop && simulator.is_running())
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	simulator.stop();
+
+	printf("%llu blocks read, %llu blocks written\n",
+		(unsigned long long)simulator.get_blocks_read(), (unsigned long long)simulator.get_blocks_written());
+
+	return 0;
+}
@@ -0,0 +1,28 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <tchar.h>
+#include <winsock2.h>	// before windows.h, which would otherwise pull in the old winsock.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+// Also builds on any POSIX host, without the rest of the emulator (see SPSimulator.cpp)
+#define _tmain main
+typedef char _TCHAR;
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
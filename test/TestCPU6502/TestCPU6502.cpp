@@ -69,6 +69,11 @@ static __forceinline bool IRQ(ULONG& uExecutedCycles, BOOL& flagc, BOOL& flagn,
 	return false;
 }
 
+static __forceinline bool PCTrap(ULONG& uExecutedCycles, BOOL& flagc, BOOL& flagn, BOOL& flagv, BOOL& flagz)
+{
+	return false;
+}
+
 // From z80.cpp
 DWORD z80_mainloop(ULONG uTotalCycles, ULONG uExecutedCycles)
 {
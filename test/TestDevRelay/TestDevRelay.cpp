@@ -0,0 +1,593 @@
+#include "stdafx.h"
+
+#include "../../source/devrelay/commands/Read.h"
+#include "../../source/devrelay/commands/ReadBlock.h"
+#include "../../source/devrelay/commands/Status.h"
+#include "../../source/devrelay/commands/Write.h"
+#include "../../source/devrelay/commands/WriteBlock.h"
+#include "../../source/devrelay/service/DeviceSimulator.h"
+#include "../../source/devrelay/service/Listener.h"
+#include "../../source/devrelay/service/Reactor.h"
+#include "../../source/devrelay/service/Requestor.h"
+#include "../../source/devrelay/service/TCPConnection.h"
+#include "../../source/devrelay/slip/SLIP.h"
+
+#ifdef _WIN32
+	#pragma comment(lib, "ws2_32.lib")
+	#define CLOSE_SOCKET closesocket
+	#define SHUT_RDWR SD_BOTH
+#else
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	#define CLOSE_SOCKET close
+	#define INVALID_SOCKET -1
+#endif
+
+// Fixed seed, so a failure can be reproduced
+static std::mt19937 g_rng(0x5A1D);
+
+static size_t Random(size_t lo, size_t hi)
+{
+	return std::uniform_int_distribution<size_t>(lo, hi)(g_rng);
+}
+
+// Random frames, with plenty of END and ESC bytes that need escaping
+static std::vector<std::vector<uint8_t>> MakeFrames(const size_t count)
+{
+	std::vector<std::vector<uint8_t>> frames(count);
+	for (auto& frame : frames)
+	{
+		frame.resize(Random(1, 600));
+		for (auto& byte : frame)
+		{
+			switch (Random(0, 7))
+			{
+			case 0: byte = SLIP_END; break;
+			case 1: byte = SLIP_ESC; break;
+			default: byte = (uint8_t)Random(0, 255); break;
+			}
+		}
+	}
+	return frames;
+}
+
+static std::vector<uint8_t> EncodeAll(const std::vector<std::vector<uint8_t>>& frames)
+{
+	std::vector<uint8_t> stream;
+	for (const auto& frame : frames)
+	{
+		const std::vector<uint8_t> encoded = SLIP::encode(frame);
+		stream.insert(stream.end(), encoded.begin(), encoded.end());
+	}
+	return stream;
+}
+
+// Feeds the stream in random sized chunks of at most maxChunk bytes
+static std::vector<std::vector<uint8_t>> DecodeChunked(SLIPDecoder& decoder, const std::vector<uint8_t>& stream, const size_t maxChunk)
+{
+	std::vector<std::vector<uint8_t>> packets;
+	size_t pos = 0;
+	while (pos < stream.size())
+	{
+		const size_t len = std::min(Random(1, maxChunk), stream.size() - pos);
+		decoder.feed(stream.data() + pos, len, [&packets](std::vector<uint8_t>&& packet) { packets.push_back(std::move(packet)); });
+		pos += len;
+	}
+	return packets;
+}
+
+//-------------------------------------
+
+// Frames split at arbitrary points across reads must come out intact
+int SLIP_Split_test(void)
+{
+	const std::vector<std::vector<uint8_t>> frames = MakeFrames(2000);
+	const std::vector<uint8_t> stream = EncodeAll(frames);
+
+	const size_t maxChunks[] = { 1, 2, 7, 64, 1024, stream.size() };
+	for (size_t maxChunk : maxChunks)
+	{
+		SLIPDecoder decoder;
+		std::vector<std::vector<uint8_t>> packets = DecodeChunked(decoder, stream, maxChunk);
+		if (packets != frames || decoder.get_dropped_frames() != 0)
+		{
+			printf("SLIP_Split_test: failed with chunks of up to %zu bytes (%zu of %zu frames)\n", maxChunk, packets.size(), frames.size());
+			return 1;
+		}
+
+		// Give the buffers back, so the next pass decodes into recycled buffers
+		for (auto& packet : packets)
+			decoder.recycle(std::move(packet));
+	}
+
+	// The one-shot helper must agree with the streaming decoder
+	if (SLIP::split_into_packets(stream.data(), stream.size()) != frames)
+	{
+		printf("SLIP_Split_test: split_into_packets() mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+// A bad escape sequence loses just that frame, and random noise must never yield an oversized frame
+int SLIP_Corrupt_test(void)
+{
+	std::vector<std::vector<uint8_t>> frames = MakeFrames(200);
+	std::vector<uint8_t> stream;
+	const size_t corruptFrame = 50;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		std::vector<uint8_t> encoded = SLIP::encode(frames[i]);
+		if (i == corruptFrame)
+		{
+			const uint8_t badEscape[] = { SLIP_ESC, 0x00 };
+			encoded.insert(encoded.begin() + 1 + Random(0, encoded.size() - 2), badEscape, badEscape + sizeof(badEscape));
+		}
+		stream.insert(stream.end(), encoded.begin(), encoded.end());
+	}
+	frames.erase(frames.begin() + corruptFrame);
+
+	SLIPDecoder decoder;
+	if (DecodeChunked(decoder, stream, 100) != frames || decoder.get_dropped_frames() != 1)
+	{
+		printf("SLIP_Corrupt_test: corrupt frame not isolated (dropped %zu)\n", decoder.get_dropped_frames());
+		return 1;
+	}
+
+	std::vector<uint8_t> noise(1024 * 1024);
+	for (auto& byte : noise)
+		byte = (uint8_t)Random(0, 255);
+
+	SLIPDecoder noiseDecoder;
+	for (const auto& packet : DecodeChunked(noiseDecoder, noise, 4096))
+	{
+		if (packet.empty() || packet.size() > SLIPDecoder::MAX_FRAME_SIZE)
+		{
+			printf("SLIP_Corrupt_test: bad frame size %zu from noise\n", packet.size());
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int SLIP_Throughput_test(void)
+{
+	const std::vector<std::vector<uint8_t>> frames = MakeFrames(4000);
+	const std::vector<uint8_t> stream = EncodeAll(frames);
+	const int passes = 20;
+
+	SLIPDecoder decoder;
+	size_t count = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < passes; i++)
+	{
+		decoder.feed(stream.data(), stream.size(), [&decoder, &count](std::vector<uint8_t>&& packet) {
+			count++;
+			decoder.recycle(std::move(packet));
+		});
+	}
+	const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (count != frames.size() * passes)
+	{
+		printf("SLIP_Throughput_test: decoded %zu frames, expected %zu\n", count, frames.size() * passes);
+		return 1;
+	}
+
+	printf("SLIP decode: %.1f MB/s, %.0f frames/s\n", (stream.size() * passes) / secs / (1024 * 1024), count / secs);
+	return 0;
+}
+
+//-------------------------------------
+
+// Content of a block served by the loopback peer
+static uint8_t BlockByte(const uint32_t block, const size_t offset)
+{
+	return (uint8_t)(block * 7 + offset);
+}
+
+// The device end of the connection: answers READBLOCK requests, deliberately sending each response
+// in small uneven pieces so the host has to reassemble frames that straddle several recv() calls.
+static void LoopbackPeer(const int sock)
+{
+	std::mt19937 rng(sock);	// each peer runs on its own thread
+	SLIPDecoder decoder;
+	std::vector<uint8_t> buffer(4096);
+	std::vector<uint8_t> block(512);
+
+	for (;;)
+	{
+		const int len = recv(sock, (char*)buffer.data(), (int)buffer.size(), 0);
+		if (len <= 0)
+			break;
+
+		decoder.feed(buffer.data(), len, [sock, &block, &rng](std::vector<uint8_t>&& packet) {
+			const std::unique_ptr<Request> request = Request::from_packet(packet);
+			const ReadBlockRequest* readBlock = dynamic_cast<const ReadBlockRequest*>(request.get());
+			if (readBlock == nullptr)
+				return;
+
+			const auto& bn = readBlock->get_block_number();
+			const uint32_t blockNum = bn[0] | (bn[1] << 8) | (bn[2] << 16);
+			for (size_t i = 0; i < block.size(); i++)
+				block[i] = BlockByte(blockNum, i);
+
+			const std::unique_ptr<Response> response = request->create_response(request->get_device_id(), 0, block.data(), (uint16_t)block.size());
+			const std::vector<uint8_t> slip = SLIP::encode(response->serialize());
+			size_t pos = 0;
+			while (pos < slip.size())
+			{
+				const size_t piece = std::min(std::uniform_int_distribution<size_t>(1, 300)(rng), slip.size() - pos);
+				send(sock, (const char*)slip.data() + pos, (int)piece, 0);
+				pos += piece;
+			}
+		});
+	}
+}
+
+// A TCPConnection wired to a LoopbackPeer thread over 127.0.0.1
+struct LoopbackPair
+{
+	std::shared_ptr<TCPConnection> connection;
+	int peerSock = INVALID_SOCKET;
+	std::thread peer;
+
+	bool Open(void)
+	{
+		const int listenSock = (int)socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = 0;	// any free port
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addrLen = sizeof(addr);
+		if (listenSock == INVALID_SOCKET
+			|| bind(listenSock, (sockaddr*)&addr, sizeof(addr)) != 0
+			|| listen(listenSock, 1) != 0
+			|| getsockname(listenSock, (sockaddr*)&addr, &addrLen) != 0)
+		{
+			printf("LoopbackPair: can't listen on 127.0.0.1\n");
+			return false;
+		}
+
+		peerSock = (int)socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(peerSock, (sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			printf("LoopbackPair: can't connect to 127.0.0.1:%d\n", ntohs(addr.sin_port));
+			CLOSE_SOCKET(listenSock);
+			return false;
+		}
+		const int hostSock = (int)accept(listenSock, nullptr, nullptr);
+		CLOSE_SOCKET(listenSock);
+
+		const int noDelay = 1;
+		setsockopt(peerSock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+		setsockopt(hostSock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+		peer = std::thread(LoopbackPeer, peerSock);
+
+		connection = std::make_shared<TCPConnection>(hostSock);
+		connection->create_read_channel();
+		return connection->is_connected();
+	}
+
+	// Closing the peer's end makes the reactor see EOF and release its reference to the connection
+	void Close(void)
+	{
+		if (!connection)
+			return;
+
+		connection->set_is_connected(false);
+		shutdown(peerSock, SHUT_RDWR);
+		peer.join();
+		CLOSE_SOCKET(peerSock);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+		while (connection.use_count() > 1 && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		connection->close_connection();
+		connection.reset();
+	}
+};
+
+static bool CheckBlock(const Response* response, const uint32_t blockNum)
+{
+	const ReadBlockResponse* rbr = dynamic_cast<const ReadBlockResponse*>(response);
+	if (rbr == nullptr || rbr->get_status() != 0)
+	{
+		printf("no response for block %u\n", blockNum);
+		return false;
+	}
+
+	const auto& data = rbr->get_block_data();
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		if (data[i] != BlockByte(blockNum, i))
+		{
+			printf("block %u corrupt at offset %zu\n", blockNum, i);
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::unique_ptr<ReadBlockRequest> MakeReadBlock(const uint32_t blockNum)
+{
+	auto request = std::make_unique<ReadBlockRequest>(Requestor::next_request_number(), 3, 1);
+	request->set_block_number_from_bytes(blockNum & 0xff, (blockNum >> 8) & 0xff, (blockNum >> 16) & 0xff);
+	return request;
+}
+
+// Reads blocks one at a time through the normal Requestor path: each request pays a full round trip
+int Loopback_test(void)
+{
+	LoopbackPair pair;
+	if (!pair.Open())
+		return 1;
+
+	int res = 0;
+	const uint32_t numBlocks = 4000;
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t blockNum = 0; blockNum < numBlocks; blockNum++)
+	{
+		const std::unique_ptr<ReadBlockRequest> request = MakeReadBlock(blockNum);
+		const std::unique_ptr<Response> response = Requestor::send_request(*request, pair.connection.get());
+		if (!CheckBlock(response.get(), blockNum))
+		{
+			printf("Loopback_test: failed\n");
+			res = 1;
+			break;
+		}
+	}
+	const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (res == 0)
+		printf("Loopback READBLOCK: %.0f requests/s, %.1f MB/s, %.1f us/request\n", numBlocks / secs, (numBlocks * 512) / secs / (1024 * 1024), secs * 1e6 / numBlocks);
+
+	// An abandoned request's number is skipped until its late response has been dropped, so it can't be taken for a new request's
+	if (res == 0)
+	{
+		const std::unique_ptr<ReadBlockRequest> abandoned = MakeReadBlock(5);
+		const uint8_t id = abandoned->get_request_sequence_number();
+		pair.connection->abandon_response(id, std::chrono::seconds(5));	// before sending, so the response can't arrive during the check
+
+		bool reused = false;
+		for (int i = 0; i < 256; i++)
+			reused |= Requestor::next_request_number(pair.connection.get()) == id;
+		Requestor::send_request_async(*abandoned, pair.connection.get());
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+		while (pair.connection->is_abandoned(id) && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		ReadBlockRequest request(id, 3, 1);
+		request.set_block_number_from_bytes(9, 0, 0);
+		const std::unique_ptr<Response> response = Requestor::send_request(request, pair.connection.get());
+		if (reused || !CheckBlock(response.get(), 9))
+		{
+			printf("Loopback_test: abandoned request's response not dropped\n");
+			res = 1;
+		}
+	}
+
+	pair.Close();
+	return res;
+}
+
+// Many devices, each with several requests in flight, all serviced by the one Reactor thread
+int Reactor_Benchmark_test(void)
+{
+	const size_t numConnections = 16;
+	const size_t window = 8;	// numConnections * window must stay below 256 request numbers
+	const uint32_t rounds = 500;
+
+	std::vector<LoopbackPair> pairs(numConnections);
+	int res = 0;
+	for (auto& pair : pairs)
+	{
+		if (!pair.Open())
+			res = 1;
+	}
+
+	if (res == 0 && GetReactor().get_connection_count() != numConnections)
+	{
+		printf("Reactor_Benchmark_test: reactor is servicing %zu connections, expected %zu\n", GetReactor().get_connection_count(), numConnections);
+		res = 1;
+	}
+
+	std::vector<std::unique_ptr<ReadBlockRequest>> inFlight(numConnections * window);
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t round = 0; round < rounds && res == 0; round++)
+	{
+		for (size_t i = 0; i < inFlight.size(); i++)
+		{
+			inFlight[i] = MakeReadBlock(round * window + (uint32_t)(i % window));
+			Requestor::send_request_async(*inFlight[i], pairs[i / window].connection.get());
+		}
+
+		for (size_t i = 0; i < inFlight.size() && res == 0; i++)
+		{
+			const std::unique_ptr<Response> response = Requestor::receive_response(*inFlight[i], pairs[i / window].connection.get());
+			if (!CheckBlock(response.get(), round * window + (uint32_t)(i % window)))
+			{
+				printf("Reactor_Benchmark_test: failed on connection %zu\n", i / window);
+				res = 1;
+			}
+		}
+	}
+	const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (res == 0)
+	{
+		const double requests = (double)rounds * inFlight.size();
+		printf("Reactor READBLOCK: %zu connections x %zu in flight: %.0f requests/s, %.1f MB/s\n", numConnections, window, requests / secs, requests * 512 / secs / (1024 * 1024));
+	}
+
+	for (auto& pair : pairs)
+		pair.Close();
+
+	return res;
+}
+
+// The simulator registers with a real Listener, then serves a volume and a character device through it
+int DeviceSimulator_test(void)
+{
+	const uint32_t numBlocks = 280;
+	std::vector<uint8_t> volume(numBlocks * DeviceSimulator::BLOCK_SIZE);
+	for (size_t i = 0; i < volume.size(); i++)
+		volume[i] = BlockByte((uint32_t)(i / DeviceSimulator::BLOCK_SIZE), i % DeviceSimulator::BLOCK_SIZE);
+
+	Listener& listener = GetCommandListener();
+	listener.Initialize("127.0.0.1", 0, 5);	// any free port
+	listener.start();
+
+	const auto listenDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+	while (listener.get_port() == 0 && std::chrono::steady_clock::now() < listenDeadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	DeviceSimulator simulator;
+	simulator.add_volume("test", volume);
+	simulator.add_char_device();
+	simulator.add_network_device();
+	std::atomic<bool> idle(false);
+	simulator.set_idle_callback(1, [&idle] { idle = true; });
+	if (listener.get_port() == 0 || !simulator.start("127.0.0.1", listener.get_port()))
+	{
+		printf("DeviceSimulator_test: can't connect to listener\n");
+		listener.stop();
+		return 1;
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (listener.get_total_device_count() < simulator.get_device_count() && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	int res = 0;
+	if (listener.get_total_device_count() != simulator.get_device_count())
+	{
+		printf("DeviceSimulator_test: %d devices registered, expected %zu\n", listener.get_total_device_count(), simulator.get_device_count());
+		res = 1;
+	}
+
+	Connection* connection = res == 0 ? listener.find_connection_with_device(1).second.get() : nullptr;
+
+	// DIB: block device with the volume's size
+	if (res == 0)
+	{
+		const StatusRequest request(Requestor::next_request_number(), 3, 1, 3, 0);
+		const std::unique_ptr<Response> response = Requestor::send_request(request, connection);
+		const StatusResponse* status = dynamic_cast<const StatusResponse*>(response.get());
+		if (status == nullptr || status->get_data().size() != 25 || status->get_data()[21] != 0x02 || (status->get_data()[1] | (status->get_data()[2] << 8)) != numBlocks)
+		{
+			printf("DeviceSimulator_test: bad DIB for volume\n");
+			res = 1;
+		}
+	}
+
+	for (uint32_t blockNum = 0; blockNum < numBlocks && res == 0; blockNum++)
+	{
+		const std::unique_ptr<ReadBlockRequest> request = MakeReadBlock(blockNum);
+		const std::unique_ptr<Response> response = Requestor::send_request(*request, connection);
+		if (!CheckBlock(response.get(), blockNum))
+			res = 1;
+	}
+
+	// Write a block, read it back, and read past the end of the volume
+	if (res == 0)
+	{
+		std::vector<uint8_t> block(DeviceSimulator::BLOCK_SIZE, 0xA5);
+		WriteBlockRequest write(Requestor::next_request_number(), 3, 1);
+		write.set_block_number_from_bytes(7, 0, 0);
+		write.set_block_data_from_ptr(block.data(), 0);
+		const std::unique_ptr<Response> writeResponse = Requestor::send_request(write, connection);
+
+		const std::unique_ptr<Response> readResponse = Requestor::send_request(*MakeReadBlock(7), connection);
+		const ReadBlockResponse* rbr = dynamic_cast<const ReadBlockResponse*>(readResponse.get());
+
+		const std::unique_ptr<Response> pastEnd = Requestor::send_request(*MakeReadBlock(numBlocks), connection);
+
+		if (writeResponse == nullptr || writeResponse->get_status() != 0 || rbr == nullptr || rbr->get_block_data()[0] != 0xA5
+			|| pastEnd == nullptr || pastEnd->get_status() != 0x2D || simulator.get_blocks_written() != 1)
+		{
+			printf("DeviceSimulator_test: write/read back failed\n");
+			res = 1;
+		}
+	}
+
+	// The character device echoes what was written to it
+	if (res == 0)
+	{
+		const uint8_t text[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 5, 0, 0, 0, 0, 'H', 'E', 'L', 'L', 'O' };
+		WriteRequest write(Requestor::next_request_number(), 4, 2);
+		write.set_byte_count_from_ptr(text, 6);
+		write.set_data_from_ptr(text, 11, 5);
+		const std::unique_ptr<Response> writeResponse = Requestor::send_request(write, connection);
+
+		ReadRequest read(Requestor::next_request_number(), 4, 2);
+		read.set_byte_count_from_ptr(text, 6);
+		const std::unique_ptr<Response> readResponse = Requestor::send_request(read, connection);
+		const ReadResponse* rr = dynamic_cast<const ReadResponse*>(readResponse.get());
+		if (writeResponse == nullptr || writeResponse->get_status() != 0 || rr == nullptr || rr->get_data() != std::vector<uint8_t>(text + 11, text + 16))
+		{
+			printf("DeviceSimulator_test: character device echo failed\n");
+			res = 1;
+		}
+	}
+
+	// -sp-sim-exit relies on this to end a benchmark run
+	if (res == 0)
+	{
+		const auto idleDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+		while (!idle && std::chrono::steady_clock::now() < idleDeadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		if (!idle)
+		{
+			printf("DeviceSimulator_test: idle callback not called\n");
+			res = 1;
+		}
+	}
+
+	if (res == 0)
+		printf("DeviceSimulator: %zu devices registered, %llu blocks read\n", simulator.get_device_count(), (unsigned long long)simulator.get_blocks_read());
+
+	listener.stop();
+	simulator.stop();
+	return res;
+}
+
+//-------------------------------------
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	int res = 1;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return res;
+#endif
+
+	GetCommandListener().set_response_timeout(5);
+
+	res = SLIP_Split_test();
+	if (res) return res;
+
+	res = SLIP_Corrupt_test();
+	if (res) return res;
+
+	res = SLIP_Throughput_test();
+	if (res) return res;
+
+	res = Loopback_test();
+	if (res) return res;
+
+	res = Reactor_Benchmark_test();
+	if (res) return res;
+
+	res = DeviceSimulator_test();
+	if (res) return res;
+
+	return 0;
+}
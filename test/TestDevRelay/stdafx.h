@@ -0,0 +1,26 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <tchar.h>
+
+#ifdef _WIN32
+#include <winsock2.h>	// before windows.h, which would otherwise pull in the old winsock.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
@@ -0,0 +1,401 @@
+#include "stdafx.h"
+
+#include "../../source/DirtyLineTracker.h"
+#include "../../source/NTSC_ModeChange.h"
+#include "../../source/NTSC_TVPixels.h"
+
+static const UINT kWidth = 560;
+static const UINT kHeight = 384;
+
+static bool CheckRanges(const char* test, const DirtyLineTracker& tracker, const std::vector<DirtyLineTracker::Range_t>& expected)
+{
+	const std::vector<DirtyLineTracker::Range_t>& ranges = tracker.GetRanges();
+
+	bool ok = ranges.size() == expected.size();
+	for (size_t i = 0; ok && i < ranges.size(); i++)
+		ok = ranges[i].firstLine == expected[i].firstLine && ranges[i].numLines == expected[i].numLines;
+
+	if (!ok)
+	{
+		printf("%s: expected %u range(s), got %u:", test, (UINT)expected.size(), (UINT)ranges.size());
+		for (size_t i = 0; i < ranges.size(); i++)
+			printf(" [%u,+%u]", ranges[i].firstLine, ranges[i].numLines);
+		printf("\n");
+	}
+
+	return ok;
+}
+
+static DirtyLineTracker::Range_t Range(UINT firstLine, UINT numLines)
+{
+	DirtyLineTracker::Range_t range;
+	range.firstLine = firstLine;
+	range.numLines = numLines;
+	return range;
+}
+
+//-------------------------------------
+
+// As the NTSC renderer does: report every line of the frame once it's finished, then gather the ranges
+static void RenderFrame(DirtyLineTracker& tracker, const std::vector<uint32_t>& frame, UINT width, UINT height)
+{
+	for (UINT y = 0; y < height; y++)
+		tracker.LineRendered(y, &frame[y * width], width);
+	tracker.Update(height);
+}
+
+// Changed lines are reported as merged ranges
+int DirtyLineTracker_ChangedLines_test(void)
+{
+	std::vector<uint32_t> frame(kWidth * kHeight, 0xFF000000);
+	DirtyLineTracker tracker;
+	tracker.Reset(kHeight);
+
+	// First frame: all lines
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("ChangedLines first frame", tracker, { Range(0, kHeight) }))
+		return 1;
+
+	// Unchanged
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("ChangedLines unchanged", tracker, {}))
+		return 1;
+
+	// Adjacent lines merge, and a single pixel is enough to dirty a line (incl. the first & last pixels of a line)
+	frame[3 * kWidth + 100] = 0xFFFFFFFF;
+	frame[4 * kWidth + 0] = 0xFFFFFFFF;
+	frame[5 * kWidth + kWidth - 1] = 0xFFFFFFFF;
+	frame[10 * kWidth + 7] = 0xFF00FF00;
+	frame[(kHeight - 1) * kWidth] = 0xFF0000FF;
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("ChangedLines changed lines", tracker, { Range(3, 3), Range(10, 1), Range(kHeight - 1, 1) }))
+		return 1;
+
+	// Same frame again: nothing changed since the last update
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("ChangedLines unchanged after change", tracker, {}))
+		return 1;
+
+	// Writing the same value doesn't dirty the line
+	frame[3 * kWidth + 100] = 0xFFFFFFFF;
+	frame[0] = 0xFF123456;
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("ChangedLines same value", tracker, { Range(0, 1) }))
+		return 1;
+
+	// Every single pixel position is detected, for each of a few values
+	const uint32_t values[] = { 0xFF000001, 0x01000000, 0xFFFFFFFF };
+	for (UINT x = 0; x < kWidth; x++)
+	{
+		for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+		{
+			const uint32_t old = frame[20 * kWidth + x];
+			frame[20 * kWidth + x] = values[v];
+			RenderFrame(tracker, frame, kWidth, kHeight);
+			const bool ok = CheckRanges("ChangedLines pixel", tracker, { Range(20, 1) });
+			frame[20 * kWidth + x] = old;
+			RenderFrame(tracker, frame, kWidth, kHeight);
+			if (!ok)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+// A presented frame can be mid-render: lines are only reported once they're finished, so a line that's finished after
+// the frame is presented is reported with the next frame, and a line finished twice (eg. partly rendered) is only reported once
+int DirtyLineTracker_PartialFrame_test(void)
+{
+	std::vector<uint32_t> frame(kWidth * kHeight, 0xFF000000);
+	DirtyLineTracker tracker;
+	tracker.Reset(kHeight);
+	RenderFrame(tracker, frame, kWidth, kHeight);
+
+	frame[50 * kWidth] = 0xFFFFFFFF;
+	frame[300 * kWidth] = 0xFFFFFFFF;
+	for (UINT y = 0; y < 200; y++)
+		tracker.LineRendered(y, &frame[y * kWidth], kWidth);
+	tracker.Update(kHeight);
+	if (!CheckRanges("PartialFrame top half", tracker, { Range(50, 1) }))
+		return 1;
+
+	frame[300 * kWidth + 1] = 0xFFFFFFFF;
+	tracker.LineRendered(300, &frame[300 * kWidth], kWidth);
+	frame[300 * kWidth + 2] = 0xFFFFFFFF;
+	for (UINT y = 200; y < kHeight; y++)
+		tracker.LineRendered(y, &frame[y * kWidth], kWidth);
+	tracker.Update(kHeight);
+	if (!CheckRanges("PartialFrame bottom half", tracker, { Range(300, 1) }))
+		return 1;
+
+	// Lines that aren't rendered (eg. outside the centred //e area with a VidHD) aren't dirty
+	tracker.Update(kHeight);
+	if (!CheckRanges("PartialFrame nothing rendered", tracker, {}))
+		return 1;
+
+	// Out of range lines are ignored
+	tracker.LineRendered(kHeight, &frame[0], kWidth);
+	tracker.Update(kHeight);
+	if (!CheckRanges("PartialFrame out of range", tracker, {}))
+		return 1;
+
+	return 0;
+}
+
+// A new frame size, or Reset() (eg. the framebuffer was cleared), reports every line as dirty
+int DirtyLineTracker_Reset_test(void)
+{
+	std::vector<uint32_t> frame(kWidth * 2 * (kHeight + 16), 0xFF000000);
+	DirtyLineTracker tracker;
+	tracker.Reset(kHeight);
+
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	RenderFrame(tracker, frame, kWidth, kHeight);
+	if (!CheckRanges("Reset unchanged", tracker, {}))
+		return 1;
+
+	tracker.Reset(kHeight);
+	tracker.Update(kHeight);
+	if (!CheckRanges("Reset all lines", tracker, { Range(0, kHeight) }))
+		return 1;
+
+	tracker.Update(kHeight);
+	if (!CheckRanges("Reset nothing rendered", tracker, {}))
+		return 1;
+
+	// eg. VidHD's larger framebuffer (Video::ClearFrameBuffer() resets with the new size)
+	tracker.Reset(kHeight + 16);
+	RenderFrame(tracker, frame, kWidth * 2, kHeight + 16);
+	if (!CheckRanges("Reset new size", tracker, { Range(0, kHeight + 16) }))
+		return 1;
+
+	RenderFrame(tracker, frame, kWidth * 2, kHeight + 16);
+	if (!CheckRanges("Reset new size unchanged", tracker, {}))
+		return 1;
+
+	return 0;
+}
+
+//-------------------------------------
+
+// Where a soft-switch access splits the rendering of its opcode (see NTSC_ModeChange.h)
+// . Pins the GH#656 timing: STA $C050 switches at the start of the opcode (1 cycle later for TEXT/MIXED),
+//   and longer addressing modes switch as many cycles later as their bus access is
+
+static VideoModeChange_t ModeChange(uint16_t address, bool isWrite, UINT delayCycles)
+{
+	VideoModeChange_t change = {};
+	change.address = address;
+	change.isWrite = isWrite;
+	change.delayCycles = delayCycles;
+	return change;
+}
+
+static bool CheckModeChangeCycles(const char* test, const std::vector<VideoModeChange_t>& changes, UINT cycles6502, const std::vector<int>& expected)
+{
+	bool ok = true;
+	for (UINT i = 0; i < changes.size(); i++)
+	{
+		const int cycle = NTSC_GetVideoModeChangeCycle(&changes[0], (UINT)changes.size(), i, cycles6502);
+		if (cycle != expected[i])
+		{
+			printf("%s: change %u at cycle %d, expected %d\n", test, i, cycle, expected[i]);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int VideoModeChange_Absolute_test(void)
+{
+	// STA $C050 / LDA $C050 / BIT $C050: 4 cycles, access on the 4th
+	if (!CheckModeChangeCycles("STA abs", { ModeChange(0xC050, true, 0) }, 4, { 0 }))
+		return 1;
+	if (!CheckModeChangeCycles("STA abs (TEXT)", { ModeChange(0xC050, true, 1) }, 4, { 1 }))
+		return 1;
+	if (!CheckModeChangeCycles("LDA abs", { ModeChange(0xC055, false, 0) }, 4, { 0 }))
+		return 1;
+	if (!CheckModeChangeCycles("BIT abs (MIXED)", { ModeChange(0xC053, false, 1) }, 4, { 1 }))
+		return 1;
+
+	return 0;
+}
+
+int VideoModeChange_Indexed_test(void)
+{
+	// STA $C050,X: 5 cycles
+	if (!CheckModeChangeCycles("STA abs,X", { ModeChange(0xC050, true, 0) }, 5, { 1 }))
+		return 1;
+	if (!CheckModeChangeCycles("STA abs,X (TEXT)", { ModeChange(0xC050, true, 1) }, 5, { 2 }))
+		return 1;
+
+	// LDA $C050,X: 4 cycles, or 5 if it crosses a page
+	if (!CheckModeChangeCycles("LDA abs,X", { ModeChange(0xC055, false, 0) }, 4, { 0 }))
+		return 1;
+	if (!CheckModeChangeCycles("LDA abs,X (page cross)", { ModeChange(0xC055, false, 0) }, 5, { 1 }))
+		return 1;
+
+	// STA ($FE),Y: 6 cycles
+	if (!CheckModeChangeCycles("STA (zp),Y", { ModeChange(0xC050, true, 0) }, 6, { 2 }))
+		return 1;
+	if (!CheckModeChangeCycles("STA (zp),Y (TEXT)", { ModeChange(0xC050, true, 1) }, 6, { 3 }))
+		return 1;
+
+	return 0;
+}
+
+int VideoModeChange_RMW_test(void)
+{
+	// INC $C050: 6 cycles, read on the 4th, (dummy write on the 5th), write on the 6th
+	const std::vector<VideoModeChange_t> inc = { ModeChange(0xC050, false, 0), ModeChange(0xC050, true, 0) };
+	if (!CheckModeChangeCycles("INC abs", inc, 6, { 0, 2 }))
+		return 1;
+
+	const std::vector<VideoModeChange_t> incText = { ModeChange(0xC050, false, 1), ModeChange(0xC050, true, 1) };
+	if (!CheckModeChangeCycles("INC abs (TEXT)", incText, 6, { 1, 3 }))
+		return 1;
+
+	// INC $C050,X: 7 cycles
+	if (!CheckModeChangeCycles("INC abs,X", inc, 7, { 1, 3 }))
+		return 1;
+
+	return 0;
+}
+
+//-------------------------------------
+
+// TV modes: the batched 14-pixel path (updatePixelsTV()) must give the same framebuffer as 14 calls to the per-pixel path
+// . Both draw one Apple II scanline: the current row, the inbetween row above it (blended with the previous row),
+//   and for the last Apple II scanline also the final inbetween row below it
+
+static const UINT kTVTableSize = 4096;	// 12-bit signal history
+
+struct TVScanline_t
+{
+	std::vector<uint32_t> curr, prevInbetween, prev, nextInbetween;
+	int signalBits;
+	int colorPhase;
+
+	TVScanline_t(const std::vector<uint32_t>& prevRow)
+		: curr(kWidth, 0), prevInbetween(kWidth, 0), prev(prevRow), nextInbetween(kWidth, 0), signalBits(0), colorPhase(0)
+	{
+	}
+
+	bool operator==(const TVScanline_t& other) const
+	{
+		return curr == other.curr && prevInbetween == other.prevInbetween && prev == other.prev && nextInbetween == other.nextInbetween
+			&& signalBits == other.signalBits && colorPhase == other.colorPhase;
+	}
+};
+
+template <bool isDoubleScanline>
+static void DrawTVScanlinePerPixel(TVScanline_t& line, const std::vector<uint16_t>& cells, const uint32_t* pTables, UINT tableStride, bool isLastScanline)
+{
+	UINT x = 0;
+	for (size_t cell = 0; cell < cells.size(); cell++)
+	{
+		uint16_t bits = cells[cell];
+		for (UINT i = 0; i < 14; i++, x++, bits >>= 1)
+		{
+			const uint32_t color0 = NTSC_GetTVPixelColor(bits & 1, line.signalBits, line.colorPhase, pTables, tableStride);
+			NTSC_WriteTVPixel<isDoubleScanline>(color0, &line.curr[x], &line.prevInbetween[x], &line.prev[x], isLastScanline ? &line.nextInbetween[x] : NULL);
+		}
+	}
+}
+
+template <bool isDoubleScanline>
+static void DrawTVScanlineBatched(TVScanline_t& line, const std::vector<uint16_t>& cells, const uint32_t* pTables, UINT tableStride, bool isLastScanline)
+{
+	UINT x = 0;
+	for (size_t cell = 0; cell < cells.size(); cell++, x += 14)
+	{
+		uint32_t colors[14];
+		uint16_t bits = cells[cell];
+		for (UINT i = 0; i < 14; i++, bits >>= 1)
+			colors[i] = NTSC_GetTVPixelColor(bits & 1, line.signalBits, line.colorPhase, pTables, tableStride);
+
+		NTSC_WriteTVPixels<isDoubleScanline>(colors, 14, &line.curr[x], &line.prevInbetween[x], &line.prev[x], isLastScanline ? &line.nextInbetween[x] : NULL);
+	}
+}
+
+template <bool isDoubleScanline>
+static bool CheckTVPixels(const char* test, const std::vector<uint32_t>& tables, UINT tableStride, const std::vector<uint32_t>& prevRow, const std::vector<uint16_t>& cells)
+{
+	for (int isLastScanline = 0; isLastScanline <= 1; isLastScanline++)
+	{
+		TVScanline_t perPixel(prevRow), batched(prevRow);
+		DrawTVScanlinePerPixel<isDoubleScanline>(perPixel, cells, &tables[0], tableStride, isLastScanline != 0);
+		DrawTVScanlineBatched<isDoubleScanline>(batched, cells, &tables[0], tableStride, isLastScanline != 0);
+
+		if (!(perPixel == batched))
+		{
+			printf("%s: batched pixels differ from per-pixel%s\n", test, isLastScanline ? " (last scanline)" : "");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int TVPixels_BatchedMatchesPerPixel_test(void)
+{
+	uint32_t seed = 0x12345678;
+	auto next = [&seed]() { seed = seed * 1664525 + 1013904223; return seed; };	// LCG
+
+	const UINT kNumPhases = 4;
+	std::vector<uint32_t> hueTables(kNumPhases * kTVTableSize), bnwTable(kTVTableSize);
+	for (size_t i = 0; i < hueTables.size(); i++)
+		hueTables[i] = next() | 0xFF000000;
+	for (size_t i = 0; i < bnwTable.size(); i++)
+		bnwTable[i] = next() | 0xFF000000;
+
+	std::vector<uint32_t> prevRow(kWidth);
+	for (UINT x = 0; x < kWidth; x++)
+		prevRow[x] = next() | 0xFF000000;
+
+	std::vector<uint16_t> cells(kWidth / 14);
+	for (size_t i = 0; i < cells.size(); i++)
+		cells[i] = (uint16_t)(next() >> 16) & 0x3FFF;
+
+	if (!CheckTVPixels<false>("Color TV, single scanline", hueTables, kTVTableSize, prevRow, cells))
+		return 1;
+	if (!CheckTVPixels<true>("Color TV, double scanline", hueTables, kTVTableSize, prevRow, cells))
+		return 1;
+	if (!CheckTVPixels<false>("B&W TV, single scanline", bnwTable, 0, prevRow, cells))
+		return 1;
+	if (!CheckTVPixels<true>("B&W TV, double scanline", bnwTable, 0, prevRow, cells))
+		return 1;
+
+	return 0;
+}
+
+//-------------------------------------
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	int res = 1;
+
+	res = DirtyLineTracker_ChangedLines_test();
+	if (res) return res;
+
+	res = DirtyLineTracker_PartialFrame_test();
+	if (res) return res;
+
+	res = DirtyLineTracker_Reset_test();
+	if (res) return res;
+
+	res = VideoModeChange_Absolute_test();
+	if (res) return res;
+
+	res = VideoModeChange_Indexed_test();
+	if (res) return res;
+
+	res = VideoModeChange_RMW_test();
+	if (res) return res;
+
+	res = TVPixels_BatchedMatchesPerPixel_test();
+	if (res) return res;
+
+	return 0;
+}
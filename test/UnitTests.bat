@@ -9,6 +9,14 @@
 .\%1\TestDebugger.exe
 @if errorlevel 1 GOTO failed
 
+@ECHO Performing unit-test: TestDevRelay
+.\%1\TestDevRelay.exe
+@IF errorlevel 1 GOTO failed
+
+@ECHO Performing unit-test: TestVideo
+.\%1\TestVideo.exe
+@IF errorlevel 1 GOTO failed
+
 @GOTO end
 
 :failed